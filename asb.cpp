@@ -25,22 +25,28 @@
     #include "asb_proto.h"
 
     ASB::ASB(unsigned int start, unsigned int stop) {
+        _cfgAddrStart = start;
+        _cfgAddrStop = stop;
         if(_cfgAddrStop < _cfgAddrStart+2) _cfgAddrStop = _cfgAddrStart;
 
+        //Journal lives at the end of our space, finish interrupted writes first
+        if(_cfgAddrStop > _cfgAddrStart) _cfgAddrStop = asbEEPROM.begin(_cfgAddrStart, _cfgAddrStop);
+
         //Read NodeID from EEPROM
         unsigned int cfg = 0xFFFF;
-        EEPROM.get(_cfgAddrStart, cfg);
-        setNodeId(cfg);
+        asbEEPROM.get(_cfgAddrStart, cfg);
+        if(cfg >= 0x0001 && cfg <= 0x07FF) _nodeId = cfg;
+    }
 
-        _cfgAddrStop = stop;
-        _cfgAddrStart = start;
+    ASB::ASB(unsigned int start, unsigned int stop, unsigned int id) : ASB(start, stop) {
+        if(_nodeId == 0 && id >= 0x0001 && id <= 0x07FF) _nodeId = id;
     }
 
     ASB::ASB(unsigned int id) {
-        setNodeId(id);
-
         _cfgAddrStop = 0;
         _cfgAddrStart = 0;
+
+        setNodeId(id);
     }
 
     bool ASB::firstboot(void (*function)()) {
@@ -59,19 +65,30 @@
     bool ASB::setNodeId(unsigned int id) {
         if(id < 0x0001 || id > 0x07FF) return false;
         _nodeId = id;
-        EEPROM.put(_cfgAddrStart, id);
+        if(_cfgAddrStart < _cfgAddrStop) asbEEPROM.put(_cfgAddrStart, id); //Only changed bytes are written
         return true;
     }
 
+    unsigned int ASB::getNodeId(void) {
+        return _nodeId;
+    }
+
     char ASB::busAttach(ASB_COMM *bus) {
         for(signed char busId=0; busId<ASB_BUSNUM; busId++) {
             if(_busAddr[busId] == 0x00) {
                 _busAddr[busId] = bus;
                 byte err = bus->begin();
                 if(err == 0) {
-                    //Boot message
-                    byte data[1] = {ASB_CMD_BOOT};
-                    bus->asbSend(ASB_PKGTYPE_BROADCAST, 0x00, _nodeId, -1, sizeof(data), data);
+                    //Boot message, sent with our other announcements
+                    _bootPending[busId] = true;
+                    memberUpdate(-1);
+                    requestStart();
+
+                    #if ASB_MEMBER_REFRESH > 0
+                    if(_memberTimer < 0) {
+                        _memberTimer = timerAttach(ASB_MEMBER_REFRESH, ASB_MEMBER_REFRESH, memberTimer, this, 0);
+                    }
+                    #endif
 
                     return busId;
                 }else{
@@ -87,78 +104,263 @@
         if(busId < 0 || busId >= ASB_BUSNUM) return false;
         if(_busAddr[busId] == 0x00) return false;
         _busAddr[busId] = 0x00;
+        _bootPending[busId] = false;
+        #if ASB_MEMBER_REFRESH > 0
+        _memberPending[busId] = false;
+        memset(&_member[busId], 0, sizeof(asbMember));
+        #endif
         return true;
     }
 
+    byte ASB::busUtilization(signed char busId) {
+        if(busId < 0 || busId >= ASB_BUSNUM) return 0xFF;
+        if(_busAddr[busId] == 0x00) return 0xFF;
+        return _busAddr[busId]->utilization();
+    }
+
+    byte ASB::cfgBlockLength(unsigned int address) {
+        //_cfgAddrStop is the last usable address
+        if(address + ASB_CFG_HEADER - 1 > _cfgAddrStop) return 0;
+
+        byte check = asbEEPROM.read(address);
+        if(check == 0xFF || check == 0x00) return 0;
+
+        byte len = asbEEPROM.read(address+1);
+        if(len < ASB_CFG_HEADER || address + len - 1 > _cfgAddrStop) { //Broken chain, treat as end
+            #ifdef ASB_DEBUG
+                Serial.print(F("Invalid block at ")); Serial.println(address); Serial.flush();
+            #endif
+            return 0;
+        }
+        return len;
+    }
+
+    byte ASB::cfgMerge(unsigned int address) {
+        byte len = cfgBlockLength(address);
+        byte next;
+
+        while(len > 0) {
+            next = cfgBlockLength(address+len);
+            if(next == 0) { //Nothing behind us, this is the new end of chain
+                asbEEPROM.update(address, 0xFF);
+                return 0;
+            }
+            if(asbEEPROM.read(address+len) != ASB_CFG_FREE || ((unsigned int)len + next) > 0xFF) break;
+            len += next;
+        }
+
+        asbEEPROM.update(address+1, len);
+        return len;
+    }
+
     unsigned int ASB::cfgFindFreeblock(byte bytes, byte id) {
-        if(_cfgAddrStart == _cfgAddrStop)  {
+        if(_cfgAddrStart >= _cfgAddrStop)  {
             #ifdef ASB_DEBUG
                 Serial.print(F("EEPROM space 0")); Serial.println(); Serial.flush();
             #endif
             return 0;
         }
-        
-        bytes++; //Header
-        
+
+        if(id == 0 || id > 0x0F || bytes > (0xFF - ASB_CFG_HEADER)) return 0;
+        bytes += ASB_CFG_HEADER;
+
         #ifdef ASB_DEBUG
             Serial.print(F("ID is ")); Serial.println(id, HEX); Serial.flush();
             Serial.print(F("size is ")); Serial.println(bytes, HEX); Serial.flush();
         #endif
 
         unsigned int address = _cfgAddrStart+2; //bytes 1+2 are our ID
-        byte check,len;
+        byte len;
 
-        if(((int)_cfgAddrStop-_cfgAddrStart-bytes) < 0) {
-            #ifdef ASB_DEBUG
-                Serial.print(F("Space < length")); Serial.println(); Serial.flush();
-            #endif
-            return 0;
-        }
+        asbEEPROM.transaction();
+        while(address + bytes - 1 <= _cfgAddrStop) {
+            len = cfgBlockLength(address);
 
-        do {
-            check = EEPROM.read(address);
-            #ifdef ASB_DEBUG
-                Serial.print(F("check addr ")); Serial.println(address); Serial.flush();
-                Serial.print(F(" = ")); Serial.println(check, HEX); Serial.flush();
-            #endif
-            if(check == 0xFF || check == 0) { //Nothing saved yet
-                len = 0;
-                while(((1 << len) + 5) < bytes) {
+            if(len == 0) { //End of chain, append new block
+                #ifdef ASB_DEBUG
+                    Serial.print(F("append at ")); Serial.println(address); Serial.flush();
+                #endif
+                asbEEPROM.update(address+1, bytes);
+                asbEEPROM.update(address, (id << 4));
+                if(address + bytes <= _cfgAddrStop) asbEEPROM.update(address+bytes, 0xFF);
+                return asbEEPROM.commit() ? address : 0;
+            }
+
+            if(asbEEPROM.read(address) == ASB_CFG_FREE) {
+                len = cfgMerge(address);
+                if(len == 0) continue; //Free space was at the end, address is now end of chain
+
+                if(len >= bytes) {
+                    if(len - bytes > ASB_CFG_HEADER) { //Split, remainder stays free
+                        asbEEPROM.update(address+bytes+1, len-bytes);
+                        asbEEPROM.update(address+bytes, ASB_CFG_FREE);
+                        len = bytes;
+                    }
                     #ifdef ASB_DEBUG
-                        Serial.print(F("Testing length")); Serial.println(len); Serial.flush();
+                        Serial.print(F("reuse at ")); Serial.println(address); Serial.flush();
                     #endif
-                    len++;
-                    if(len > 0x0F) {
-                        #ifdef ASB_DEBUG
-                            Serial.print(F("length exceeded")); Serial.println(); Serial.flush();
-                        #endif
-                        return 0;
-                    }
+                    asbEEPROM.update(address+1, len);
+                    asbEEPROM.update(address, (id << 4));
+                    return asbEEPROM.commit() ? address : 0;
                 }
-                #ifdef ASB_DEBUG
-                    Serial.print(F("final length")); Serial.println(len); Serial.flush();
-                #endif
+            }
 
-                check  = (id << 4) | len;
-                
-                #ifdef ASB_DEBUG
-                    Serial.print(F("ID is now ")); Serial.println(check, HEX); Serial.flush();
-                #endif
-                EEPROM.write(address, check);
+            address += len;
+        }
+        asbEEPROM.commit();
+
+        #ifdef ASB_DEBUG
+            Serial.print(F("Space < length")); Serial.println(); Serial.flush();
+        #endif
+        return 0;
+    }
+
+    unsigned int ASB::cfgNextBlock(unsigned int address, byte id) {
+        byte len;
+
+        if(_cfgAddrStart >= _cfgAddrStop || id == 0 || id > 0x0F) return 0;
+
+        if(address == 0) {
+            address = _cfgAddrStart+2; //bytes 1+2 are our ID
+        }else{
+            len = cfgBlockLength(address);
+            if(len == 0) return 0;
+            address += len;
+        }
+
+        while((len = cfgBlockLength(address)) > 0) {
+            if((asbEEPROM.read(address) & 0xF0) == (id << 4)) return address;
+            address += len;
+        }
+        return 0;
+    }
+
+    bool ASB::cfgFree(unsigned int address) {
+        unsigned int check = _cfgAddrStart+2;
+        byte len;
+
+        //Make sure we got the start of a used block
+        while((len = cfgBlockLength(check)) > 0 && check < address) check += len;
+        if(len == 0 || check != address || asbEEPROM.read(address) == ASB_CFG_FREE) return false;
+
+        asbEEPROM.transaction();
+        asbEEPROM.update(address, ASB_CFG_FREE);
+        cfgMerge(address); //Preceding free blocks are merged on the next allocation
+        return asbEEPROM.commit();
+    }
+
+    unsigned int ASB::cfgCompact(void) {
+        unsigned int address = _cfgAddrStart+2; //bytes 1+2 are our ID
+        unsigned int gap = 0; //First free block in front of address, 0 if none
+        unsigned int moved = 0;
+        unsigned int prev;
+        byte len,free,i;
+
+        if(_cfgAddrStart >= _cfgAddrStop) return 0;
+
+        while((len = cfgBlockLength(address)) > 0) {
+            if(asbEEPROM.read(address) == ASB_CFG_FREE) {
+                len = cfgMerge(address);
+                if(len == 0) break; //Free space reached the end of the chain
+                if(gap == 0) gap = address;
+                address += len;
+                continue;
+            }
 
-                return address;
+            //Swap places with one free block at a time, so a transaction never exceeds the block plus one header
+            while(gap != 0 && gap < address) {
+                prev = gap;
+                while((free = cfgBlockLength(prev)) > 0 && prev + free < address) prev += free;
+                if(free == 0 || prev + free != address) return moved; //Broken chain
+
+                asbEEPROM.transaction();
+                //prev is below address, so copying upwards is safe
+                for(i=0; i<len; i++) asbEEPROM.update(prev+i, asbEEPROM.read(address+i));
+                asbEEPROM.update(prev+len, ASB_CFG_FREE);
+                asbEEPROM.update(prev+len+1, free);
+                if(!asbEEPROM.commit()) return moved;
+
+                moved += len;
+                address = prev;
             }
+            if(gap != 0) gap = address + len;
+            address += len;
+        }
+
+        if(gap != 0) asbEEPROM.update(gap, 0xFF);
+        return moved;
+    }
 
-            len = ((1 << (check & 0x0F)) + 5);
-            if((check & 0xF0) == 0x00 && len >= bytes) { //block is marked as free and has enough free space
-                //@TODO try to split into multiple blocks
-                return address;
-            //@TODO check if adjacent block is also free
+    void ASB::cfgStats(asbCfgStats &stats) {
+        unsigned int address = _cfgAddrStart+2; //bytes 1+2 are our ID
+        byte len;
+
+        stats = asbCfgStats();
+        if(_cfgAddrStart >= _cfgAddrStop) return;
+
+        while((len = cfgBlockLength(address)) > 0) {
+            if(asbEEPROM.read(address) == ASB_CFG_FREE) {
+                stats.freeBlocks++;
+                stats.freeBytes += len;
+                if(len > stats.freeLargest) stats.freeLargest = len;
             }else{
-                address += len;
+                stats.usedBlocks++;
+                stats.usedBytes += len;
             }
-        }while(address+bytes < _cfgAddrStop);
-        return 0;
+            address += len;
+        }
+
+        if(address <= _cfgAddrStop) stats.tailBytes = _cfgAddrStop - address + 1;
+    }
+
+    void *ASB::arenaAlloc(ASB_IO *module, unsigned int bytes) {
+        byte i, slot = ASB_MODNUM;
+        unsigned int offset = 0, tail;
+        int delta;
+
+        for(i=0; i<ASB_MODNUM; i++) {
+            if(_module[i] == module) {
+                slot = i;
+                break;
+            }
+            offset += _arenaSize[i];
+        }
+        if(slot == ASB_MODNUM || module == NULL) return NULL;
+
+        //Keep following slices aligned, this is a no-op on AVR
+        bytes = (bytes + alignof(long) - 1) & ~(unsigned int)(alignof(long) - 1);
+
+        delta = (int)bytes - (int)_arenaSize[slot];
+        if(delta > 0 && (unsigned int)delta > (ASB_ARENA - _arenaUsed)) {
+            #ifdef ASB_DEBUG
+                Serial.print(F("Arena full")); Serial.println(); Serial.flush();
+            #endif
+            return NULL;
+        }
+
+        //Move slices of following modules
+        tail = _arenaUsed - offset - _arenaSize[slot];
+        if(delta != 0 && tail > 0) {
+            memmove(&_arena[offset + bytes], &_arena[offset + _arenaSize[slot]], tail);
+            for(i=slot+1; i<ASB_MODNUM; i++) {
+                if(_module[i] != NULL && _arenaSize[i] > 0) _module[i]->cfgRelocate(delta);
+            }
+        }
+
+        _arenaSize[slot] = bytes;
+        _arenaUsed += delta;
+
+        if(bytes == 0) return NULL;
+        memset(&_arena[offset], 0, bytes);
+        return &_arena[offset];
+    }
+
+    unsigned int ASB::arenaUsed(void) {
+        return _arenaUsed;
+    }
+
+    unsigned int ASB::arenaAvailable(void) {
+        return ASB_ARENA - _arenaUsed;
     }
 
     byte ASB::asbSend(asbMeta meta, byte len, byte *data) {
@@ -181,6 +383,8 @@
 
         for(signed char busId=0; busId<ASB_BUSNUM; busId++) {
             if(_busAddr[busId] != NULL && busId != skip) {
+                //Routed group packets only go where someone listens
+                if(skip >= 0 && type == ASB_PKGTYPE_MULTICAST && !memberMatch(busId, target)) continue;
                 state = _busAddr[busId]->asbSend(type, target, source, port, len, data);
                 if(!state) errors++;
             }
@@ -196,11 +400,20 @@
             pkg.len = len;
             for(i=0; i<len; i++) pkg.data[i] = data[i];
 
+            if(_capture != NULL) _capture->record(pkg);
             asbProcess(pkg);
         }
         return errors;
     }
 
+    bool ASB::asbQueue(byte type, unsigned int target, byte len, const byte *data) {
+        return _queue.push(type, target, -1, len, data);
+    }
+
+    bool ASB::asbQueue(byte type, unsigned int target, char port, byte len, const byte *data) {
+        return _queue.push(type, target, port, len, data);
+    }
+
     bool ASB::asbReceive(asbPacket &pkg) {
         return asbReceive(pkg, true);
     }
@@ -219,9 +432,11 @@
                 if(check) {
                     pkg.meta.busId = busId;
 
+                    if(_capture != NULL) _capture->record(pkg);
                     asbProcess(pkg);
 
-                    if(routing) {
+                    //Memberships are announced per interface
+                    if(routing && (pkg.len < 1 || pkg.data[0] != ASB_CMD_MEMBER)) {
                         //Resend to every interface except the one we received it on
                         asbSend(pkg.meta.type, pkg.meta.target, pkg.meta.source, pkg.meta.port, pkg.len, pkg.data, pkg.meta.busId);
                     }
@@ -234,16 +449,47 @@
     }
 
     void ASB::asbProcess(asbPacket &pkg) {
-        byte i;
+        byte i, slot, cmd;
         byte data[8];
+        asbHook hook;
         
         //Internal logic
         if(pkg.len >= 1) {
             switch(pkg.data[0]) {
                 case ASB_CMD_PING:
-                    if(pkg.meta.type != ASB_PKGTYPE_UNICAST || pkg.meta.target != _nodeId) break;
+                    if(pkg.meta.type != ASB_PKGTYPE_UNICAST || pkg.meta.target != _nodeId || pkg.meta.busId < 0) break;
+                    //Echo the payload, e.g. a sequence number
                     data[0] = ASB_CMD_PONG;
-                    _busAddr[pkg.meta.busId]->asbSend(ASB_PKGTYPE_UNICAST, pkg.meta.source, _nodeId, pkg.meta.port, 1, data);
+                    for(i=1; i<pkg.len; i++) data[i] = pkg.data[i];
+                    _busAddr[pkg.meta.busId]->asbSend(ASB_PKGTYPE_UNICAST, pkg.meta.source, _nodeId, pkg.meta.port, pkg.len, data);
+                break;
+                case ASB_CMD_UTIL:
+                    //Answers are longer than requests
+                    if(pkg.meta.type != ASB_PKGTYPE_UNICAST || pkg.meta.target != _nodeId || pkg.len != 1 || pkg.meta.busId < 0) break;
+                    data[0] = ASB_CMD_UTIL;
+                    for(i=0; i<ASB_BUSNUM && i<7; i++) data[1+i] = busUtilization(i);
+                    _busAddr[pkg.meta.busId]->asbSend(ASB_PKGTYPE_UNICAST, pkg.meta.source, _nodeId, pkg.meta.port, 1+i, data);
+                break;
+                #if ASB_MEMBER_REFRESH > 0
+                case ASB_CMD_MEMBER:
+                    if(pkg.meta.type != ASB_PKGTYPE_BROADCAST || pkg.meta.busId < 0) break;
+                    if(pkg.len != 1 && pkg.len != 1 + ASB_MEMBER_BITS/8) break;
+                    memberStore(pkg);
+                break;
+                #endif
+                case ASB_CMD_1B:
+                case ASB_CMD_PER:
+                    if(pkg.meta.type != ASB_PKGTYPE_MULTICAST || pkg.len != 2) break;
+                    cacheStore(pkg.meta.target, pkg.data[0], pkg.data[1]);
+                    requestDrop(pkg.meta.target); //We got what we would have asked for
+                break;
+                case ASB_CMD_REQ:
+                    if(pkg.meta.type != ASB_PKGTYPE_MULTICAST || pkg.len != 1) break;
+                    requestDrop(pkg.meta.target); //The answer will reach us too
+                    if(_cachePolicy == ASB_CACHE_NEVER) break;
+                    if(_cachePolicy == ASB_CACHE_RANGE && (pkg.meta.target < _cacheFirst || pkg.meta.target > _cacheLast)) break;
+                    if(!cacheGet(pkg.meta.target, data[0], data[1])) break;
+                    asbSend(ASB_PKGTYPE_MULTICAST, pkg.meta.target, 2, data);
                 break;
                 //@todo config
                 //@todo nodeid
@@ -251,26 +497,363 @@
         }
 
         //modules
-        for(i=0; i<ASB_MODNUM; i++) {
-            if(_module[i] != NULL) {
-                Serial.print(F("exec")); Serial.println(); Serial.flush();
-                _module[i]->process(pkg);
+        if(!_dispatchValid) dispatchBuild();
+        cmd = ASB_IO_CMD((pkg.len > 0) ? pkg.data[0] : 0);
+
+        if(_dispatchItems == 0xFF) { //Too many subscriptions, everyone gets everything
+            for(i=0; i<ASB_MODNUM; i++) {
+                if(_module[i] != NULL && (_dispatchCmds[i] & cmd)) _module[i]->process(pkg);
+            }
+        }else{
+            //Modules for all targets (0) are sorted first
+            for(i=0; i<_dispatchItems && _dispatch[i].target == 0; i++) {
+                slot = _dispatch[i].item;
+                if(_module[slot] != NULL && (_dispatchCmds[slot] & cmd)) _module[slot]->process(pkg);
+            }
+            if(pkg.meta.target != 0) {
+                for(i=asbIoIndexFind(_dispatch, _dispatchItems, pkg.meta.target); i<_dispatchItems && _dispatch[i].target == pkg.meta.target; i++) {
+                    slot = _dispatch[i].item;
+                    if(_module[slot] != NULL && (_dispatchCmds[slot] & cmd)) _module[slot]->process(pkg);
+                }
             }
         }
 
         //Hooked functions
         for(i = 0; i<ASB_HOOKNUM; i++) {
-            if(_hooks[i].execute != 0) {
-                if(
-                    (_hooks[i].type == 0xFF || _hooks[i].type == pkg.meta.type) &&
-                    (_hooks[i].target == 0  || _hooks[i].target == pkg.meta.target) &&
-                    (_hooks[i].port == -1   || _hooks[i].port == pkg.meta.port) &&
-                    (_hooks[i].firstByte == 0xFF || (pkg.len > 0 && _hooks[i].firstByte == pkg.data[0]))
-                ) {
-                    _hooks[i].execute(pkg);
+            if(_hooks[i].execute != 0 && hookMatch(_hooks[i], pkg)) {
+                _hooks[i].execute(pkg);
+            }
+        }
+
+        //Hooks stored in flash
+        for(i = 0; i<_hookTableItems; i++) {
+            memcpy_P(&hook, &_hookTable[i], sizeof(asbHook));
+            if(hook.execute != 0 && hookMatch(hook, pkg)) {
+                hook.execute(pkg);
+            }
+        }
+    }
+
+    #if ASB_CACHENUM > 0
+    void ASB::cacheStore(unsigned int target, byte cmd, byte value) {
+        byte i;
+
+        if(target == 0) return;
+        for(i=0; i<ASB_CACHENUM; i++) {
+            if(_cache[i].target == target) break;
+        }
+        if(i == ASB_CACHENUM) {
+            i = _cacheNext;
+            _cacheNext = (_cacheNext + 1) % ASB_CACHENUM;
+        }
+        _cache[i].target = target;
+        _cache[i].cmd = cmd;
+        _cache[i].value = value;
+    }
+
+    bool ASB::cacheGet(unsigned int target, byte &cmd, byte &value) {
+        if(target == 0) return false;
+        for(byte i=0; i<ASB_CACHENUM; i++) {
+            if(_cache[i].target == target) {
+                cmd = _cache[i].cmd;
+                value = _cache[i].value;
+                return true;
+            }
+        }
+        return false;
+    }
+    #else
+    void ASB::cacheStore(unsigned int target, byte cmd, byte value) {
+    }
+
+    bool ASB::cacheGet(unsigned int target, byte &cmd, byte &value) {
+        return false;
+    }
+    #endif
+
+    void ASB::captureAttach(ASB_CAPTURE *capture) {
+        _capture = capture;
+    }
+
+    void ASB::cachePolicy(byte policy) {
+        cachePolicy(policy, 0x0001, 0xFFFF);
+    }
+
+    void ASB::cachePolicy(byte policy, unsigned int first, unsigned int last) {
+        _cachePolicy = policy;
+        _cacheFirst = first;
+        _cacheLast = last;
+        memberUpdate(-1);
+    }
+
+    void ASB::asbRequest(unsigned int target) {
+        byte i;
+
+        for(i=0; i<_reqItems; i++) {
+            if(_reqQueue[i] == target) return;
+        }
+
+        if(ASB_BOOT_WINDOW > 0 && _reqItems < ASB_REQNUM) {
+            _reqQueue[_reqItems++] = target;
+            requestStart();
+            return;
+        }
+
+        byte data[1] = {ASB_CMD_REQ};
+        asbSend(ASB_PKGTYPE_MULTICAST, target, sizeof(data), data);
+    }
+
+    void ASB::requestStart(void) {
+        if(_reqTimer >= 0) return;
+
+        if(ASB_BOOT_WINDOW > 0) {
+            //Spread consecutive node IDs evenly over the window
+            unsigned long delay = (40503UL * _nodeId) & 0xFFFF;
+            delay = (delay * ASB_BOOT_WINDOW) >> 16;
+            _reqTimer = timerAttach(delay, ASB_REQ_GAP, requestTimer, this, 0);
+            if(_reqTimer >= 0) return;
+        }
+
+        //No delay or no free timer, send everything now
+        while(requestNext());
+    }
+
+    bool ASB::requestNext(void) {
+        byte data[1];
+
+        for(byte busId=0; busId<ASB_BUSNUM; busId++) {
+            if(_bootPending[busId]) {
+                _bootPending[busId] = false;
+                if(_busAddr[busId] == 0x00) continue;
+                data[0] = ASB_CMD_BOOT;
+                _busAddr[busId]->asbSend(ASB_PKGTYPE_BROADCAST, 0x00, _nodeId, -1, sizeof(data), data);
+                return true;
+            }
+        }
+
+        #if ASB_MEMBER_REFRESH > 0
+        for(byte busId=0; busId<ASB_BUSNUM; busId++) {
+            if(_memberPending[busId]) {
+                _memberPending[busId] = false;
+                if(_busAddr[busId] == 0x00) continue;
+                memberSend(busId);
+                return true;
+            }
+        }
+        #endif
+
+        if(_reqItems == 0) return false;
+
+        unsigned int target = _reqQueue[0];
+        requestDrop(target);
+        data[0] = ASB_CMD_REQ;
+        asbSend(ASB_PKGTYPE_MULTICAST, target, sizeof(data), data);
+        return true;
+    }
+
+    void ASB::requestDrop(unsigned int target) {
+        for(byte i=0; i<_reqItems; i++) {
+            if(_reqQueue[i] == target) {
+                _reqItems--;
+                for(; i<_reqItems; i++) _reqQueue[i] = _reqQueue[i+1]; //Keep order
+                return;
+            }
+        }
+    }
+
+    void ASB::requestTimer(void *arg, byte data) {
+        ASB *controller = (ASB *)arg;
+
+        if(controller->requestNext()) return;
+
+        //Queue is empty, wait for the next announcement
+        controller->timerDetach(controller->_reqTimer);
+        controller->_reqTimer = -1;
+    }
+
+    #if ASB_MEMBER_REFRESH > 0
+    /**
+     * Mark the bit of a group in a membership bitmap
+     * @param bits bitmap of ASB_MEMBER_BITS
+     * @param target group target
+     */
+    static void memberSet(byte *bits, unsigned int target) {
+        byte bit = asbMemberBit(target);
+        bits[bit >> 3] |= 0x80 >> (bit & 7);
+    }
+
+    /**
+     * Command classes sent to groups, everything else is only sent to nodes or broadcast
+     */
+    static const byte memberCmds = (byte)~(ASB_IO_CMD(ASB_CMD_BOOT) | ASB_IO_CMD(ASB_CMD_PING) | ASB_IO_CMD(ASB_CMD_CFG_READ));
+
+    /**
+     * Add the groups a hook listens to
+     * @param hook asbHook to check
+     * @param bits bitmap of ASB_MEMBER_BITS
+     * @return bool false if it listens to every group
+     */
+    static bool memberHook(const asbHook &hook, byte *bits) {
+        if(hook.execute == 0) return true;
+        if(hook.type != 0xFF && hook.type != ASB_PKGTYPE_MULTICAST) return true;
+        if(hook.firstByte != 0xFF && !(ASB_IO_CMD(hook.firstByte) & memberCmds)) return true;
+        if(hook.target == 0) return false;
+        memberSet(bits, hook.target);
+        return true;
+    }
+
+    void ASB::memberUpdate(signed char skip) {
+        bool pending = false;
+
+        for(signed char busId=0; busId<ASB_BUSNUM; busId++) {
+            if(_busAddr[busId] != 0x00 && busId != skip) {
+                _memberPending[busId] = true;
+                pending = true;
+            }
+        }
+        if(pending) requestStart();
+    }
+
+    void ASB::memberSend(byte busId) {
+        byte data[1 + ASB_MEMBER_BITS/8] = {ASB_CMD_MEMBER};
+
+        //Without bitmap the announcement means every group
+        byte len = memberCollect(busId, &data[1]) ? sizeof(data) : 1;
+        _busAddr[busId]->asbSend(ASB_PKGTYPE_BROADCAST, 0x00, _nodeId, -1, len, data);
+    }
+
+    bool ASB::memberCollect(byte busId, byte *bits) {
+        asbHook hook;
+        byte i, slot;
+
+        //Answering requests needs the state of every group
+        if(_cachePolicy != ASB_CACHE_NEVER) return false;
+
+        if(!_dispatchValid) dispatchBuild();
+        if(_dispatchItems == 0xFF) return false;
+        for(i=0; i<_dispatchItems; i++) {
+            slot = _dispatch[i].item;
+            if(_module[slot] == NULL || !(_dispatchCmds[slot] & memberCmds)) continue;
+            if(_dispatch[i].target == 0) return false;
+            memberSet(bits, _dispatch[i].target);
+        }
+
+        for(i=0; i<ASB_HOOKNUM; i++) {
+            if(!memberHook(_hooks[i], bits)) return false;
+        }
+        for(i=0; i<_hookTableItems; i++) {
+            memcpy_P(&hook, &_hookTable[i], sizeof(asbHook));
+            if(!memberHook(hook, bits)) return false;
+        }
+
+        //Groups we route to other interfaces
+        for(slot=0; slot<ASB_BUSNUM; slot++) {
+            if(slot == busId || _busAddr[slot] == 0x00) continue;
+            if(_member[slot].seen == 0) {
+                //Silent for a whole period, probably older firmware
+                if(_memberTicks > 0) return false;
+                continue; //Still booting
+            }
+            for(i=0; i<ASB_MEMBER_BITS/8; i++) bits[i] |= _member[slot].fresh[i] | _member[slot].old[i];
+        }
+        return true;
+    }
+
+    void ASB::memberStore(asbPacket &pkg) {
+        asbMember &member = _member[(byte)pkg.meta.busId];
+        bool grown = (member.seen == 0);
+        byte i, bits;
+
+        for(i=0; i<ASB_MEMBER_BITS/8; i++) {
+            bits = (pkg.len == 1) ? 0xFF : pkg.data[1+i];
+            if(bits & ~(member.fresh[i] | member.old[i])) grown = true;
+            member.fresh[i] |= bits;
+        }
+        member.seen |= 0x01;
+
+        //New members behind this interface, routers in front of the others need to know
+        if(grown) memberUpdate(pkg.meta.busId);
+    }
+
+    bool ASB::memberMatch(signed char busId, unsigned int target) {
+        if(busId < 0 || busId >= ASB_BUSNUM) return true;
+
+        const asbMember &member = _member[(byte)busId];
+        if(member.seen == 0) return true;
+
+        byte bit = asbMemberBit(target);
+        return ((member.fresh[bit >> 3] | member.old[bit >> 3]) & (0x80 >> (bit & 7))) != 0;
+    }
+
+    void ASB::memberTimer(void *arg, byte data) {
+        ASB *controller = (ASB *)arg;
+
+        //Age every second period, so a single lost announcement goes unnoticed
+        controller->_memberTicks = (controller->_memberTicks == 1) ? 2 : 1;
+        if(controller->_memberTicks == 2) {
+            for(byte busId=0; busId<ASB_BUSNUM; busId++) {
+                asbMember &member = controller->_member[busId];
+                for(byte i=0; i<ASB_MEMBER_BITS/8; i++) {
+                    member.old[i] = member.fresh[i];
+                    member.fresh[i] = 0;
                 }
+                member.seen = (member.seen << 1) & 0x02;
             }
         }
+        controller->memberUpdate(-1);
+    }
+    #else
+    void ASB::memberUpdate(signed char skip) {
+    }
+
+    bool ASB::memberMatch(signed char busId, unsigned int target) {
+        return true;
+    }
+    #endif
+
+    void ASB::dispatchUpdate(void) {
+        _dispatchValid = false;
+        memberUpdate(-1);
+    }
+
+    void ASB::dispatchBuild(void) {
+        unsigned int target;
+        byte i, n, items = 0;
+
+        _dispatchValid = true;
+        for(i=0; i<ASB_MODNUM; i++) {
+            if(_module[i] == NULL) continue;
+            _dispatchCmds[i] = _module[i]->cfgCommands();
+
+            for(n=0; _module[i]->cfgTarget(n, target); n++) {
+                //Modules return sorted targets, skip duplicates
+                if(n > 0 && items > 0 && _dispatch[items-1].item == i && _dispatch[items-1].target == target) continue;
+
+                if(items >= ASB_DISPATCHNUM) {
+                    #ifdef ASB_DEBUG
+                        Serial.print(F("Too many subscriptions")); Serial.println(); Serial.flush();
+                    #endif
+                    _dispatchItems = 0xFF;
+                    return;
+                }
+                _dispatch[items].target = target;
+                _dispatch[items].item = i;
+                items++;
+            }
+        }
+
+        //Sorting is stable, so modules keep their slot order per target
+        asbIoIndexSort(_dispatch, items);
+        _dispatchItems = items;
+    }
+
+    bool ASB::hookMatch(const asbHook &hook, asbPacket &pkg) {
+        return (
+            (hook.type == 0xFF || hook.type == pkg.meta.type) &&
+            (hook.target == 0  || hook.target == pkg.meta.target) &&
+            (hook.port == -1   || hook.port == pkg.meta.port) &&
+            (hook.firstByte == 0xFF || (pkg.len > 0 && hook.firstByte == pkg.data[0]))
+        );
     }
 
     bool ASB::hookAttach(byte type, unsigned int target, char port, byte firstByte, void (*function)(asbPacket&)) {
@@ -281,59 +864,45 @@
                 _hooks[i].port = port;
                 _hooks[i].firstByte = firstByte;
                 _hooks[i].execute = function;
+                memberUpdate(-1);
                 return true;
             }
         }
         return false;
     }
 
+    void ASB::hookTable(const asbHook *table, byte items) {
+        _hookTable = table;
+        _hookTableItems = items;
+        memberUpdate(-1);
+    }
+
     bool ASB::hookAttachModule(ASB_IO *module) {
         for(byte i=0; i<ASB_MODNUM; i++) {
             if(_module[i] == NULL) {
                 module->_control = this;
                 _module[i] = (ASB_IO *)module;
+                dispatchUpdate();
 
                 byte id = module->_cfgId;
+                unsigned int address = 0;
+                byte num = 0;
 
-                //Read configuration
-                if(_cfgAddrStart < _cfgAddrStop && id < 128) {
-                    id <<= 4;
-                    unsigned int address = _cfgAddrStart+2; //bytes 1+2 are our ID
-                    byte check,len,num=0;
-
-                    //Round 1 - count objects
-                    do {
-                        check = EEPROM.read(address);
-                        len = ((1 << (check & 0x0F)) + 5);
-                        if((check & 0xF0) == id) { //this is probably related to our module
-                            num++;
-                        }
-                        address += len;
-                    }while(address < _cfgAddrStop && check != 0xFF && check != 0x00);
-
-                    if(
-                        num > 0 && 
-                        module->cfgReset() && 
-                        module->cfgReserve(num)
-                    ) {
-                        //Round 2 - read objects
-                        address = _cfgAddrStart+2;
-                        do {
-                            check = EEPROM.read(address);
-                            len = ((1 << (check & 0x0F)) + 5);
-                            if((check & 0xF0) == id) { //this is probably related to our module
-                                module->cfgRead(address);
-                            }
-                            address += len;
-                        }while(address < _cfgAddrStop && check != 0xFF && check != 0x00);
-                        return true;
-                    }else{
-                        #ifdef ASB_DEBUG
-                            Serial.print(F("ERR RES ")); 
-                        #endif
-                        return false;
-                    }
+                //Round 1 - count objects
+                while((address = cfgNextBlock(address, id)) != 0) num++;
+
+                //Modules may have flash configuration, so reserve even if nothing is stored
+                if(!module->cfgReset()) return false;
+                if(!module->cfgReserve(num)) {
+                    #ifdef ASB_DEBUG
+                        Serial.print(F("ERR RES ")); 
+                    #endif
+                    return false;
                 }
+
+                //Round 2 - read objects
+                while((address = cfgNextBlock(address, id)) != 0) module->cfgRead(address);
+                return true;
             }
         }
         #ifdef ASB_DEBUG
@@ -346,6 +915,7 @@
         for(byte i=0; i<ASB_MODNUM; i++) {
             if(_module[i] != NULL && _module[i]->_cfgId == id && _module[i]->cfgReset()) {
                 _module[i] = NULL;
+                dispatchUpdate();
                 return true;
             }
         }
@@ -354,12 +924,27 @@
 
     asbPacket ASB::loop(void) {
         byte i;
-        asbPacket pkg;
+        asbPacket pkg, queued;
+
+        //Packets from interrupts, at most one round so they can't keep us here
+        for(i=0; i<ASB_QUEUE_SIZE && _queue.pop(queued); i++) {
+            asbSend(queued.meta.type, queued.meta.target, _nodeId, queued.meta.port, queued.len, queued.data, -1);
+        }
 
         //Packet handling
         //This only receives a single packet. We could loop here, but doing it this way allows the user code to still somewhat execute in environments with a lot of messages…
         asbReceive(pkg);
 
+        //Timers
+        if(_timerItems == 0) {
+            _timerLast = millis();
+        }else{
+            while((unsigned long)(millis() - _timerLast) >= ASB_TIMER_TICK) {
+                _timerLast += ASB_TIMER_TICK;
+                timerTick();
+            }
+        }
+
         //Modules
         for(i=0; i<ASB_MODNUM; i++) {
             if(_module[i] != NULL) {
@@ -370,4 +955,92 @@
         return pkg;
     }
 
+    asbTimerId ASB::timerAttach(unsigned long delay, unsigned long period, asbTimerFunction function, void *arg, byte data) {
+        if(function == NULL) return -1;
+
+        period = (period + ASB_TIMER_TICK - 1) / ASB_TIMER_TICK;
+        if(period > 0xFFFF) return -1;
+
+        for(asbTimerLink i=0; i<ASB_TIMERNUM; i++) {
+            if(_timers[i].execute == NULL) {
+                if(_timerItems == 0) _timerLast = millis();
+
+                _timers[i].execute = function;
+                _timers[i].arg = arg;
+                _timers[i].data = data;
+                _timers[i].period = period;
+                _timerItems++;
+
+                //Count from the last tick, not from now
+                timerInsert(i, (delay + (millis() - _timerLast) + ASB_TIMER_TICK - 1) / ASB_TIMER_TICK);
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    bool ASB::timerDetach(asbTimerId id) {
+        if(id < 0 || id >= ASB_TIMERNUM) return false;
+        asbTimer &timer = _timers[(asbTimerLink)id];
+        if(timer.execute == NULL) return false;
+
+        if(timer.slot != ASB_TIMER_DUE) {
+            asbTimerLink *link = &_wheel[timer.slot];
+            while(*link != 0 && *link != (asbTimerLink)(id + 1)) link = &_timers[*link - 1].next;
+            if(*link != 0) *link = timer.next;
+        }
+
+        timer.execute = NULL;
+        _timerItems--;
+        return true;
+    }
+
+    void ASB::timerInsert(asbTimerLink id, unsigned long ticks) {
+        if(ticks == 0) ticks = 1;
+
+        byte slot = (_timerSlot + ticks) & (ASB_TIMER_SLOTS - 1);
+        _timers[id].rounds = (ticks - 1) / ASB_TIMER_SLOTS;
+        _timers[id].slot = slot;
+        _timers[id].next = _wheel[slot];
+        _wheel[slot] = id + 1;
+    }
+
+    void ASB::timerTick(void) {
+        asbTimerLink due[ASB_TIMERNUM];
+        asbTimerLink items = 0, id, i;
+        asbTimerLink *link;
+
+        _timerSlot = (_timerSlot + 1) & (ASB_TIMER_SLOTS - 1);
+
+        //Unlink expired timers first, their functions may change the wheel
+        link = &_wheel[_timerSlot];
+        while(*link != 0) {
+            id = *link - 1;
+            if(_timers[id].rounds > 0) {
+                _timers[id].rounds--;
+                link = &_timers[id].next;
+            }else{
+                *link = _timers[id].next;
+                _timers[id].slot = ASB_TIMER_DUE;
+                due[items++] = id;
+            }
+        }
+
+        for(i=0; i<items; i++) {
+            id = due[i];
+            //Skip timers detached or replaced by an earlier function
+            if(_timers[id].execute == NULL || _timers[id].slot != ASB_TIMER_DUE) continue;
+
+            if(_timers[id].period > 0) {
+                timerInsert(id, _timers[id].period);
+                _timers[id].execute(_timers[id].arg, _timers[id].data);
+            }else{
+                asbTimerFunction function = _timers[id].execute;
+                _timers[id].execute = NULL;
+                _timerItems--;
+                function(_timers[id].arg, _timers[id].data);
+            }
+        }
+    }
+
 #endif /* ASB__C */
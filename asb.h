@@ -23,15 +23,25 @@
     #define ASB__H
     #include "asb_comm.h"
     #include "asb_proto.h"
+    #include "asb_sensor.h"
     #include "asb_hook.h"
+    #include "asb_timer.h"
+    #include "asb_queue.h"
+    #include "asb_eeprom.h"
 
     #include "asb_comm.h"
     #include "asb_can.h"
     #include "asb_uart.h"
+    #include "asb_capture.h"
+    #include "asb_replay.h"
 
+    #include "asb_port.h"
     #include "asb_io.h"
     #include "asb_io_din.h"
     #include "asb_io_dout.h"
+    #include "asb_io_ain.h"
+    #include "asb_probe.h"
+    #include "asb_coro.h"
 
     /**
      * Maximum number of parallel communication interfaces
@@ -74,6 +84,230 @@
         #define ASB_MODNUM 16 //<120!
     #endif
 
+    /**
+     * Maximum number of module subscriptions
+     *
+     * ASB_DISPATCHNUM sets how many group targets of all modules can be
+     * indexed for packet dispatch. Each entry uses 3 bytes of RAM. If more
+     * targets are used every module gets every packet. You can set it to a
+     * integer between 1 and 254. Default is 16.
+     */
+    #ifndef ASB_DISPATCHNUM
+        #define ASB_DISPATCHNUM 16 //<255!
+    #endif
+
+    /**
+     * Number of cached group states
+     *
+     * ASB_CACHENUM sets how many groups the controller remembers the last
+     * ASB_CMD_1B/ASB_CMD_PER value for, see ASB::cachePolicy(). Each entry
+     * uses 4 bytes of RAM, the oldest entry is replaced first. Only nodes
+     * answering ASB_CMD_REQ for others need it, 0 leaves the cache out.
+     * Default is 0.
+     */
+    #ifndef ASB_CACHENUM
+        #define ASB_CACHENUM 0 //<255!
+    #endif
+
+    /**
+     * Group state cache policies
+     */
+    #define ASB_CACHE_NEVER  0 //Do not answer ASB_CMD_REQ
+    #define ASB_CACHE_RANGE  1 //Answer for groups inside a range
+    #define ASB_CACHE_ALWAYS 2 //Answer for every cached group
+
+    /**
+     * Startup announcement window in ms
+     *
+     * BOOT messages and the ASB_CMD_REQ of configured groups are delayed by
+     * up to ASB_BOOT_WINDOW ms. The delay is derived from the node ID, so
+     * nodes powered up together don't all talk at the same time. Set it to
+     * 0 to send them immediately. Default is 500.
+     */
+    #ifndef ASB_BOOT_WINDOW
+        #define ASB_BOOT_WINDOW 500
+    #endif
+
+    /**
+     * Number of queued group requests
+     *
+     * ASB_REQNUM sets how many different groups may wait for their delayed
+     * ASB_CMD_REQ, see ASB::asbRequest(). Each entry uses 2 bytes of RAM.
+     * Requests not fitting are sent immediately. Default is 4.
+     */
+    #ifndef ASB_REQNUM
+        #define ASB_REQNUM 4 //<255!
+    #endif
+
+    /**
+     * Time between queued announcements in ms
+     *
+     * Delayed BOOT messages and requests are sent one at a time with this
+     * gap between them. Default is 20.
+     */
+    #ifndef ASB_REQ_GAP
+        #define ASB_REQ_GAP 20
+    #endif
+
+    /**
+     * Group membership refresh in ms
+     *
+     * Nodes announce the groups their modules and hooks listen to using
+     * ASB_CMD_MEMBER on every interface. This happens with the BOOT
+     * message, after changes and every ASB_MEMBER_REFRESH ms. Routing
+     * nodes only pass multicast packets to interfaces where a member was
+     * announced, groups age out after 2 to 4 periods. Interfaces without
+     * any announcement, e.g. to nodes running older firmware, still get
+     * everything and count as members of every group after the first
+     * period.
+     *
+     * This only pays off on routing nodes with segments that mostly talk
+     * to themselves, and every node of those segments has to announce.
+     * asbsim with 200 nodes in 4 segments and only local switch events
+     * (-g 4 -L 1 -s 0 -e 6 -t 120) counts 8% fewer frames, 9525 instead
+     * of 10356, but the announcements after power up raise the busiest
+     * 100ms window from 31% to 52% and the p99 latency from 1.4ms to
+     * 2.6ms. Each interface uses 15 bytes of RAM, 0 neither announces
+     * nor prunes and leaves the tables out. Default is 0.
+     */
+    #ifndef ASB_MEMBER_REFRESH
+        #define ASB_MEMBER_REFRESH 0
+    #endif
+
+    /**
+     * Size of the module configuration arena
+     *
+     * ASB_ARENA sets the number of bytes reserved inside the controller for
+     * module configuration and runtime data. Modules take their memory from
+     * here instead of the heap, so RAM usage is known at compile time.
+     *
+     * Bytes per item on AVR, configured in EEPROM / flash:
+     *   digital input   20 / 13, ASB_IO_DIN_GESTURE adds 11
+     *   digital output  21 / 12
+     *   analog input    33 / 19
+     *
+     * Default is 128, e.g. 3 inputs and 3 outputs stored in EEPROM. Use
+     * arenaUsed() to check the actual usage of a node.
+     */
+    #ifndef ASB_ARENA
+        #define ASB_ARENA 128
+    #endif
+
+    /**
+     * Configuration block header
+     *
+     * Every configuration block in EEPROM starts with a header of
+     * ASB_CFG_HEADER bytes: The first byte contains the module ID in the
+     * upper nibble, the second byte the total length of the block including
+     * its header. A first byte of 0x00 or 0xFF marks the end of the chain.
+     */
+    #define ASB_CFG_HEADER 2
+
+    /**
+     * Header byte used for free configuration blocks
+     */
+    #define ASB_CFG_FREE 0x0F
+
+    /**
+     * Configuration space statistics
+     * @see ASB::cfgStats()
+     */
+    typedef struct {
+      /**
+       * Number of blocks in use
+       */
+      byte usedBlocks = 0;
+
+      /**
+       * Bytes occupied by blocks in use, including headers
+       */
+      unsigned int usedBytes = 0;
+
+      /**
+       * Number of free blocks inside the chain
+       */
+      byte freeBlocks = 0;
+
+      /**
+       * Bytes occupied by free blocks inside the chain
+       */
+      unsigned int freeBytes = 0;
+
+      /**
+       * Largest free block inside the chain
+       */
+      unsigned int freeLargest = 0;
+
+      /**
+       * Unused bytes behind the end of the chain
+       */
+      unsigned int tailBytes = 0;
+    } asbCfgStats;
+
+    /**
+     * Cached group state
+     * @see ASB::cachePolicy()
+     */
+    typedef struct {
+      /**
+       * Group target, 0 = unused
+       */
+      unsigned int target;
+
+      /**
+       * Last command, ASB_CMD_1B or ASB_CMD_PER
+       */
+      byte cmd;
+
+      /**
+       * Last value
+       */
+      byte value;
+    } asbCacheEntry;
+
+    /**
+     * Groups announced on an interface
+     * @see ASB_MEMBER_REFRESH
+     */
+    typedef struct {
+      /**
+       * Bitmap of the current period, see asbMemberBit()
+       */
+      byte fresh[ASB_MEMBER_BITS/8];
+
+      /**
+       * Bitmap of the previous period
+       */
+      byte old[ASB_MEMBER_BITS/8];
+
+      /**
+       * Announcements received in the current (bit 0) or previous (bit 1) period
+       */
+      byte seen;
+    } asbMember;
+
+    /**
+     * Check a node ID at compile time
+     * @param id Node-ID
+     * @return true if between 0x0001 and 0x07FF
+     */
+    constexpr bool asbNodeIdValid(unsigned int id) {
+        return id >= 0x0001 && id <= 0x07FF;
+    }
+
+    /**
+     * Declare a validated node ID constant
+     *
+     *   ASB_NODE_ID(nodeId, 0x123);
+     *   ASB asb0(nodeId);
+     *
+     * @param name name of the constant
+     * @param id Node-ID between 0x0001 and 0x07FF
+     */
+    #define ASB_NODE_ID(name, id) \
+        constexpr unsigned int name = (id); \
+        static_assert(asbNodeIdValid(name), "Invalid node ID " #name)
+
     /**
      * ASB main controller class
      *
@@ -94,11 +328,253 @@
              */
             asbHook _hooks[ASB_HOOKNUM];
 
+            /**
+             * Array of hooks stored in flash
+             */
+            const asbHook *_hookTable;
+
+            /**
+             * Number of hooks stored in flash
+             */
+            byte _hookTableItems;
+
+            /**
+             * Check if a hook matches a packet
+             * @param hook asbHook to check
+             * @param pkg Packet struct
+             * @return true if hook should be executed
+             */
+            bool hookMatch(const asbHook &hook, asbPacket &pkg);
+
             /**
              * Array of pointers to active modules
              */
             ASB_IO *_module[ASB_MODNUM];
 
+            /**
+             * Module subscriptions sorted by target, item is the module slot
+             */
+            asbIoIndex _dispatch[ASB_DISPATCHNUM];
+
+            /**
+             * Number of subscriptions, 0xFF if they did not fit
+             */
+            byte _dispatchItems=0;
+
+            /**
+             * Subscribed command classes per module slot
+             */
+            byte _dispatchCmds[ASB_MODNUM];
+
+            /**
+             * Subscriptions match the attached modules
+             */
+            bool _dispatchValid=false;
+
+            /**
+             * Collect subscriptions of all modules
+             */
+            void dispatchBuild(void);
+
+            #if ASB_CACHENUM > 0
+            /**
+             * Last state of recently used groups
+             */
+            asbCacheEntry _cache[ASB_CACHENUM];
+
+            /**
+             * Cache entry to replace next
+             */
+            byte _cacheNext=0;
+            #endif
+
+            /**
+             * When to answer ASB_CMD_REQ, ASB_CACHE_*
+             */
+            byte _cachePolicy=ASB_CACHE_NEVER;
+
+            /**
+             * First group answered by ASB_CACHE_RANGE
+             */
+            unsigned int _cacheFirst=0;
+
+            /**
+             * Last group answered by ASB_CACHE_RANGE
+             */
+            unsigned int _cacheLast=0;
+
+            /**
+             * Packets queued by interrupts
+             */
+            ASB_QUEUE _queue;
+
+            /**
+             * Traffic recorder, NULL if not recording
+             */
+            ASB_CAPTURE *_capture=NULL;
+
+            /**
+             * Remember the state of a group
+             * @param target group target
+             * @param cmd ASB_CMD_1B or ASB_CMD_PER
+             * @param value new value
+             */
+            void cacheStore(unsigned int target, byte cmd, byte value);
+
+            /**
+             * Groups waiting for their ASB_CMD_REQ
+             */
+            unsigned int _reqQueue[ASB_REQNUM];
+
+            /**
+             * Number of queued requests
+             */
+            byte _reqItems=0;
+
+            /**
+             * Interfaces waiting for their BOOT message
+             */
+            bool _bootPending[ASB_BUSNUM];
+
+            /**
+             * Timer sending queued announcements, -1 if inactive
+             */
+            asbTimerId _reqTimer=-1;
+
+            #if ASB_MEMBER_REFRESH > 0
+            /**
+             * Groups announced by other nodes on each interface
+             */
+            asbMember _member[ASB_BUSNUM];
+
+            /**
+             * Interfaces waiting for our membership announcement
+             */
+            bool _memberPending[ASB_BUSNUM];
+
+            /**
+             * Timer refreshing and aging memberships, -1 if inactive
+             */
+            asbTimerId _memberTimer=-1;
+
+            /**
+             * 0 before the first refresh, then alternating 1 and 2, tables age on 2
+             */
+            byte _memberTicks=0;
+            #endif
+
+            /**
+             * Announce our memberships again
+             * @param skip busId not to announce on, -1 = announce everywhere
+             */
+            void memberUpdate(signed char skip);
+
+            #if ASB_MEMBER_REFRESH > 0
+
+            /**
+             * Send our membership announcement
+             * @param busId interface to send on
+             */
+            void memberSend(byte busId);
+
+            /**
+             * Add the groups we listen to or route to an interface
+             * @param busId interface the announcement is for
+             * @param bits bitmap to extend
+             * @return bool false if every group is needed
+             */
+            bool memberCollect(byte busId, byte *bits);
+
+            /**
+             * Store an announcement received on an interface
+             * @param pkg ASB_CMD_MEMBER packet
+             */
+            void memberStore(asbPacket &pkg);
+
+            /**
+             * Timer function refreshing and aging memberships
+             * @param arg controller
+             * @param data unused
+             */
+            static void memberTimer(void *arg, byte data);
+            #endif
+
+            /**
+             * Start sending queued announcements after our node delay
+             */
+            void requestStart(void);
+
+            /**
+             * Send the next queued announcement
+             * @return bool false if nothing was left
+             */
+            bool requestNext(void);
+
+            /**
+             * Remove a group from the request queue
+             * @param target group target
+             */
+            void requestDrop(unsigned int target);
+
+            /**
+             * Timer function for queued announcements
+             * @param arg controller
+             * @param data unused
+             */
+            static void requestTimer(void *arg, byte data);
+
+            /**
+             * Array of timers
+             */
+            asbTimer _timers[ASB_TIMERNUM];
+
+            /**
+             * First timer of each wheel slot + 1, 0 = empty
+             */
+            asbTimerLink _wheel[ASB_TIMER_SLOTS];
+
+            /**
+             * Current wheel slot
+             */
+            byte _timerSlot=0;
+
+            /**
+             * Number of active timers
+             */
+            asbTimerLink _timerItems=0;
+
+            /**
+             * millis() of the last tick
+             */
+            unsigned long _timerLast=0;
+
+            /**
+             * Link a timer into the wheel
+             * @param id timer index
+             * @param ticks number of ticks from now, at least 1
+             */
+            void timerInsert(asbTimerLink id, unsigned long ticks);
+
+            /**
+             * Advance the wheel by one tick and call expired timers
+             */
+            void timerTick(void);
+
+            /**
+             * Memory for module configuration, ordered by module slot
+             */
+            alignas(long) byte _arena[ASB_ARENA];
+
+            /**
+             * Bytes of the arena used by each module slot
+             */
+            unsigned int _arenaSize[ASB_MODNUM];
+
+            /**
+             * Bytes of the arena in use
+             */
+            unsigned int _arenaUsed=0;
+
             /**
              * Bus address of this node
              */
@@ -114,14 +590,41 @@
              */
             unsigned int _cfgAddrStop=511;
 
+            /**
+             * Merge free blocks following the free block at address
+             *
+             * If the merged block is the last one in the chain it is
+             * converted into the end marker
+             *
+             * @param address address of a free block
+             * @return byte total length of the merged block, 0 if it became the end
+             */
+            byte cfgMerge(unsigned int address);
+
 
         public:
             /**
              * Constructor reads configuration
+             *
+             * The last ASB_EEPROM_JOURNAL bytes of the space hold the
+             * journal of asbEEPROM.
+             *
              * @param EEPROM start address, usually 0
              * @param EEPROM stop address, usually 511
              */
             ASB(unsigned int start, unsigned int stop);
+
+            /**
+             * Constructor reads configuration, using a default Node-ID
+             *
+             * The default is used if no Node-ID is stored in EEPROM, so
+             * only changed IDs have to be written.
+             *
+             * @param EEPROM start address, usually 0
+             * @param EEPROM stop address, usually 511
+             * @param id default Node-ID between 0x0001 and 0x07FF
+             */
+            ASB(unsigned int start, unsigned int stop, unsigned int id);
             
             /**
              * "Light" Constructor without EEPROM-read
@@ -142,6 +645,12 @@
              */
             bool setNodeId(unsigned int id);
 
+            /**
+             * Get our node ID
+             * @return unsigned int node ID, 0 if not configured
+             */
+            unsigned int getNodeId(void);
+
             /**
              * Attach a bus-object to this controller
              * @param bus Bus object, derived from ASB_COMM
@@ -158,6 +667,31 @@
              */
             bool busDetach(signed char busId);
 
+            /**
+             * Utilization of a bus-object
+             *
+             * Other nodes can ask for this using an unicast ASB_CMD_UTIL, the
+             * answer contains one byte per bus-object starting with busId 0.
+             *
+             * @param busId ID of the bus-object as given by busAttach
+             * @return byte percent, 0xFF if unknown or not attached
+             * @see ASB_COMM::utilization()
+             */
+            byte busUtilization(signed char busId);
+
+            /**
+             * Check if a group has members behind an interface
+             *
+             * Multicast packets are only routed to interfaces where this is
+             * true, see ASB_MEMBER_REFRESH. Hashed groups may give false
+             * positives, but never false negatives.
+             *
+             * @param busId ID of the bus-object as given by busAttach
+             * @param target group target
+             * @return bool true if a member was announced or nothing is known
+             */
+            bool memberMatch(signed char busId, unsigned int target);
+
             /**
              * First EEPROM address to use
              */
@@ -171,12 +705,83 @@
 
             /**
              * Find next free config block with >=size bytes
-             * @param lenth of requested block in bytes
+             *
+             * Free blocks are merged with adjacent free blocks while searching,
+             * larger blocks are split so the remainder stays available.
+             *
+             * @param lenth of requested payload in bytes, header is added internally
              * @param id configuration ID of requesting module
-             * @return unsigned int address, 0 for error
+             * @return unsigned int block address, payload starts at +ASB_CFG_HEADER, 0 for error
              */
             unsigned int cfgFindFreeblock(byte bytes, byte id);
 
+            /**
+             * Find next config block owned by a module
+             * @param address continue after this block, 0 = start at the beginning
+             * @param id configuration ID of the module
+             * @return unsigned int block address, 0 if no more blocks found
+             */
+            unsigned int cfgNextBlock(unsigned int address, byte id);
+
+            /**
+             * Get length of the configuration block at address
+             * @param address block address
+             * @return byte total block length, 0 at end of chain
+             */
+            byte cfgBlockLength(unsigned int address);
+
+            /**
+             * Release a config block
+             * @param address block address as returned by cfgFindFreeblock
+             * @return true if successful
+             */
+            bool cfgFree(unsigned int address);
+
+            /**
+             * Compact the configuration space
+             *
+             * Moves all used blocks to the beginning of the configuration space
+             * so all free space is combined behind the end of the chain. A
+             * block swaps places with one free block per transaction, so
+             * every step fits into ASB_EEPROM_CACHE and power loss leaves a
+             * valid chain.
+             *
+             * @return unsigned int number of bytes moved, counted once per step
+             */
+            unsigned int cfgCompact(void);
+
+            /**
+             * Get fragmentation and utilization of the configuration space
+             * @param stats asbCfgStats-Reference to store results
+             */
+            void cfgStats(asbCfgStats &stats);
+
+            /**
+             * Get memory for module configuration
+             *
+             * Every module owns one slice of the controller arena, a new
+             * request replaces the previous slice. The memory is zeroed.
+             * Slices of other modules may be moved, they are informed
+             * using ASB_IO::cfgRelocate().
+             *
+             * @param module attached ASB_IO module
+             * @param bytes requested size, 0 to release
+             * @return pointer to memory, NULL on errors or if released
+             */
+            void *arenaAlloc(ASB_IO *module, unsigned int bytes);
+
+            /**
+             * Get used bytes of the configuration arena
+             * @return unsigned int used bytes
+             */
+            unsigned int arenaUsed(void);
+
+            /**
+             * Get available bytes of the configuration arena
+             * @return unsigned int available bytes
+             */
+            unsigned int arenaAvailable(void);
+
             /**
              * Send a message to the bus
              * @param meta asbMeta object containing message metadata
@@ -218,6 +823,34 @@
              */
             byte asbSend(byte type, unsigned int target, unsigned int source, char port, byte len, byte *data, signed char skip);
 
+            /**
+             * Send a message from an interrupt
+             *
+             * asbSend() uses the bus interfaces and processes our own
+             * packets, so it must not be called from interrupts. This only
+             * queues the packet, loop() sends all queued packets in order
+             * before receiving. On host builds other threads may use it too.
+             *
+             * @param type 2 bit message type (ASB_PKGTYPE_*)
+             * @param target target address between 0x0001 and 0x07FF/0xFFFF
+             * @param len number of data bytes to send
+             * @param data array of data bytes to send
+             * @return bool false if ASB_QUEUE_SIZE packets are already waiting
+             */
+            bool asbQueue(byte type, unsigned int target, byte len, const byte *data);
+
+            /**
+             * Send a message from an interrupt
+             * @param type 2 bit message type (ASB_PKGTYPE_*)
+             * @param target target address between 0x0001 and 0x07FF/0xFFFF
+             * @param port port address between 0x00 and 0x1F, Unicast only
+             * @param len number of data bytes to send
+             * @param data array of data bytes to send
+             * @return bool false if ASB_QUEUE_SIZE packets are already waiting
+             * @see asbQueue(byte type, unsigned int target, byte len, const byte *data)
+             */
+            bool asbQueue(byte type, unsigned int target, char port, byte len, const byte *data);
+
             /**
              * Receive a message from the bus
              *
@@ -280,6 +913,24 @@
              */
             bool hookAttach(byte type, unsigned int target, char port, byte firstByte, void (*function)(asbPacket&));
 
+            /**
+             * Use a table of hooks stored in flash
+             *
+             * Flash hooks are checked after hooks attached using hookAttach.
+             *
+             * @param table PROGMEM array of hooks, see ASB_HOOK_TABLE
+             * @param items number of hooks in table
+             */
+            void hookTable(const asbHook *table, byte items);
+
+            /**
+             * Use a table of hooks stored in flash
+             * @param table PROGMEM array of hooks, see ASB_HOOK_TABLE
+             */
+            template <size_t N> void hookTable(const asbHook (&table)[N]) {
+                hookTable(table, N);
+            }
+
             /**
              * Attach a module to this controller
              *
@@ -298,10 +949,93 @@
              */
             bool hookDetachModule(byte id);
 
+            /**
+             * Ask other nodes for the state of a group
+             *
+             * Requests are collected and sent one by one after a delay
+             * derived from our node ID, see ASB_BOOT_WINDOW. A group is only
+             * requested once, even if several items use it. If its state
+             * arrives or another node requests it first, our request is
+             * dropped.
+             *
+             * @param target group target
+             */
+            void asbRequest(unsigned int target);
+
+            /**
+             * Answer ASB_CMD_REQ from the group state cache
+             *
+             * Nodes built with ASB_CACHENUM remember the last state of
+             * recently used groups. Usually only one node per group should
+             * answer requests, e.g. a central node using ASB_CACHE_ALWAYS or
+             * nodes splitting the groups between them using ASB_CACHE_RANGE.
+             * Default is ASB_CACHE_NEVER.
+             *
+             * @param policy ASB_CACHE_NEVER or ASB_CACHE_ALWAYS
+             */
+            void cachePolicy(byte policy);
+
+            /**
+             * Answer ASB_CMD_REQ for a range of groups
+             * @param policy ASB_CACHE_*
+             * @param first first group to answer for
+             * @param last last group to answer for
+             */
+            void cachePolicy(byte policy, unsigned int first, unsigned int last);
+
+            /**
+             * Get the cached state of a group
+             * @param target group target
+             * @param cmd reference to store the command, ASB_CMD_1B or ASB_CMD_PER
+             * @param value reference to store the value
+             * @return bool true if the group is cached
+             */
+            bool cacheGet(unsigned int target, byte &cmd, byte &value);
+
+            /**
+             * Record all received and locally sent packets
+             *
+             * Routed packets are only recorded once when received.
+             *
+             * @param capture recorder, begin() must have been called, NULL to stop recording
+             */
+            void captureAttach(ASB_CAPTURE *capture);
+
+            /**
+             * Module subscriptions changed
+             *
+             * Called by modules when targets or commands change, the
+             * dispatch index is rebuilt on the next packet
+             */
+            void dispatchUpdate(void);
+
+            /**
+             * Attach a timer
+             *
+             * The function is called from loop() once the delay has passed
+             * and then every period. Timers are rounded up to multiples of
+             * ASB_TIMER_TICK and may call timerAttach/timerDetach themselves.
+             *
+             * @param delay time until the first call in ms
+             * @param period time between further calls in ms, 0 = one-shot, at most 65535 * ASB_TIMER_TICK (655350 by default)
+             * @param function to call
+             * @param arg pointer passed to function
+             * @param data value passed to function
+             * @return asbTimerId timer ID, -1 if no timer is available or the period is too long
+             */
+            asbTimerId timerAttach(unsigned long delay, unsigned long period, asbTimerFunction function, void *arg, byte data);
+
+            /**
+             * Detach a timer
+             * @param id timer ID as returned by timerAttach
+             * @return true if successfully removed
+             */
+            bool timerDetach(asbTimerId id);
+
             /**
              * Main processing loop
              *
-             * Receives and routes packets, checks inputs, etc
+             * Sends queued packets, receives and routes packets, runs timers, checks inputs, etc
              *
              * @return asbPacket last received packet
              */
@@ -118,6 +118,7 @@
 
         lastErr = _interface.sendMsgBuf(addr, 1, len, data);
         if(lastErr != CAN_OK) return false;
+        utilAdd(frameBits(len));
         return true;
     }
 
@@ -138,8 +139,51 @@
 
         for(byte i=0; i<len; i++) pkg.data[i] = rxBuf[i];
 
+        utilAdd(frameBits(len));
         return true;
     }
 
+    unsigned long ASB_CAN::bitrate(void) {
+        switch(_speed) {
+            case CAN_5KBPS:     return 5000;
+            case CAN_10KBPS:    return 10000;
+            case CAN_20KBPS:    return 20000;
+            #ifdef CAN_25KBPS
+            case CAN_25KBPS:    return 25000;
+            #endif
+            #ifdef CAN_31K25BPS
+            case CAN_31K25BPS:  return 31250;
+            #endif
+            #ifdef CAN_33KBPS
+            case CAN_33KBPS:    return 33333;
+            #endif
+            case CAN_40KBPS:    return 40000;
+            case CAN_50KBPS:    return 50000;
+            case CAN_80KBPS:    return 80000;
+            #ifdef CAN_83K3BPS
+            case CAN_83K3BPS:   return 83333;
+            #endif
+            #ifdef CAN_95KBPS
+            case CAN_95KBPS:    return 95000;
+            #endif
+            case CAN_100KBPS:   return 100000;
+            case CAN_125KBPS:   return 125000;
+            case CAN_200KBPS:   return 200000;
+            case CAN_250KBPS:   return 250000;
+            case CAN_500KBPS:   return 500000;
+            #ifdef CAN_666KBPS
+            case CAN_666KBPS:   return 666666;
+            #endif
+            case CAN_1000KBPS:  return 1000000;
+        }
+        return 0;
+    }
+
+    byte ASB_CAN::frameBits(byte len) {
+        //SOF to CRC may be stuffed after every 4th bit, followed by 13 fixed bits up to the next frame
+        byte stuffed = 54 + 8 * len;
+        return stuffed + (stuffed - 1) / 4 + 13;
+    }
+
 
 #endif /* ASB_CAN__C */
@@ -98,14 +98,14 @@
              * @param canAddr CAN-address
              * @return asbMeta object containing decoded metadata, targst/source==0x00 on errors
              */
-            asbMeta asbCanAddrParse(unsigned long canAddr);
+            static asbMeta asbCanAddrParse(unsigned long canAddr);
 
             /**
              * Assemble a CAN-address based on our adressing format
              * @param meta asbMeta object
              * @return unsigned long CAN-address
              */
-            unsigned long asbCanAddrAssemble(asbMeta meta);
+            static unsigned long asbCanAddrAssemble(asbMeta meta);
             /**
              * Assemble a CAN-address based on our adressing format
              * @param type 2 bit message type (ASB_PKGTYPE_*)
@@ -113,7 +113,7 @@
              * @param source source address between 0x0001 and 0x07FF
              * @return unsigned long CAN-address
              */
-            unsigned long asbCanAddrAssemble(byte type, unsigned int target, unsigned int source);
+            static unsigned long asbCanAddrAssemble(byte type, unsigned int target, unsigned int source);
             /**
              * Assemble a CAN-address based on our adressing format
              * @param type 2 bit message type (ASB_PKGTYPE_*)
@@ -122,7 +122,7 @@
              * @param port port address between 0x00 and 0x1F, Unicast only
              * @return unsigned long CAN-address
              */
-            unsigned long asbCanAddrAssemble(byte type, unsigned int target, unsigned int source, char port);
+            static unsigned long asbCanAddrAssemble(byte type, unsigned int target, unsigned int source, char port);
 
             /**
              * Send message to CAN-bus
@@ -146,6 +146,23 @@
              * @return true if a message was received
              */
             bool asbReceive(asbPacket &pkg);
+
+            /**
+             * Bus speed configured in the constructor
+             * @return unsigned long bits per second, 0 if unknown
+             */
+            unsigned long bitrate(void);
+
+            /**
+             * Bits of an extended frame on the wire
+             *
+             * Assumes worst case bit stuffing and includes the interframe space,
+             * e.g. 160 bits for 8 data bytes.
+             *
+             * @param len number of data bytes (0-8)
+             * @return byte number of bits
+             */
+            static byte frameBits(byte len);
     };
 
 #endif /* ASB_CAN__H */
@@ -0,0 +1,82 @@
+/**
+  aSysBus traffic capture
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASB_CAPTURE__C
+#define ASB_CAPTURE__C
+    #include "asb.h"
+
+    ASB_CAPTURE::ASB_CAPTURE(Print &out) {
+        _out = &out;
+    }
+
+    void ASB_CAPTURE::put32(unsigned long value) {
+        byte buf[4] = {(byte)value, (byte)(value >> 8), (byte)(value >> 16), (byte)(value >> 24)};
+        _out->write(buf, sizeof(buf));
+    }
+
+    void ASB_CAPTURE::begin(void) {
+        put32(ASB_CAPTURE_MAGIC);
+        put32(0x00040002);          //Version 2.4
+        put32(0);                   //Time zone
+        put32(0);                   //Accuracy
+        put32(ASB_CAPTURE_FRAME);   //Snapshot length
+        put32(ASB_CAPTURE_LINKTYPE);
+
+        _last = micros();
+        _sec = 0;
+        _usec = 0;
+        packets = 0;
+    }
+
+    bool ASB_CAPTURE::record(const asbPacket &pkg) {
+        byte frame[ASB_CAPTURE_FRAME];
+        byte i;
+
+        //Includes the extended frame flag
+        unsigned long id = ASB_CAN::asbCanAddrAssemble(pkg.meta);
+        if(id == 0 || pkg.len < 0 || pkg.len > 8) return false;
+
+        unsigned long now = micros();
+        _usec += now - _last;
+        _last = now;
+        while(_usec >= 1000000) {
+            _usec -= 1000000;
+            _sec++;
+        }
+
+        //struct can_frame, identifier in network byte order without the error flag
+        frame[0] = (id >> 24) & 0xDF;
+        frame[1] = id >> 16;
+        frame[2] = id >> 8;
+        frame[3] = id;
+        frame[4] = pkg.len;
+        frame[5] = frame[7] = 0;
+        frame[ASB_CAPTURE_TYPE] = (id >> 29) & 0x01;
+        for(i=0; i<8; i++) frame[8+i] = (i < pkg.len) ? pkg.data[i] : 0;
+
+        put32(_sec);
+        put32(_usec);
+        put32(ASB_CAPTURE_FRAME);
+        put32(ASB_CAPTURE_FRAME);
+        _out->write(frame, sizeof(frame));
+        packets++;
+        return true;
+    }
+
+#endif /* ASB_CAPTURE__C */
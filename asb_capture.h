@@ -0,0 +1,109 @@
+/**
+  aSysBus traffic capture
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASB_CAPTURE__H
+#define ASB_CAPTURE__H
+    #include "asb.h"
+
+    /**
+     * Capture file format
+     *
+     * Captures are pcap files using the SocketCAN link type, so they can be
+     * opened with Wireshark or tcpdump. Every packet is stored as a 16 byte
+     * CAN frame using the extended identifier of ASB_CAN::asbCanAddrAssemble().
+     *
+     * The packet type uses bits 28 and 29 of that identifier, but SocketCAN
+     * uses bit 29 as error flag. The identifier is stored with the 29 bits
+     * a CAN controller transmits, the upper type bit goes to the reserved
+     * byte at offset 6 of the frame, so ASB_REPLAY restores unicast packets.
+     */
+    #define ASB_CAPTURE_TYPE     6          //Frame byte holding bit 29 of the identifier
+    #define ASB_CAPTURE_MAGIC    0xA1B2C3D4 //Microsecond time stamps
+    #define ASB_CAPTURE_MAGIC_NS 0xA1B23C4D //Nanosecond time stamps
+    #define ASB_CAPTURE_LINKTYPE 227        //LINKTYPE_CAN_SOCKETCAN
+    #define ASB_CAPTURE_FRAME    16         //Size of struct can_frame
+    #define ASB_CAPTURE_HEADER   24         //Size of the file header
+    #define ASB_CAPTURE_RECORD   16         //Size of a record header
+
+    /**
+     * Traffic recorder
+     *
+     * Writes all packets received or sent by a controller to a Print, e.g.
+     * a file on a SD card or a spare serial port.
+     *
+     * @see ASB::captureAttach()
+     */
+    class ASB_CAPTURE {
+        private:
+            /**
+             * Output
+             */
+            Print *_out;
+
+            /**
+             * micros() of the last record
+             */
+            unsigned long _last = 0;
+
+            /**
+             * Time stamp of the last record, seconds
+             */
+            unsigned long _sec = 0;
+
+            /**
+             * Time stamp of the last record, microseconds
+             */
+            unsigned long _usec = 0;
+
+            /**
+             * Write a 32 bit value, little endian
+             * @param value value
+             */
+            void put32(unsigned long value);
+
+        public:
+            /**
+             * Number of packets written
+             */
+            unsigned long packets = 0;
+
+            /**
+             * Constructor
+             * @param out Print object receiving the capture
+             */
+            ASB_CAPTURE(Print &out);
+
+            /**
+             * Write the file header, time stamps start at 0
+             */
+            void begin(void);
+
+            /**
+             * Write a packet
+             *
+             * Time stamps are based on micros() and stay correct as long as
+             * packets are recorded at least every 70 minutes.
+             *
+             * @param pkg packet
+             * @return bool false if the packet can't be expressed as CAN frame
+             */
+            bool record(const asbPacket &pkg);
+    };
+
+#endif /* ASB_CAPTURE__H */
@@ -22,5 +22,53 @@
 #ifndef ASB_COMM__C
 #define ASB_COMM__C
     #include "asb_comm.h"
+
+    unsigned long ASB_COMM::bitrate(void) {
+        return 0;
+    }
+
+    void ASB_COMM::utilRotate(void) {
+        const unsigned long step = ASB_COMM_WINDOW / ASB_COMM_SLOTS;
+        unsigned long now = millis();
+        byte i;
+
+        if((now - _utilStart) >= ASB_COMM_WINDOW) {
+            //Idle for a whole window
+            for(i=0; i<ASB_COMM_SLOTS; i++) _utilBits[i] = 0;
+            _utilStart = now;
+            return;
+        }
+
+        while((now - _utilStart) >= step) {
+            _utilStart += step;
+            _utilSlot = (_utilSlot + 1) % ASB_COMM_SLOTS;
+            _utilBits[_utilSlot] = 0;
+        }
+    }
+
+    void ASB_COMM::utilAdd(unsigned int bits) {
+        utilRotate();
+        _utilBits[_utilSlot] += bits;
+    }
+
+    byte ASB_COMM::utilization(void) {
+        const unsigned long step = ASB_COMM_WINDOW / ASB_COMM_SLOTS;
+        unsigned long rate = bitrate();
+        unsigned long bits = 0, capacity, ms;
+        byte i;
+
+        if(rate == 0) return 0xFF;
+        utilRotate();
+
+        //Older steps are complete, the current one counts as far as it got
+        ms = (ASB_COMM_SLOTS - 1) * step + (millis() - _utilStart);
+        if(ms > millis()) ms = millis();
+        for(i=0; i<ASB_COMM_SLOTS; i++) bits += _utilBits[i];
+
+        capacity = (rate / 10) * ms / 100;
+        if(capacity == 0) return 0;
+        if(bits >= capacity) return 100;
+        return bits * 100 / capacity;
+    }
 #endif /* ASB_COMM__C */
 
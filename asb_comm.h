@@ -24,6 +24,25 @@
     #include "asb_proto.h"
     #include "asb_comm.h"
 
+    /**
+     * Utilization window in ms
+     *
+     * ASB_COMM_WINDOW sets the time ASB_COMM::utilization() is calculated
+     * for. The window moves in ASB_COMM_SLOTS steps. Default is 1000.
+     */
+    #ifndef ASB_COMM_WINDOW
+        #define ASB_COMM_WINDOW 1000
+    #endif
+
+    /**
+     * Number of steps of the utilization window
+     *
+     * Each step takes 4 bytes of RAM per interface. Default is 4.
+     */
+    #ifndef ASB_COMM_SLOTS
+        #define ASB_COMM_SLOTS 4
+    #endif
+
     /**
      * Class defining the base functions for any communication interface
      * This is a template and can not be used by itself
@@ -63,6 +82,50 @@
              * @return true if a message was received
              */
             virtual bool asbReceive(asbPacket &pkg)=0;
+
+            /**
+             * Raw speed of the interface
+             * @return unsigned long bits per second, 0 if unknown
+             */
+            virtual unsigned long bitrate(void);
+
+            /**
+             * Share of time the interface was busy sending or receiving
+             *
+             * Calculated from the estimated wire time of all packets seen
+             * during the last ASB_COMM_WINDOW ms.
+             *
+             * @return byte percent, 0xFF if the bitrate is unknown
+             */
+            byte utilization(void);
+
+        protected:
+            /**
+             * Count traffic for utilization()
+             * @param bits number of bits on the wire
+             */
+            void utilAdd(unsigned int bits);
+
+        private:
+            /**
+             * Bits seen per step of the window
+             */
+            unsigned long _utilBits[ASB_COMM_SLOTS] = {};
+
+            /**
+             * millis() when the current step started
+             */
+            unsigned long _utilStart = 0;
+
+            /**
+             * Current step
+             */
+            byte _utilSlot = 0;
+
+            /**
+             * Move the window to the current time
+             */
+            void utilRotate(void);
     };
 
 #endif /* ASB_COMM__H */
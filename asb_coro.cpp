@@ -0,0 +1,204 @@
+/**
+  aSysBus coroutine requests - awaitable answers for host builds
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASB_CORO__C
+    #define ASB_CORO__C
+
+    #include <Arduino.h>
+    #include <inttypes.h>
+    #include <asb.h>
+
+    #ifdef __cpp_impl_coroutine
+        asbCoroRequest::asbCoroRequest(ASB_CORO *coro, unsigned int target, char port, byte len, const byte *data, unsigned long timeout) {
+            _coro = coro;
+            _target = target;
+            _port = port;
+            _len = len;
+            _data = data;
+            _timeout = timeout;
+            _reply.valid = false;
+            _reply.rtt = 0;
+            _next = NULL;
+        }
+
+        void asbCoroRequest::await_suspend(std::coroutine_handle<> handle) {
+            _handle = handle;
+            _coro->start(this);
+        }
+
+        ASB_CORO::ASB_CORO(byte cfgId) {
+            _cfgId = cfgId;
+        }
+
+        bool ASB_CORO::cfgRead(unsigned int address) {
+            return false;
+        }
+
+        bool ASB_CORO::cfgReset(void) {
+            asbCoroRequest *req;
+
+            while((req = _first) != NULL) {
+                _first = req->_next;
+                finish(req);
+            }
+            _last = NULL;
+            _pending = 0;
+            _queued = 0;
+
+            //Detached modules aren't looped anymore
+            while((req = _doneFirst) != NULL) {
+                _doneFirst = req->_next;
+                if(_doneFirst == NULL) _doneLast = NULL;
+                req->_handle.resume();
+            }
+            return true;
+        }
+
+        bool ASB_CORO::cfgReserve(byte objects) {
+            return true;
+        }
+
+        bool ASB_CORO::cfgTarget(byte n, unsigned int &target) {
+            if(_control == NULL) return false;
+            target = _control->getNodeId();
+            return n == 0;
+        }
+
+        asbCoroRequest ASB_CORO::request(unsigned int target, char port, byte len, const byte *data, unsigned long timeout) {
+            return asbCoroRequest(this, target, port, len, data, timeout);
+        }
+
+        unsigned int ASB_CORO::pending(void) {
+            return _pending;
+        }
+
+        void ASB_CORO::start(asbCoroRequest *req) {
+            if(_control == NULL || req->_len > 8) {
+                finish(req);
+                return;
+            }
+
+            //Listed first, a local answer could arrive while sending
+            req->_next = NULL;
+            if(_last != NULL) {
+                _last->_next = req;
+            }else{
+                _first = req;
+            }
+            _last = req;
+            _pending++;
+            req->_sent = micros();
+            req->_queued = true;
+            _queued++;
+
+            //Older requests go first
+            if(_queued == 1) send(req);
+        }
+
+        bool ASB_CORO::send(asbCoroRequest *req) {
+            req->_queued = false;
+            _queued--;
+            unsigned long sent = micros();
+            if(_control->asbSend(ASB_PKGTYPE_UNICAST, req->_target, req->_port, req->_len, (byte *)req->_data) == 0) {
+                //Unless already answered
+                if(!req->_reply.valid) req->_sent = sent;
+                return true;
+            }
+            req->_queued = true;
+            _queued++;
+            return false;
+        }
+
+        void ASB_CORO::unlink(asbCoroRequest *req, asbCoroRequest *prev) {
+            if(prev != NULL) {
+                prev->_next = req->_next;
+            }else{
+                _first = req->_next;
+            }
+            if(_last == req) _last = prev;
+            _pending--;
+            if(req->_queued) {
+                req->_queued = false;
+                _queued--;
+            }
+        }
+
+        void ASB_CORO::finish(asbCoroRequest *req) {
+            req->_next = NULL;
+            if(_doneLast != NULL) {
+                _doneLast->_next = req;
+            }else{
+                _doneFirst = req;
+            }
+            _doneLast = req;
+        }
+
+        bool ASB_CORO::process(asbPacket &pkg) {
+            if(_control == NULL) return false;
+            if(pkg.meta.type != ASB_PKGTYPE_UNICAST || pkg.meta.target != _control->getNodeId()) return true;
+
+            asbCoroRequest *prev = NULL, *req;
+            for(req=_first; req != NULL; prev=req, req=req->_next) {
+                if(req->_queued || req->_target != pkg.meta.source || req->_port != pkg.meta.port) continue;
+
+                unlink(req, prev);
+
+                req->_reply.valid = true;
+                req->_reply.rtt = micros() - req->_sent;
+                req->_reply.pkg = pkg;
+                finish(req);
+                break; //Oldest request only
+            }
+            return true;
+        }
+
+        bool ASB_CORO::loop(void) {
+            if(_control == NULL) return false;
+            unsigned long now = micros();
+            asbCoroRequest *prev = NULL, *req, *next;
+            bool busy = false;
+
+            for(req=_first; req != NULL; req=next) {
+                next = req->_next;
+                if((now - req->_sent) < (req->_timeout * 1000UL)) {
+                    //Stop at the first one still not fitting, keeps the order
+                    if(req->_queued && !busy) busy = !send(req);
+                    prev = req;
+                    continue;
+                }
+
+                req->_reply.rtt = req->_queued ? 0 : now - req->_sent;
+                unlink(req, prev);
+                finish(req);
+            }
+
+            //Resumed coroutines may finish more requests, they wait for the next call
+            req = _doneFirst;
+            _doneFirst = NULL;
+            _doneLast = NULL;
+            while(req != NULL) {
+                next = req->_next;
+                req->_handle.resume();
+                req = next;
+            }
+            return true;
+        }
+    #endif
+
+#endif /* ASB_CORO__C */
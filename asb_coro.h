@@ -0,0 +1,264 @@
+/**
+  aSysBus coroutine requests - awaitable answers for host builds
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASB_CORO__H
+#define ASB_CORO__H
+
+    #include <Arduino.h>
+    #include <inttypes.h>
+    #include <asb.h>
+
+    /**
+     * Coroutines need C++20, e.g. gateways on a POSIX host built with
+     * -std=c++20. Other builds, including the Arduino IDE, skip this module.
+     */
+    #ifdef __cpp_impl_coroutine
+        #include <coroutine>
+        #include <exception>
+
+        /**
+         * Answer to a request
+         */
+        typedef struct {
+          /**
+           * An answer arrived in time
+           */
+          bool valid;
+
+          /**
+           * Round trip time in us, the time waited without answer, 0 if
+           * the request could not be sent
+           */
+          unsigned long rtt;
+
+          /**
+           * Answer, only set if valid
+           */
+          asbPacket pkg;
+        } asbReply;
+
+        /**
+         * Coroutine without result
+         *
+         * Runs until its first co_await when called and frees itself when
+         * it returns, nobody waits for it:
+         *   asbTask poll(ASB_CORO &coro, unsigned int node) {
+         *       byte ping[1] = {ASB_CMD_PING};
+         *       asbReply reply = co_await coro.request(node, 1, sizeof(ping), ping, 100);
+         *       ...
+         *   }
+         */
+        class asbTask {
+            public:
+                struct promise_type {
+                    asbTask get_return_object(void) { return asbTask(); }
+                    std::suspend_never initial_suspend(void) noexcept { return {}; }
+                    std::suspend_never final_suspend(void) noexcept { return {}; }
+                    void return_void(void) {}
+                    void unhandled_exception(void) { std::terminate(); }
+                };
+        };
+
+        class ASB_CORO;
+
+        /**
+         * Request awaited by a coroutine
+         *
+         * Lives in the frame of the waiting coroutine, so requests in flight
+         * need no memory of their own.
+         *
+         * @see ASB_CORO::request()
+         */
+        class asbCoroRequest {
+            friend class ASB_CORO;
+
+            private:
+                ASB_CORO *_coro;
+                unsigned int _target;
+                char _port;
+                byte _len;
+                const byte *_data;
+                unsigned long _timeout;
+
+                /**
+                 * micros() when sent, when requested while still waiting to be sent
+                 */
+                unsigned long _sent;
+
+                /**
+                 * Waiting for a free transmit buffer
+                 */
+                bool _queued;
+
+                asbReply _reply;
+
+                /**
+                 * Waiting coroutine
+                 */
+                std::coroutine_handle<> _handle;
+
+                /**
+                 * Next request in the same list
+                 */
+                asbCoroRequest *_next;
+
+            public:
+                asbCoroRequest(ASB_CORO *coro, unsigned int target, char port, byte len, const byte *data, unsigned long timeout);
+
+                bool await_ready(void) { return false; }
+                void await_suspend(std::coroutine_handle<> handle);
+                asbReply await_resume(void) { return _reply; }
+        };
+
+        /**
+         * Request/response module
+         *
+         * Sends unicast requests and resumes the awaiting coroutine once an
+         * answer from the target arrives on the same port, or the timeout
+         * passed. Many requests may be in flight from one thread, answers
+         * are matched by source and port. Requests to the same target and
+         * port get their answers in the order they were sent.
+         *
+         * Requests which find the transmit buffers full are sent again from
+         * loop() in the order they were made. Their timeout starts when
+         * they are requested and again once they are sent.
+         *
+         * Coroutines are always resumed from loop(), so they may start new
+         * requests right away.
+         *
+         * @see ASB_IO
+         */
+        class ASB_CORO : public ASB_IO {
+            friend class asbCoroRequest;
+
+            private:
+                /**
+                 * Requests waiting for an answer, oldest first
+                 */
+                asbCoroRequest *_first = NULL;
+                asbCoroRequest *_last = NULL;
+
+                /**
+                 * Finished requests waiting to be resumed
+                 */
+                asbCoroRequest *_doneFirst = NULL;
+                asbCoroRequest *_doneLast = NULL;
+
+                /**
+                 * Number of requests waiting for an answer
+                 */
+                unsigned int _pending = 0;
+
+                /**
+                 * Number of requests waiting to be sent
+                 */
+                unsigned int _queued = 0;
+
+                /**
+                 * Try to send a request
+                 * @param req request in the pending list
+                 * @return bool false if the interface is busy
+                 */
+                bool send(asbCoroRequest *req);
+
+                /**
+                 * Remove a request from the pending list
+                 * @param req request
+                 * @param prev request before it, NULL if it is the first one
+                 */
+                void unlink(asbCoroRequest *req, asbCoroRequest *prev);
+
+                /**
+                 * Send a request and wait for its answer
+                 * @param req request
+                 */
+                void start(asbCoroRequest *req);
+
+                /**
+                 * Queue a request to be resumed
+                 * @param req request, already removed from the pending list
+                 */
+                void finish(asbCoroRequest *req);
+
+            public:
+                /**
+                 * Initialize
+                 * @param cfgId module ID, nothing is stored in EEPROM
+                 */
+                ASB_CORO(byte cfgId);
+
+                /**
+                 * Nothing to read from EEPROM
+                 * @return bool always false
+                 */
+                bool cfgRead(unsigned int address);
+
+                /**
+                 * Fail all requests in flight
+                 * @return bool true if successful
+                 */
+                bool cfgReset(void);
+
+                /**
+                 * No configuration to reserve memory for
+                 * @return bool always true
+                 */
+                bool cfgReserve(byte objects);
+
+                /**
+                 * Only packets sent to our node ID are answers
+                 * @param n number of the target, starting at 0
+                 * @param target reference to store the target
+                 * @return bool false if there are no more targets
+                 */
+                bool cfgTarget(byte n, unsigned int &target);
+
+                /**
+                 * Match answers to requests
+                 * @param pkg Packet struct
+                 * @return bool true if successful
+                 */
+                bool process(asbPacket &pkg);
+
+                /**
+                 * Send queued requests, check timeouts and resume finished coroutines
+                 * @return bool true if successful
+                 */
+                bool loop(void);
+
+                /**
+                 * Send a unicast request, use with co_await
+                 * @param target node ID
+                 * @param port port address between 0x00 and 0x1F, the answer uses the same
+                 * @param len number of data bytes to send
+                 * @param data array of data bytes, used until the request is sent
+                 * @param timeout time to wait for the answer in ms
+                 * @return asbCoroRequest awaitable resulting in an asbReply
+                 */
+                asbCoroRequest request(unsigned int target, char port, byte len, const byte *data, unsigned long timeout);
+
+                /**
+                 * Number of requests waiting to be sent or for an answer
+                 * @return unsigned int requests in flight
+                 */
+                unsigned int pending(void);
+        };
+    #endif
+
+#endif /* ASB_CORO__H */
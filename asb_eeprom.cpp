@@ -0,0 +1,271 @@
+/**
+  aSysBus EEPROM access with write-back cache and journal
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASB_EEPROM__C
+#define ASB_EEPROM__C
+    #include "asb_eeprom.h"
+
+    /*
+     * Journal layout:
+     *  0, 1   round counter, low byte first
+     *  2..    records of the current round
+     *
+     * Record layout:
+     *  0      sequence number, 0 for the first record of a round
+     *  1      number of entries (n)
+     *  2..    n * address low, address high, value
+     *  3n+2   CRC16 low
+     *  3n+3   CRC16 high
+     *
+     * The CRC covers the round counter and the record up to the CRC.
+     */
+
+    ASB_EEPROM asbEEPROM;
+
+    unsigned int ASB_EEPROM::crc(unsigned int address, unsigned int len) {
+        unsigned int sum = 0xFFFF;
+        byte i, n, value;
+
+        for(n=0; n<2+len; n++) {
+            if(n < 2) {
+                value = (n == 0) ? (_round & 0xFF) : (_round >> 8);
+            }else{
+                value = EEPROM.read(address+n-2);
+            }
+            sum ^= ((unsigned int)value << 8);
+            for(i=0; i<8; i++) {
+                if(sum & 0x8000) {
+                    sum = (sum << 1) ^ 0x1021;
+                }else{
+                    sum <<= 1;
+                }
+            }
+        }
+        return sum & 0xFFFF;
+    }
+
+    byte ASB_EEPROM::check(unsigned int address) {
+        if(address + 7 > _jStop) return 0;
+
+        byte num = EEPROM.read(address+1);
+        if(num == 0 || num > ASB_EEPROM_CACHE) return 0;
+
+        unsigned int len = 2 + 3*num;
+        if(address + len + 2 > _jStop) return 0;
+
+        unsigned int stored = EEPROM.read(address+len) | ((unsigned int)EEPROM.read(address+len+1) << 8);
+        if(crc(address, len) != stored) return 0;
+
+        return num;
+    }
+
+    unsigned long ASB_EEPROM::filter(unsigned int address) {
+        return 1UL << ((address ^ (address >> 5)) & 31);
+    }
+
+    unsigned int ASB_EEPROM::begin(unsigned int start, unsigned int stop) {
+        unsigned int pos, address;
+        byte num, i;
+
+        _depth = 0;
+        _items = 0;
+        _overflow = false;
+        _seq = 0;
+        _filter = 0;
+        _jStart = 0;
+        _jStop = 0;
+        _jHead = 0;
+
+        //Keep at least the node ID outside of the journal
+        if(ASB_EEPROM_JOURNAL == 0 || stop <= start || (stop - start) < (ASB_EEPROM_JOURNAL + 2)) {
+            #ifdef ASB_DEBUG
+                Serial.print(F("Journal disabled")); Serial.println(); Serial.flush();
+            #endif
+            return stop;
+        }
+
+        //stop is the last usable address
+        _jStop = stop + 1;
+        _jStart = _jStop - ASB_EEPROM_JOURNAL;
+        _round = EEPROM.read(_jStart) | ((unsigned int)EEPROM.read(_jStart+1) << 8);
+
+        //Records of this round start at the beginning and have continuous sequence numbers
+        pos = _jStart + 2;
+        while((num = check(pos)) > 0 && EEPROM.read(pos) == _seq) {
+            for(i=0; i<num; i++) {
+                address = EEPROM.read(pos+2+3*i) | ((unsigned int)EEPROM.read(pos+3+3*i) << 8);
+                _filter |= filter(address);
+            }
+            _seq++;
+            pos += 4 + 3*num;
+        }
+        _jHead = pos;
+
+        #ifdef ASB_DEBUG
+            Serial.print(F("Journal records ")); Serial.println(_seq); Serial.flush();
+        #endif
+
+        return _jStart - 1;
+    }
+
+    byte ASB_EEPROM::stored(unsigned int address) {
+        unsigned int pos, entry;
+        byte value = EEPROM.read(address);
+        byte num, i;
+
+        if(_jStop == 0 || !(_filter & filter(address))) return value;
+
+        //Newest record wins
+        for(pos = _jStart + 2; pos < _jHead; pos += 4 + 3*num) {
+            num = EEPROM.read(pos+1);
+            for(i=0; i<num; i++) {
+                entry = pos + 2 + 3*i;
+                if((EEPROM.read(entry) | ((unsigned int)EEPROM.read(entry+1) << 8)) == address) value = EEPROM.read(entry+2);
+            }
+        }
+        return value;
+    }
+
+    void ASB_EEPROM::rotate(void) {
+        unsigned int pos, entry, later, address, end;
+        byte num, i, n, j;
+        bool newer;
+
+        //Records behind an invalid one are ignored like in begin()
+        for(end = _jStart + 2; end < _jHead && (num = check(end)) > 0; end += 4 + 3*num);
+
+        //Only the last value of an address is written, power loss just repeats this on the next commit
+        for(pos = _jStart + 2; pos < end; pos += 4 + 3*num) {
+            num = EEPROM.read(pos+1);
+            for(i=0; i<num; i++) {
+                entry = pos + 2 + 3*i;
+                address = EEPROM.read(entry) | ((unsigned int)EEPROM.read(entry+1) << 8);
+
+                newer = false;
+                for(later = pos + 4 + 3*num; later < end && !newer; later += 4 + 3*n) {
+                    n = EEPROM.read(later+1);
+                    for(j=0; j<n; j++) {
+                        if((EEPROM.read(later+2+3*j) | ((unsigned int)EEPROM.read(later+3+3*j) << 8)) == address) newer = true;
+                    }
+                }
+                if(!newer) EEPROM.update(address, EEPROM.read(entry+2));
+            }
+        }
+
+        //Invalidates all records, the high byte first so an interrupted update never repeats an older round
+        _round++;
+        EEPROM.update(_jStart+1, _round >> 8);
+        EEPROM.update(_jStart, _round & 0xFF);
+
+        _jHead = _jStart + 2;
+        _seq = 0;
+        _filter = 0;
+    }
+
+    byte ASB_EEPROM::read(unsigned int address) {
+        for(byte i=_items; i>0; i--) {
+            if(_cache[i-1].address == address) return _cache[i-1].value;
+        }
+        return stored(address);
+    }
+
+    bool ASB_EEPROM::update(unsigned int address, byte value) {
+        if(_jStop > 0 && address >= _jStart && address < _jStop) return false;
+
+        if(_depth == 0) {
+            transaction();
+            update(address, value);
+            return commit();
+        }
+
+        for(byte i=0; i<_items; i++) {
+            if(_cache[i].address == address) {
+                _cache[i].value = value;
+                return true;
+            }
+        }
+
+        if(stored(address) == value) return true;
+
+        if(_items >= ASB_EEPROM_CACHE) {
+            _overflow = true;
+            return false;
+        }
+
+        _cache[_items].address = address;
+        _cache[_items].value = value;
+        _items++;
+        return true;
+    }
+
+    void ASB_EEPROM::transaction(void) {
+        _depth++;
+    }
+
+    bool ASB_EEPROM::commit(void) {
+        unsigned int len, sum;
+        byte i;
+
+        if(_depth == 0) return false;
+        _depth--;
+        if(_depth > 0) return !_overflow;
+
+        if(_overflow) {
+            #ifdef ASB_DEBUG
+                Serial.print(F("Transaction too large")); Serial.println(); Serial.flush();
+            #endif
+            _items = 0;
+            _overflow = false;
+            return false;
+        }
+
+        if(_items == 0) return true;
+
+        if(_jStop == 0) {
+            for(i=0; i<_items; i++) EEPROM.update(_cache[i].address, _cache[i].value);
+            _items = 0;
+            return true;
+        }
+
+        len = 4 + 3*_items;
+        if(_jHead + len > _jStop) rotate();
+
+        //Valid once the CRC is written, until then the previous state stays visible
+        EEPROM.update(_jHead, _seq);
+        EEPROM.update(_jHead+1, _items);
+        for(i=0; i<_items; i++) {
+            EEPROM.update(_jHead+2+3*i, _cache[i].address & 0xFF);
+            EEPROM.update(_jHead+3+3*i, _cache[i].address >> 8);
+            EEPROM.update(_jHead+4+3*i, _cache[i].value);
+            _filter |= filter(_cache[i].address);
+        }
+        sum = crc(_jHead, len-2);
+        EEPROM.update(_jHead+len-2, sum & 0xFF);
+        EEPROM.update(_jHead+len-1, sum >> 8);
+
+        _jHead += len;
+        _seq++;
+        _items = 0;
+
+        //Write in place now if the same transaction would not fit again, power loss from here on keeps this one
+        if(_jHead + len > _jStop) rotate();
+        return true;
+    }
+
+#endif /* ASB_EEPROM__C */
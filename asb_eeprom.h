@@ -0,0 +1,268 @@
+/**
+  aSysBus EEPROM access with write-back cache and journal
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASB_EEPROM__H
+#define ASB_EEPROM__H
+
+    #include <Arduino.h>
+    #include <inttypes.h>
+    #include <EEPROM.h>
+
+    /**
+     * Maximum number of changed bytes per transaction
+     *
+     * ASB_EEPROM_CACHE sets how many changed bytes can be held in RAM before
+     * a transaction has to be committed. Every entry uses 3 bytes of RAM.
+     * Larger transactions will fail to commit. Storing or moving a module
+     * configuration block takes its size plus two block headers, modules
+     * check this at compile time, see ASB_IO::cfgStore(). Default is 24 on
+     * AVR, where the largest block has 14 bytes, and 40 elsewhere as 4 byte
+     * integers make the blocks grow up to 36 bytes.
+     */
+    #ifndef ASB_EEPROM_CACHE
+        #ifdef __AVR__
+            #define ASB_EEPROM_CACHE 24 //<60!
+        #else
+            #define ASB_EEPROM_CACHE 40 //<60!
+        #endif
+    #endif
+
+    /**
+     * Size of the EEPROM journal in bytes
+     *
+     * ASB_EEPROM_JOURNAL sets the number of bytes taken from the end of the
+     * configuration space for the transaction journal. The default of 128
+     * is a quarter of the 512 bytes of an ATmega328, which leaves 382 bytes
+     * for the node ID and module configuration. A larger journal spreads
+     * wear further, see ASB_EEPROM. Must hold the round counter and one
+     * full transaction (6 + 3 * ASB_EEPROM_CACHE bytes), 0 disables the
+     * journal and every commit is written in place. Default is 128.
+     */
+    #ifndef ASB_EEPROM_JOURNAL
+        #define ASB_EEPROM_JOURNAL 128
+    #endif
+
+    #if ASB_EEPROM_JOURNAL > 0 && ASB_EEPROM_JOURNAL < 6 + 3 * ASB_EEPROM_CACHE
+        #error ASB_EEPROM_JOURNAL is too small for ASB_EEPROM_CACHE
+    #endif
+
+    /**
+     * Pending EEPROM change
+     */
+    typedef struct {
+      /**
+       * EEPROM address
+       */
+      unsigned int address;
+
+      /**
+       * New value
+       */
+      byte value;
+    } asbEepromEntry;
+
+    /**
+     * EEPROM access with write-back cache and journaled commits
+     *
+     * Changes are collected in RAM and only bytes which differ from the
+     * current content are written. A commit only appends all changes
+     * together with a CRC to the journal, reads return the newest value
+     * found there. Once the journal has no room for another commit of the
+     * same size every changed address is written in place once with its
+     * last value and a new round starts by incrementing the round counter
+     * stored in front of the journal.
+     *
+     * A byte changed by every commit is therefore written about once per
+     * (ASB_EEPROM_JOURNAL - 2) / (4 + 3 * changes) commits, as is every
+     * journal cell. If power is lost during a commit its record has no
+     * valid CRC, so either all or none of the changes of a transaction
+     * will be visible. Power loss while writing in place keeps the last
+     * record, the next round repeats the in place writes. Records of older
+     * rounds are never used as their CRC includes the round counter.
+     *
+     * This trades total writes for less wear on hot cells: Every change is
+     * written twice plus 4 bytes per record, so the total is 3 to 5 times
+     * that of writing in place. It pays off for a few bytes changed again
+     * and again, with 10000 commits of one byte the most written cell gets
+     * 556 instead of 10000 writes. If changes are spread over 16 addresses
+     * that cell still gets 556 writes instead of 664 while the total rises
+     * from 10000 to 45977, see asbbench wear. Such nodes may disable the
+     * journal with ASB_EEPROM_JOURNAL 0.
+     *
+     * Writes outside of a transaction are committed immediately, put() always
+     * commits the complete object at once. Always read through this class,
+     * EEPROM.read() returns outdated values for addresses changed during
+     * the current round.
+     */
+    class ASB_EEPROM {
+        private:
+            /**
+             * First journal address holding the round counter, 0 if journaling is disabled
+             */
+            unsigned int _jStart;
+
+            /**
+             * Last journal address + 1
+             */
+            unsigned int _jStop;
+
+            /**
+             * Address for the next journal record
+             */
+            unsigned int _jHead;
+
+            /**
+             * Current round
+             */
+            unsigned int _round;
+
+            /**
+             * Sequence number of the next journal record, starting at 0 every round
+             */
+            byte _seq;
+
+            /**
+             * Hashed addresses changed in this round, see filter()
+             */
+            unsigned long _filter;
+
+            /**
+             * Nesting level of open transactions
+             */
+            byte _depth;
+
+            /**
+             * Number of pending changes
+             */
+            byte _items;
+
+            /**
+             * Transaction did not fit into the cache
+             */
+            bool _overflow;
+
+            /**
+             * Pending changes
+             */
+            asbEepromEntry _cache[ASB_EEPROM_CACHE];
+
+            /**
+             * Calculate CRC16 (CCITT) of a journal record including the round
+             * @param address start of the record
+             * @param len number of bytes
+             * @return unsigned int CRC
+             */
+            unsigned int crc(unsigned int address, unsigned int len);
+
+            /**
+             * Check journal record
+             * @param address start of the record
+             * @return byte number of entries, 0 if invalid
+             */
+            byte check(unsigned int address);
+
+            /**
+             * Bit of an address in _filter
+             * @param address EEPROM address
+             * @return unsigned long bit mask
+             */
+            static unsigned long filter(unsigned int address);
+
+            /**
+             * Read a byte including the journal, but not pending changes
+             * @param address EEPROM address
+             * @return byte value
+             */
+            byte stored(unsigned int address);
+
+            /**
+             * Write the newest value of every address of this round in place and start a new round
+             */
+            void rotate(void);
+
+        public:
+            /**
+             * Reserve journal space and finish interrupted transactions
+             * @param start first EEPROM address of the configuration space
+             * @param stop last EEPROM address of the configuration space
+             * @return unsigned int new last address usable for configuration
+             */
+            unsigned int begin(unsigned int start, unsigned int stop);
+
+            /**
+             * Read a byte including pending changes
+             * @param address EEPROM address
+             * @return byte value
+             */
+            byte read(unsigned int address);
+
+            /**
+             * Change a byte
+             * @param address EEPROM address
+             * @param value new value
+             * @return true if successful
+             */
+            bool update(unsigned int address, byte value);
+
+            /**
+             * Start a transaction
+             *
+             * Transactions may be nested, changes are written when the
+             * outermost transaction is committed
+             */
+            void transaction(void);
+
+            /**
+             * Commit a transaction
+             * @return true if all changes have been written
+             */
+            bool commit(void);
+
+            /**
+             * Read an object including pending changes
+             * @param address EEPROM address
+             * @param t object to read into
+             * @return object reference
+             */
+            template <typename T> T &get(unsigned int address, T &t) {
+                byte *ptr = (byte *) &t;
+                for(unsigned int i=0; i<sizeof(T); i++) ptr[i] = read(address+i);
+                return t;
+            }
+
+            /**
+             * Write an object as one transaction
+             * @param address EEPROM address
+             * @param t object to write
+             * @return true if successful
+             */
+            template <typename T> bool put(unsigned int address, const T &t) {
+                const byte *ptr = (const byte *) &t;
+                transaction();
+                for(unsigned int i=0; i<sizeof(T); i++) update(address+i, ptr[i]);
+                return commit();
+            }
+    };
+
+    /**
+     * Shared EEPROM instance used by the controller and all modules
+     */
+    extern ASB_EEPROM asbEEPROM;
+
+#endif /* ASB_EEPROM__H */
@@ -28,6 +28,8 @@
     /**
      * Hook struct
      * Contains address and function to call on RX
+     *
+     * Fields are ordered for aggregate initialization, see ASB_HOOK_TABLE
      */
     typedef struct {
       /**
@@ -37,15 +39,7 @@
        *  0x02 -> Unicast
        *  0xFF -> Everything
        */
-      byte type = 0x01;
-
-      /**
-       * Port
-       * 0x00 - 0x1F
-       * Only used in Unicast Mode
-       * -1 -> Everything
-       */
-      char port = -1;
+      byte type;
 
       /**
        * Target address
@@ -53,13 +47,21 @@
        * Milticast/Broadcast: 0x0001 - 0xFFFF
        * 0x0 -> everything
        */
-      unsigned int target = 0;
+      unsigned int target;
+
+      /**
+       * Port
+       * 0x00 - 0x1F
+       * Only used in Unicast Mode
+       * -1 -> Everything
+       */
+      char port;
 
       /**
        * First message byte, usually ASB_CMD_*
        * 0xFF = everything
        */
-      byte firstByte = 0xFF;
+      byte firstByte;
 
       /**
        * Function to call
@@ -68,5 +70,40 @@
 
     } asbHook;
 
+    /**
+     * Check a single hook at compile time
+     * @param hook asbHook configuration
+     * @return true if valid
+     */
+    constexpr bool asbHookValid(const asbHook &hook) {
+        return (hook.type <= 0x02 || hook.type == 0xFF) &&
+               hook.port >= -1 && hook.port <= 0x1F &&
+               hook.execute != nullptr;
+    }
+
+    /**
+     * Check a table of hooks at compile time
+     * @param table array of asbHook configurations
+     * @param items number of entries
+     * @return true if all entries are valid
+     */
+    constexpr bool asbHookValid(const asbHook *table, unsigned int items) {
+        return items == 0 || (asbHookValid(table[0]) && asbHookValid(table+1, items-1));
+    }
+
+    /**
+     * Declare a validated hook table in flash
+     *
+     * Entries use the same order as ASB::hookAttach:
+     *   ASB_HOOK_TABLE(hooks, {0xFF, 0x1001, -1, ASB_CMD_1B, testLight});
+     *
+     * @param name name of the table
+     * @param ... asbHook initializers
+     */
+    #define ASB_HOOK_TABLE(name, ...) \
+        constexpr asbHook name[] PROGMEM = { __VA_ARGS__ }; \
+        static_assert(sizeof(name)/sizeof(asbHook) < 0xFF, "Too many hooks in " #name); \
+        static_assert(asbHookValid(name, sizeof(name)/sizeof(asbHook)), "Invalid hook in " #name)
+
 #endif /* ASB_HOOK__H */
 
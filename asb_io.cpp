@@ -27,4 +27,97 @@
     #include <EEPROM.h>
     #include <asb.h>
 
+    void asbIoIndexSort(asbIoIndex *index, byte items) {
+        asbIoIndex temp;
+        byte i, j;
+
+        for(i=1; i<items; i++) {
+            temp = index[i];
+            for(j=i; j>0 && index[j-1].target > temp.target; j--) {
+                index[j] = index[j-1];
+            }
+            index[j] = temp;
+        }
+    }
+
+    byte asbIoIndexFind(const asbIoIndex *index, byte items, unsigned int target) {
+        byte low = 0, high = items, mid;
+
+        while(low < high) {
+            mid = low + ((high - low) >> 1);
+            if(index[mid].target < target) {
+                low = mid + 1;
+            }else{
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    bool ASB_IO::cfgStore(const void *cfg, byte bytes) {
+        if(_control == NULL) {
+            #ifdef ASB_DEBUG
+                Serial.println(F("No controller...")); Serial.flush();
+            #endif
+            return false;
+        }
+
+        const byte *data = (const byte *) cfg;
+        unsigned int address;
+        byte i;
+
+        if(data[0] == 0xFF) {
+            #ifdef ASB_DEBUG
+                Serial.println(F("No pin...")); Serial.flush();
+            #endif
+            return false;
+        }
+
+        asbEEPROM.transaction();
+        address = _control->cfgFindFreeblock(bytes, _cfgId);
+        if(address == 0) {
+            asbEEPROM.commit();
+            #ifdef ASB_DEBUG
+                Serial.println(F("Got no address...")); Serial.flush();
+            #endif
+            return false;
+        }
+        address += ASB_CFG_HEADER; //Skip header
+        for(i=0; i<bytes; i++) asbEEPROM.update(address+i, data[i]);
+
+        return asbEEPROM.commit(); //Header and data are written together
+    }
+
+    bool ASB_IO::cfgLoad(unsigned int address, void *cfg, byte bytes) {
+        if(_control == NULL) return false;
+        byte *data = (byte *) cfg;
+        byte len = _control->cfgBlockLength(address);
+        byte i;
+
+        if(len == 0) return false;
+        len -= ASB_CFG_HEADER;
+        for(i=0; i<bytes; i++) data[i] = (i < len) ? asbEEPROM.read(address+ASB_CFG_HEADER+i) : 0;
+        return true;
+    }
+
+    bool ASB_IO::cfgFreePin(byte pin) {
+        if(_control == NULL) return false;
+        unsigned int address = 0;
+        bool found = false;
+
+        //pin is the first byte of our configuration
+        while((address = _control->cfgNextBlock(address, _cfgId)) != 0) {
+            if(asbEEPROM.read(address+ASB_CFG_HEADER) == pin && _control->cfgFree(address)) found = true;
+        }
+
+        if(!found) return false;
+        return cfgReload();
+    }
+
+    bool ASB_IO::cfgReload(void) {
+        if(_control == NULL) return false;
+        _control->hookDetachModule(_cfgId);
+        return _control->hookAttachModule(this);
+    }
+
 #endif /* ASB_IO__C */
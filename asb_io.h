@@ -29,6 +29,48 @@
 
     class ASB; //ASB has not been defined yet
 
+    /**
+     * Target index entry
+     * Maps a group target to a module item, kept sorted by target
+     */
+    typedef struct {
+
+      /**
+       * Target address of the item
+       */
+      unsigned int target;
+
+      /**
+       * Item index inside the module
+       */
+      byte item;
+
+    } asbIoIndex;
+
+    /**
+     * Command class bit for module subscriptions
+     * Commands are grouped in 8 classes of 32, see ASB_IO::cfgCommands()
+     * @param cmd ASB_CMD_*
+     */
+    #define ASB_IO_CMD(cmd) (1 << ((cmd) >> 5))
+
+    /**
+     * Sort a target index
+     * Only used when configuration changes, so insertion sort is fine
+     * @param index array of entries
+     * @param items number of entries
+     */
+    void asbIoIndexSort(asbIoIndex *index, byte items);
+
+    /**
+     * Find the first index entry for a target
+     * @param index sorted array of entries
+     * @param items number of entries
+     * @param target target address
+     * @return byte position of the first entry not below target, items if none
+     */
+    byte asbIoIndexFind(const asbIoIndex *index, byte items, unsigned int target);
+
     /**
      * IO Module
      */
@@ -72,6 +114,39 @@
              */
             virtual bool cfgReserve(byte objects)=0;
 
+            /**
+             * Configuration memory was moved inside the controller arena
+             * @param offset number of bytes the memory was moved
+             * @see ASB::arenaAlloc()
+             */
+            virtual void cfgRelocate(int offset) {}
+
+            /**
+             * Commands this module wants to receive
+             *
+             * The controller only calls process() for packets matching a
+             * subscribed command class and target. Modules must call
+             * ASB::dispatchUpdate() if their subscriptions change.
+             *
+             * @return byte ASB_IO_CMD() bits, default is everything
+             */
+            virtual byte cfgCommands(void) { return 0xFF; }
+
+            /**
+             * Group targets this module wants to receive
+             *
+             * Targets should be returned in ascending order, 0 matches
+             * every target. Default is everything.
+             *
+             * @param n number of the target, starting at 0
+             * @param target reference to store the target
+             * @return bool false if there are no more targets
+             */
+            virtual bool cfgTarget(byte n, unsigned int &target) {
+                target = 0;
+                return n == 0;
+            }
+
             /**
              * Process incoming packet
              * @param pkg Packet struct
@@ -87,7 +162,55 @@
              */
             virtual bool loop(void)=0;
 
+        protected:
+            /**
+             * Write a configuration object to a new block of our ID
+             *
+             * Block header, data and a split free remainder are committed as
+             * one transaction, so bytes plus two times ASB_CFG_HEADER must not
+             * exceed ASB_EEPROM_CACHE. Modules check this with a static_assert
+             * next to their cfgWrite().
+             *
+             * @param cfg configuration, the first byte has to be the pin
+             * @param bytes size of the configuration
+             * @return bool true if successful
+             */
+            bool cfgStore(const void *cfg, byte bytes);
+
+            /**
+             * Read a configuration object from a block of our ID
+             *
+             * Blocks written before fields were appended to the object are
+             * shorter, the missing fields are read as 0.
+             *
+             * @param address block address
+             * @param cfg configuration to read into
+             * @param bytes size of the configuration
+             * @return bool true if the block is valid
+             */
+            bool cfgLoad(unsigned int address, void *cfg, byte bytes);
 
+            /**
+             * Free all blocks of our ID configuring a pin
+             * @param pin first byte of the configuration
+             * @return bool true if a block was freed and the configuration reloaded
+             */
+            bool cfgFreePin(byte pin);
+
+            /**
+             * Read our configuration again after it was changed
+             * @return bool true if successful
+             */
+            bool cfgReload(void);
+
+            /**
+             * Move a pointer into the controller arena, see cfgRelocate()
+             * @param ptr pointer, NULL is kept
+             * @param offset number of bytes the memory was moved
+             */
+            template <typename T> static void cfgMove(T *&ptr, int offset) {
+                if(ptr != NULL) ptr = (T *) ((byte *) ptr + offset);
+            }
     };
 
 #endif /* ASB_IO__H */
@@ -0,0 +1,265 @@
+/**
+  aSysBus io module - analog inputs
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASB_IO_AIN__C
+    #define ASB_IO_AIN__C
+
+    #include <Arduino.h>
+    #include <inttypes.h>
+    #include <asb.h>
+
+    ASB_IO_AIN::ASB_IO_AIN(byte cfgId) {
+        _cfgId=cfgId;
+    }
+
+    ASB_IO_AIN::ASB_IO_AIN(byte cfgId, const asbIoAIn *table, byte items) {
+        _cfgId=cfgId;
+        _table=table;
+        _tableItems=items;
+    }
+
+    bool ASB_IO_AIN::cfgItem(byte i, asbIoAIn &cfg) {
+        if(_state == NULL || i >= (_tableItems + _items) || !_state[i].active) return false;
+
+        if(i < _tableItems) {
+            memcpy_P(&cfg, &_table[i], sizeof(asbIoAIn));
+        }else{
+            cfg = _config[i - _tableItems];
+        }
+        return true;
+    }
+
+    void ASB_IO_AIN::cfgInit(byte i, asbIoAIn &cfg) {
+        ::pinMode(cfg.pin, INPUT);
+
+        _state[i].sent = false;
+        _state[i].force = false;
+        _state[i].count = 0;
+        _state[i].sum = 0;
+        _state[i].value = 0;
+        _state[i].since = millis();
+        _state[i].active = true;
+        _indexed = false;
+        _control->dispatchUpdate();
+    }
+
+    bool ASB_IO_AIN::cfgRead(unsigned int address) {
+        if(_control == NULL || _state == NULL) return false;
+        byte temp,i;
+
+        byte check = asbEEPROM.read(address);
+        if(check == 0xFF || check == 0x00) return false;
+        if(((check & 0xF0) >> 4) != _cfgId) return false;
+
+        for(temp=_tableItems; temp<(_tableItems + _items); temp++) {
+            if(!_state[temp].active) { //Slot is free
+                asbIoAIn &cfg = _config[temp - _tableItems];
+                if(!cfgLoad(address, &cfg, sizeof(cfg))) return false;
+                if(!asbIoAInValid(cfg)) return false;
+
+                //EEPROM overrides flash configuration for the same pin
+                for(i=0; i<_tableItems; i++) {
+                    if(pgm_read_byte(&_table[i].pin) == cfg.pin) _state[i].active = false;
+                }
+
+                cfgInit(temp, cfg);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static_assert(sizeof(asbIoAIn) + 2 * ASB_CFG_HEADER <= ASB_EEPROM_CACHE, "ASB_EEPROM_CACHE is too small for asbIoAIn");
+
+    bool ASB_IO_AIN::cfgWrite(asbIoAIn &cfg) {
+        return cfgStore(&cfg, sizeof(cfg));
+    }
+
+    bool ASB_IO_AIN::cfgReset(void) {
+        if(_state != NULL && _control != NULL) _control->arenaAlloc(this, 0);
+        _config = NULL;
+        _state = NULL;
+        _index = NULL;
+        _indexItems = 0;
+        _indexed = false;
+        if(_control != NULL) _control->dispatchUpdate();
+        _items = 0;
+        return true;
+    }
+
+    bool ASB_IO_AIN::cfgReserve(byte objects) {
+        asbIoAIn cfg;
+        byte i;
+
+        cfgReset();
+        if((_tableItems + objects) == 0) return true;
+        if(_control == NULL) return false;
+
+        //Runtime data first as it holds longs, followed by EEPROM configuration and target index
+        _state = (asbIoAInState *) _control->arenaAlloc(this, objects * sizeof(asbIoAIn) + (_tableItems + objects) * (sizeof(asbIoIndex) + sizeof(asbIoAInState)));
+        if(_state == NULL) return false;
+        _config = (asbIoAIn *) &_state[_tableItems + objects];
+        _index = (asbIoIndex *) &_config[objects];
+        if(objects == 0) _config = NULL;
+        _items = objects;
+
+        //Flash inputs are used directly, EEPROM may override them later
+        for(i=0; i<_tableItems; i++) {
+            memcpy_P(&cfg, &_table[i], sizeof(asbIoAIn));
+            if(asbIoAInValid(cfg)) cfgInit(i, cfg);
+        }
+        return true;
+    }
+
+    void ASB_IO_AIN::cfgIndex(void) {
+        asbIoAIn cfg;
+        byte i;
+
+        _indexItems = 0;
+        for(i=0; i<(_tableItems + _items); i++) {
+            if(cfgItem(i, cfg)) {
+                _index[_indexItems].target = cfg.target;
+                _index[_indexItems].item = i;
+                _indexItems++;
+            }
+        }
+        asbIoIndexSort(_index, _indexItems);
+        _indexed = true;
+    }
+
+    byte ASB_IO_AIN::cfgCommands(void) {
+        return ASB_IO_CMD(ASB_CMD_REQ);
+    }
+
+    bool ASB_IO_AIN::cfgTarget(byte n, unsigned int &target) {
+        if(!_indexed) cfgIndex();
+        if(n >= _indexItems) return false;
+        target = _index[n].target;
+        return true;
+    }
+
+    void ASB_IO_AIN::cfgRelocate(int offset) {
+        cfgMove(_config, offset);
+        cfgMove(_state, offset);
+        cfgMove(_index, offset);
+    }
+
+    bool ASB_IO_AIN::process(asbPacket &pkg) {
+        if(_control == NULL) return false;
+        asbIoAIn cfg;
+        byte i,p;
+
+        if(pkg.len != 1 || pkg.data[0] != ASB_CMD_REQ || pkg.meta.type != ASB_PKGTYPE_MULTICAST) return true;
+
+        if(!_indexed) cfgIndex();
+        for(p=asbIoIndexFind(_index, _indexItems, pkg.meta.target); p<_indexItems && _index[p].target == pkg.meta.target; p++) {
+            i = _index[p].item;
+            if(!cfgItem(i, cfg)) continue;
+
+            if(_state[i].sent) {
+                send(i, cfg, _state[i].value);
+            }else{
+                _state[i].force = true; //Answer with the first value
+            }
+        }
+        return true;
+    }
+
+    bool ASB_IO_AIN::loop(void) {
+        if(_control == NULL) return false;
+        asbIoAIn cfg;
+        byte i;
+        unsigned long now = millis();
+
+        if((unsigned int)((unsigned int)now - _sampled) < ASB_IO_AIN_SAMPLE) return true;
+        _sampled = now;
+
+        for(i=0; i<(_tableItems + _items); i++) {
+            if(cfgItem(i, cfg)) sample(i, cfg, now);
+        }
+        return true;
+    }
+
+    void ASB_IO_AIN::sample(byte i, asbIoAIn &cfg, unsigned long now) {
+        asbIoAInState &state = _state[i];
+        long value, diff;
+
+        state.sum += ::analogRead(cfg.pin);
+        state.count++;
+        if(state.count < cfg.samples) return;
+
+        //Keep 4 bits of the oversampled average, this fits a long for any scale
+        value = ((state.sum << 4) + (state.count >> 1)) / state.count;
+        value = value * cfg.scale / (ASB_IO_AIN_MAX << 4) + cfg.offset;
+        state.sum = 0;
+        state.count = 0;
+
+        if(!state.sent || state.force) {
+            send(i, cfg, value);
+            return;
+        }
+
+        diff = value - state.value;
+        if(diff < 0) diff = -diff;
+        if((unsigned long)diff > cfg.deadband && (now - state.since) >= (cfg.interval * 100UL)) {
+            send(i, cfg, value);
+        }else if(cfg.heartbeat > 0 && (now - state.since) >= (cfg.heartbeat * 1000UL)) {
+            send(i, cfg, value);
+        }
+    }
+
+    void ASB_IO_AIN::send(byte i, asbIoAIn &cfg, long value) {
+        byte data[5];
+        byte len;
+
+        _state[i].value = value;
+        _state[i].sent = true;
+        _state[i].force = false;
+        _state[i].since = millis();
+
+        len = asbSensorEncode(cfg.cmd, data, value);
+        if(len == 0) return;
+
+        _control->asbSend(ASB_PKGTYPE_MULTICAST, cfg.target, len, data);
+    }
+
+    bool ASB_IO_AIN::attach(unsigned int target, byte pin, byte cmd, int scale, int offset) {
+        asbIoAIn cfg = {};
+
+        cfg.target = target;
+        cfg.pin = pin;
+        cfg.cmd = cmd;
+        cfg.scale = scale;
+        cfg.offset = offset;
+        return attach(cfg);
+    }
+
+    bool ASB_IO_AIN::attach(asbIoAIn &cfg) {
+        if(_control == NULL) return false;
+        if(!asbIoAInValid(cfg)) return false;
+        if(_control->arenaAvailable() < (sizeof(asbIoAIn) + sizeof(asbIoIndex) + sizeof(asbIoAInState))) return false;
+        if(!cfgWrite(cfg)) return false;
+        return cfgReload();
+    }
+
+    bool ASB_IO_AIN::detach(byte pin) {
+        return cfgFreePin(pin);
+    }
+
+#endif /* ASB_IO_AIN__C */
@@ -0,0 +1,389 @@
+/**
+  aSysBus io module - analog inputs
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASB_IO_AIN__H
+#define ASB_IO_AIN__H
+
+    #include <Arduino.h>
+    #include <inttypes.h>
+    #include <asb.h>
+
+    /**
+     * Time between samples in ms
+     *
+     * ASB_IO_AIN_SAMPLE sets how often every analog input is read. Values
+     * are calculated from the average of samples readings, so a new value
+     * is available every samples * ASB_IO_AIN_SAMPLE ms. Default is 10.
+     */
+    #ifndef ASB_IO_AIN_SAMPLE
+        #define ASB_IO_AIN_SAMPLE 10
+    #endif
+
+    /**
+     * Highest ADC reading
+     *
+     * Readings are scaled so ASB_IO_AIN_MAX equals the configured scale.
+     * Default is 1023 for the 10 bit AVR ADC.
+     */
+    #ifndef ASB_IO_AIN_MAX
+        #define ASB_IO_AIN_MAX 1023
+    #endif
+
+    /**
+     * Analog input struct
+     * Contains pin numbers and configuration for analog inputs
+     *
+     * This is stored as-is in EEPROM or flash, runtime data is kept in
+     * asbIoAInState. Fields are ordered for aggregate initialization,
+     * new fields must be appended and use 0 as default.
+     */
+    typedef struct {
+
+      /**
+       * Analog pin, e.g. A0
+       */
+      byte pin;
+
+      /**
+       * Target address
+       * Milticast: 0x0001 - 0xFFFF
+       */
+      unsigned int target;
+
+      /**
+       * Sensor command to send, ASB_CMD_S_*
+       */
+      byte cmd;
+
+      /**
+       * Value at ASB_IO_AIN_MAX in units of cmd, e.g. 500 for 0-50.0°C
+       */
+      int scale;
+
+      /**
+       * Value at 0 in units of cmd
+       */
+      int offset;
+
+      /**
+       * Number of readings to average, 0 = 1
+       */
+      byte samples;
+
+      /**
+       * Minimum change in units of cmd to send a new value, 0 = any change
+       */
+      unsigned int deadband;
+
+      /**
+       * Minimum time between two values in 100ms, 0 = no limit
+       */
+      byte interval;
+
+      /**
+       * Send the value again after this time in s, 0 = only on changes
+       */
+      unsigned int heartbeat;
+
+    } asbIoAIn;
+
+    /**
+     * Analog input runtime data
+     */
+    typedef struct {
+
+      /**
+       * Input is in use, false if unused or overridden by EEPROM
+       */
+      boolean active;
+
+      /**
+       * A value was sent since startup
+       */
+      boolean sent;
+
+      /**
+       * Send the next value regardless of deadband and interval
+       */
+      boolean force;
+
+      /**
+       * Number of readings in sum
+       */
+      byte count;
+
+      /**
+       * Sum of readings since the last value
+       */
+      unsigned long sum;
+
+      /**
+       * Last value sent
+       */
+      long value;
+
+      /**
+       * millis() when the last value was sent
+       */
+      unsigned long since;
+
+    } asbIoAInState;
+
+    /**
+     * Check a single analog input configuration at compile time
+     * @param cfg asbIoAIn configuration
+     * @return true if valid
+     */
+    constexpr bool asbIoAInValid(const asbIoAIn &cfg) {
+        return cfg.pin != 0x00 && cfg.pin != 0xFF && cfg.target != 0 && cfg.cmd >= ASB_CMD_S_TEMP && cfg.cmd <= 0xDF;
+    }
+
+    /**
+     * Check a table of analog input configurations at compile time
+     * @param table array of asbIoAIn configurations
+     * @param items number of entries
+     * @return true if all entries are valid
+     */
+    constexpr bool asbIoAInValid(const asbIoAIn *table, unsigned int items) {
+        return items == 0 || (asbIoAInValid(table[0]) && asbIoAInValid(table+1, items-1));
+    }
+
+    /**
+     * Declare a validated analog input table in flash
+     *
+     * Entries use the field order of asbIoAIn:
+     *   ASB_IO_AIN_TABLE(sensors, {A0, 0x2001, ASB_CMD_S_TEMP, 500, 0, 8, 5, 50, 300});
+     *
+     * @param name name of the table
+     * @param ... asbIoAIn initializers
+     */
+    #define ASB_IO_AIN_TABLE(name, ...) \
+        constexpr asbIoAIn name[] PROGMEM = { __VA_ARGS__ }; \
+        static_assert(sizeof(name)/sizeof(asbIoAIn) < 0xFF, "Too many analog inputs in " #name); \
+        static_assert(asbIoAInValid(name, sizeof(name)/sizeof(asbIoAIn)), "Invalid analog input in " #name)
+
+    /**
+     * Analog input module
+     *
+     * Sends ASB_CMD_S_* values when they moved past the deadband or the
+     * heartbeat expired. Multicast ASB_CMD_REQ to the target of an input is
+     * answered with its last value.
+     *
+     * @see ASB_IO
+     */
+    class ASB_IO_AIN : public ASB_IO {
+        private:
+            /**
+             * Number of inputs configured in EEPROM
+             */
+             byte _items;
+
+            /**
+             * Array of inputs configured in EEPROM
+             */
+             asbIoAIn *_config;
+
+            /**
+             * Number of inputs configured in flash
+             */
+             byte _tableItems;
+
+            /**
+             * Array of inputs configured in flash
+             */
+             const asbIoAIn *_table;
+
+            /**
+             * Runtime data, flash inputs first
+             */
+             asbIoAInState *_state;
+
+            /**
+             * Active inputs sorted by target
+             */
+             asbIoIndex *_index;
+
+            /**
+             * Number of index entries
+             */
+             byte _indexItems;
+
+            /**
+             * Index matches current configuration
+             */
+             bool _indexed;
+
+            /**
+             * Lower 16 bit of millis() of the last sampling round
+             */
+             unsigned int _sampled;
+
+            /**
+             * Get configuration of an input
+             * @param i input index, flash inputs first
+             * @param cfg asbIoAIn reference to store the configuration
+             * @return bool true if input is active
+             */
+            bool cfgItem(byte i, asbIoAIn &cfg);
+
+            /**
+             * Rebuild the target index from all active inputs
+             */
+            void cfgIndex(void);
+
+            /**
+             * Set up pin and runtime data
+             * @param i input index, flash inputs first
+             * @param cfg asbIoAIn configuration
+             */
+            void cfgInit(byte i, asbIoAIn &cfg);
+
+            /**
+             * Add a reading and check if a new value has to be sent
+             * @param i input index, flash inputs first
+             * @param cfg asbIoAIn configuration
+             * @param now millis()
+             */
+            void sample(byte i, asbIoAIn &cfg, unsigned long now);
+
+            /**
+             * Send a value
+             * @param i input index, flash inputs first
+             * @param cfg asbIoAIn configuration
+             * @param value value in units of cfg.cmd
+             */
+            void send(byte i, asbIoAIn &cfg, long value);
+
+        public:
+            /**
+             * Initialize
+             * @param read configuration objects using id X, 1-15
+             */
+            ASB_IO_AIN(byte cfgId);
+
+            /**
+             * Initialize with inputs stored in flash
+             *
+             * Flash inputs are used without copying them to RAM. Inputs
+             * stored in EEPROM for the same pin take precedence.
+             *
+             * @param read configuration objects using id X, 1-15
+             * @param table PROGMEM array of inputs, see ASB_IO_AIN_TABLE
+             * @param items number of inputs in table
+             */
+            ASB_IO_AIN(byte cfgId, const asbIoAIn *table, byte items);
+
+            /**
+             * Initialize with inputs stored in flash
+             * @param read configuration objects using id X, 1-15
+             * @param table PROGMEM array of inputs, see ASB_IO_AIN_TABLE
+             */
+            template <size_t N> ASB_IO_AIN(byte cfgId, const asbIoAIn (&table)[N]) : ASB_IO_AIN(cfgId, table, N) {}
+
+            /**
+             * Read configuration block starting at provided address
+             * @param read configuration object from address X
+             * @return bool true if successful
+             */
+            bool cfgRead(unsigned int address);
+
+            /**
+             * Write current configuration
+             * @param asbIoAIn configuration struct reference
+             * @return bool true if successful
+             */
+            bool cfgWrite(asbIoAIn &cfg);
+
+            /**
+             * Reset current configuration and release memory
+             * @return bool true if successful
+             */
+            bool cfgReset(void);
+
+            /**
+             * Reserve memory for configuration and activate flash inputs
+             * @param objects number of configuration objects in EEPROM
+             * @return bool true if successful
+             */
+            bool cfgReserve(byte objects);
+
+            /**
+             * Commands this module wants to receive
+             * @return byte ASB_IO_CMD() bits
+             */
+            byte cfgCommands(void);
+
+            /**
+             * Group targets this module wants to receive
+             * @param n number of the target, starting at 0
+             * @param target reference to store the target
+             * @return bool false if there are no more targets
+             */
+            bool cfgTarget(byte n, unsigned int &target);
+
+            /**
+             * Configuration memory was moved inside the controller arena
+             * @param offset number of bytes the memory was moved
+             */
+            void cfgRelocate(int offset);
+
+            /**
+             * Process incoming packet
+             * @param pkg Packet struct
+             * @return bool true if successful
+             */
+            bool process(asbPacket &pkg);
+
+            /**
+             * Main loop call, samples all inputs
+             * @return bool true if successful
+             */
+            bool loop(void);
+
+            /**
+             * Attach an analog input using a complete configuration
+             * @param cfg asbIoAIn configuration
+             * @return true if successfully added
+             */
+            bool attach(asbIoAIn &cfg);
+
+            /**
+             * Attach an analog input sending every change
+             *
+             * @param target target address between 0x0001 and 0xFFFF
+             * @param pin analog pin, e.g. A0
+             * @param cmd sensor command, ASB_CMD_S_*
+             * @param scale value at ASB_IO_AIN_MAX in units of cmd
+             * @param offset value at 0 in units of cmd
+             * @return true if successfully added
+             */
+            bool attach(unsigned int target, byte pin, byte cmd, int scale, int offset);
+
+            /**
+             * Detach an analog input
+             *
+             * Removes all configuration entries for the supplied pin from EEPROM
+             *
+             * @param pin Pin number
+             * @return true if successfully removed
+             */
+            bool detach(byte pin);
+    };
+
+#endif /* ASB_IO_AIN__H */
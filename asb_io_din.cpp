@@ -26,15 +26,137 @@
     #include <inttypes.h>
     #include <asb.h>
 
+    #ifdef ASB_IO_DIN_PCINT
+        ASB_IO_DIN *ASB_IO_DIN::_pcOwner = NULL;
+        byte ASB_IO_DIN::_pcPorts[ASB_IO_DIN_PCINT_PORTS];
+        volatile byte ASB_IO_DIN::_pcLast[ASB_IO_DIN_PCINT_PORTS];
+        volatile byte ASB_IO_DIN::_pcItems = 0;
+        volatile asbIoDInEdge ASB_IO_DIN::_edges[ASB_IO_DIN_PCINT];
+        volatile byte ASB_IO_DIN::_edgeHead = 0;
+        volatile byte ASB_IO_DIN::_edgeTail = 0;
+        volatile bool ASB_IO_DIN::_edgeLost = false;
+
+        #if defined(PCICR) && !defined(ASB_IO_DIN_PCINT_NOISR)
+            #ifdef PCINT0_vect
+                ISR(PCINT0_vect) { ASB_IO_DIN::latch(); }
+            #endif
+            #ifdef PCINT1_vect
+                ISR(PCINT1_vect) { ASB_IO_DIN::latch(); }
+            #endif
+            #ifdef PCINT2_vect
+                ISR(PCINT2_vect) { ASB_IO_DIN::latch(); }
+            #endif
+            #ifdef PCINT3_vect
+                ISR(PCINT3_vect) { ASB_IO_DIN::latch(); }
+            #endif
+        #endif
+    #endif
+
     ASB_IO_DIN::ASB_IO_DIN(byte cfgId) {
         _cfgId=cfgId;
     }
 
+    ASB_IO_DIN::ASB_IO_DIN(byte cfgId, const asbIoDIn *table, byte items) {
+        _cfgId=cfgId;
+        _table=table;
+        _tableItems=items;
+    }
+
+    asbIoDInGesture *ASB_IO_DIN::gestureOf(byte i) {
+        byte n;
+        for(n=0; n<_gestureItems; n++) {
+            if(_gesture[n].item == i) return &_gesture[n];
+        }
+        return NULL;
+    }
+
+    bool ASB_IO_DIN::cfgItem(byte i, asbIoDIn &cfg) {
+        if(_state == NULL || i >= (_tableItems + _items) || !_state[i].active) return false;
+
+        if(i < _tableItems) {
+            memcpy_P(&cfg, &_table[i], sizeof(asbIoDIn));
+        }else{
+            asbIoDInGesture *gesture;
+            memcpy(&cfg, &_config[(i - _tableItems) * ASB_IO_DIN_STORED], ASB_IO_DIN_STORED);
+            if(cfg.mode == ASB_IO_DIN_GESTURE && (gesture = gestureOf(i)) != NULL) {
+                memcpy((byte *) &cfg + ASB_IO_DIN_STORED, gesture->timing, sizeof(gesture->timing));
+            }else{
+                memset((byte *) &cfg + ASB_IO_DIN_STORED, 0, sizeof(asbIoDIn) - ASB_IO_DIN_STORED);
+            }
+        }
+        return true;
+    }
+
+    void ASB_IO_DIN::cfgInit(byte i, asbIoDIn &cfg) {
+        if(cfg.mode == ASB_IO_DIN_GESTURE) {
+            byte n;
+            for(n=0; n<_gestureItems && _gesture[n].item != 0xFF; n++);
+            if(n == _gestureItems) {
+                #ifdef ASB_DEBUG
+                    Serial.print(F("No gesture block")); Serial.println(); Serial.flush();
+                #endif
+                return;
+            }
+            _gesture[n].item = i;
+            memcpy(_gesture[n].timing, (byte *) &cfg + ASB_IO_DIN_STORED, sizeof(_gesture[n].timing));
+            _gesture[n].phase = ASB_IO_DIN_G_IDLE;
+            _gesture[n].level = 0;
+        }
+
+        if(cfg.pullup) {
+            ::pinMode(cfg.pin, INPUT_PULLUP);
+            delay(1);
+        }else{
+            ::pinMode(cfg.pin, INPUT);
+        }
+
+        //Inputs on the same port share one group
+        byte port = asbPortOf(cfg.pin);
+        byte mask = asbPortMask(cfg.pin);
+        byte g;
+        for(g=0; g<_portItems; g++) {
+            if(_ports[g].port == port) break;
+        }
+        if(g == _portItems) {
+            _ports[g].port = port;
+            _ports[g].invert = 0;
+            _ports[g].raw = 0;
+            _ports[g].pending = 0;
+            _portItems++;
+        }
+
+        if(cfg.invert) {
+            _ports[g].invert |= mask;
+        }else{
+            _ports[g].invert &= ~mask;
+        }
+
+        byte sample = (asbPortRead(port) ^ _ports[g].invert) & mask;
+        _ports[g].raw = (_ports[g].raw & ~mask) | sample;
+        _ports[g].pending &= ~mask;
+
+        _state[i].last = (sample > 0) ? 1 : 0;
+        _state[i].since = millis();
+        _state[i].group = g;
+        _state[i].mask = mask;
+        _state[i].active = true;
+        _indexed = false;
+        _control->dispatchUpdate();
+
+        #ifdef ASB_IO_DIN_PCINT
+            _pcDirty = true;
+        #endif
+
+        //Poll other nodes for last state
+        _control->asbRequest(cfg.target);
+    }
+
     bool ASB_IO_DIN::cfgRead(unsigned int address) {
-        if(_control == NULL) return false;
-        byte temp;
+        if(_control == NULL || _state == NULL) return false;
+        asbIoDIn cfg;
+        byte temp,i;
 
-        byte check = EEPROM.read(address);
+        byte check = asbEEPROM.read(address);
         if(check == 0xFF || check == 0x00) {
             #ifdef ASB_DEBUG
                 Serial.print(F("Header empty")); Serial.println(); Serial.flush();
@@ -48,101 +170,142 @@
             return false;
         }
 
-        for(temp=0; temp<_items; temp++) {
-            if(_config[temp].pin == 0xFF || _config[temp].pin == 0x00) { //Slot is free
-                EEPROM.get(address+1, _config[temp]);
-
-                if(_config[temp].pin == 0xFF || _config[temp].pin == 0x00) return false;
+        for(temp=_tableItems; temp<(_tableItems + _items); temp++) {
+            if(!_state[temp].active) { //Slot is free
+                if(!cfgLoad(address, &cfg, sizeof(cfg))) return false;
+                if(cfg.pin == 0xFF || cfg.pin == 0x00) return false;
+                memcpy(&_config[(temp - _tableItems) * ASB_IO_DIN_STORED], &cfg, ASB_IO_DIN_STORED);
 
-                if(_config[temp].pullup) {
-                    ::pinMode(_config[temp].pin, INPUT_PULLUP);
-                    delay(1);
-                }else{
-                    ::pinMode(_config[temp].pin, INPUT);
+                //EEPROM overrides flash configuration for the same pin
+                for(i=0; i<_tableItems; i++) {
+                    if(pgm_read_byte(&_table[i].pin) == cfg.pin) _state[i].active = false;
                 }
 
-                _config[temp].last = ::digitalRead(_config[temp].pin);
-                if(_config[temp].invert) {
-                    _config[temp].last ^= 1;
-                }
-
-                //Poll other nodes for last state
-                byte data[1] = {ASB_CMD_REQ};
-                _control->asbSend(ASB_PKGTYPE_MULTICAST, _config[temp].target, sizeof(data), data);
-                
+                cfgInit(temp, cfg);
                 return true;
             }
         }
         return false;
     }
 
-    bool ASB_IO_DIN::cfgWrite(asbIoDIn &cfg) {
-        if(_control == NULL) {
-            #ifdef ASB_DEBUG
-                Serial.println(F("No controller...")); Serial.flush();
-            #endif
-            return false;
-        }
-
-        unsigned int address;
-
-        if(cfg.pin == 0xFF) {
-            #ifdef ASB_DEBUG
-                Serial.println(F("No pin...")); Serial.flush();
-            #endif
-            return false;
-        }
-        
-        address = _control->cfgFindFreeblock(sizeof(cfg)+1, _cfgId);
-        if(address == 0) {
-            #ifdef ASB_DEBUG
-                Serial.println(F("Got no address...")); Serial.flush();
-            #endif
-            return false;
-        }
-        address++; //Skip header
+    static_assert(sizeof(asbIoDIn) + 2 * ASB_CFG_HEADER <= ASB_EEPROM_CACHE, "ASB_EEPROM_CACHE is too small for asbIoDIn");
 
-        EEPROM.put(address, cfg);
-        
-        return true;
+    bool ASB_IO_DIN::cfgWrite(asbIoDIn &cfg) {
+        return cfgStore(&cfg, sizeof(cfg));
     }
 
     bool ASB_IO_DIN::cfgReset(void) {
-        if(_config == NULL) return true;
-        free(_config);
+        if(_state != NULL && _control != NULL) _control->arenaAlloc(this, 0);
         _config = NULL;
+        _state = NULL;
+        _index = NULL;
+        _indexItems = 0;
+        _indexed = false;
+        if(_control != NULL) _control->dispatchUpdate();
+        _ports = NULL;
         _items = 0;
+        _portItems = 0;
+        _gesture = NULL;
+        _gestureItems = 0;
+        _gestures = false;
         return true;
     }
 
     bool ASB_IO_DIN::cfgReserve(byte objects) {
+        asbIoDIn cfg;
+        unsigned int address = 0;
+        byte i, gestures = 0;
+
         cfgReset();
-        _config = (asbIoDIn *) calloc(objects, sizeof(asbIoDIn));
-        if(_config==NULL) {
-            _items = 0;
-            return false;
-        }else{
-            _items = objects;
-            return true;
+        if((_tableItems + objects) == 0) return true;
+        if(_control == NULL) return false;
+
+        //Only gesture inputs get a gesture block
+        for(i=0; i<_tableItems; i++) {
+            if(pgm_read_byte(&_table[i].mode) == ASB_IO_DIN_GESTURE) gestures++;
+        }
+        while((address = _control->cfgNextBlock(address, _cfgId)) != 0) {
+            if(asbEEPROM.read(address+ASB_CFG_HEADER+offsetof(asbIoDIn, mode)) == ASB_IO_DIN_GESTURE) gestures++;
         }
+
+        //EEPROM configuration first, followed by target index, runtime data, port groups and gesture blocks
+        _config = (byte *) _control->arenaAlloc(this, objects * ASB_IO_DIN_STORED + (_tableItems + objects) * (sizeof(asbIoIndex) + sizeof(asbIoDInState) + sizeof(asbIoDInPort)) + gestures * sizeof(asbIoDInGesture));
+        if(_config == NULL) return false;
+        _index = (asbIoIndex *) &_config[objects * ASB_IO_DIN_STORED];
+        _state = (asbIoDInState *) &_index[_tableItems + objects];
+        _ports = (asbIoDInPort *) &_state[_tableItems + objects];
+        _gesture = (asbIoDInGesture *) &_ports[_tableItems + objects];
+        if(objects == 0) _config = NULL;
+        if(gestures == 0) _gesture = NULL;
+        _items = objects;
+        _gestureItems = gestures;
+        for(i=0; i<gestures; i++) _gesture[i].item = 0xFF;
+
+        //Flash inputs are used directly, EEPROM may override them later
+        for(i=0; i<_tableItems; i++) {
+            memcpy_P(&cfg, &_table[i], sizeof(asbIoDIn));
+            if(asbIoDInValid(cfg)) cfgInit(i, cfg);
+        }
+        return true;
+    }
+
+    void ASB_IO_DIN::cfgIndex(void) {
+        asbIoDIn cfg;
+        byte i;
+
+        _indexItems = 0;
+        for(i=0; i<(_tableItems + _items); i++) {
+            if(cfgItem(i, cfg)) {
+                _index[_indexItems].target = cfg.target;
+                _index[_indexItems].item = i;
+                _indexItems++;
+            }
+        }
+        asbIoIndexSort(_index, _indexItems);
+        _indexed = true;
+    }
+
+    byte ASB_IO_DIN::cfgCommands(void) {
+        return ASB_IO_CMD(ASB_CMD_1B) | ASB_IO_CMD(ASB_CMD_PER);
+    }
+
+    bool ASB_IO_DIN::cfgTarget(byte n, unsigned int &target) {
+        if(!_indexed) cfgIndex();
+        if(n >= _indexItems) return false;
+        target = _index[n].target;
+        return true;
+    }
+
+    void ASB_IO_DIN::cfgRelocate(int offset) {
+        cfgMove(_config, offset);
+        cfgMove(_state, offset);
+        cfgMove(_index, offset);
+        cfgMove(_ports, offset);
+        cfgMove(_gesture, offset);
     }
 
     bool ASB_IO_DIN::process(asbPacket &pkg) {
         if(_control == NULL) return false;
-        byte i;
+        asbIoDIn cfg;
+        asbIoDInGesture *gesture;
+        byte i,p;
         if(pkg.len >= 1) {
+            if(!_indexed) cfgIndex();
             switch(pkg.data[0]) {
                 case ASB_CMD_1B:
                     if(pkg.meta.type != ASB_PKGTYPE_MULTICAST || pkg.len != 2) break;
-                    for(i=0; i<_items; i++) {
-                        if(_config[i].pin != 0xFF && _config[i].pin != 0x00 && _config[i].target == pkg.meta.target) {
-                            switch(_config[i].mode) {
+                    for(p=asbIoIndexFind(_index, _indexItems, pkg.meta.target); p<_indexItems && _index[p].target == pkg.meta.target; p++) {
+                        i = _index[p].item;
+                        if(cfgItem(i, cfg)) {
+                            switch(cfg.mode) {
                                 case ASB_IO_DIN_DIRECT:
-                                    _config[i].last = pkg.data[1];
+                                    _state[i].last = pkg.data[1];
+                                    _ports[_state[i].group].pending |= _state[i].mask; //Resend if pin differs
                                 break;
                                 case ASB_IO_DIN_BTOGGLE:
                                 case ASB_IO_DIN_STOGGLE:
-                                    _config[i].last ^= (-(pkg.data[1] << 1) ^ _config[i].last) & (1 << 1);
+                                case ASB_IO_DIN_GESTURE:
+                                    _state[i].last ^= (-(pkg.data[1] << 1) ^ _state[i].last) & (1 << 1);
                                 break;
                             }
                         }
@@ -151,18 +314,23 @@
 
                 case ASB_CMD_PER:
                     if(pkg.meta.type != ASB_PKGTYPE_MULTICAST || pkg.len != 2) break;
-                    for(i=0; i<_items; i++) {
-                        if(_config[i].pin != 0xFF && _config[i].pin != 0x00 && _config[i].target == pkg.meta.target) {
-                            switch(_config[i].mode) {
+                    for(p=asbIoIndexFind(_index, _indexItems, pkg.meta.target); p<_indexItems && _index[p].target == pkg.meta.target; p++) {
+                        i = _index[p].item;
+                        if(cfgItem(i, cfg)) {
+                            switch(cfg.mode) {
                                 case ASB_IO_DIN_DIRECT:
-                                    _config[i].last = pkg.data[1];
+                                    _state[i].last = pkg.data[1];
+                                    _ports[_state[i].group].pending |= _state[i].mask; //Resend if pin differs
                                 break;
+                                case ASB_IO_DIN_GESTURE:
+                                    if((gesture = gestureOf(i)) != NULL) gesture->level = (pkg.data[1] > 100) ? 100 : pkg.data[1];
+                                    //fall through
                                 case ASB_IO_DIN_BTOGGLE:
                                 case ASB_IO_DIN_STOGGLE:
                                     if(pkg.data[1] > 0) {
-                                        _config[i].last |= 0x02;
+                                        _state[i].last |= 0x02;
                                     }else{
-                                        _config[i].last &= ~(0x02);
+                                        _state[i].last &= ~(0x02);
                                     }
                                 break;
                             }
@@ -176,68 +344,328 @@
 
     bool ASB_IO_DIN::loop(void) {
         if(_control == NULL) return false;
-        byte temp;
-        byte data[2] = {ASB_CMD_1B, 0};
-        asbPacket pkg;
-        bool t=false;
+        byte g;
+        unsigned int now = millis();
 
-        for(byte i=0; i<_items; i++) {
-            if(_config[i].pin != 0xFF && _config[i].pin != 0x00) {
-                temp = ::digitalRead(_config[i].pin);
+        #ifdef ASB_IO_DIN_PCINT
+            byte t;
+            if(_pcOwner == this) {
+                if(_pcDirty) pcArm();
 
-                if(_config[i].invert) {
-                    temp ^= 1;
+                if(_pcArmed && !_edgeLost) {
+                    while((t = _edgeTail) != _edgeHead) {
+                        for(g=0; g<_portItems; g++) {
+                            if(_ports[g].port == _edges[t].port) {
+                                scan(g, _edges[t].sample ^ _ports[g].invert, _edges[t].time);
+                            }
+                        }
+                        _edgeTail = (t + 1) % ASB_IO_DIN_PCINT;
+                    }
+
+                    //Only inputs still waiting for their debounce time
+                    for(g=0; g<_portItems; g++) {
+                        if(_ports[g].pending) scan(g, _ports[g].raw, now);
+                    }
+                    if(_gestures) gestureTimer(now);
+                    return true;
                 }
 
-                if((_config[i].last & 1) != temp) {
-                    t=true;
-                    switch(_config[i].mode) {
-                        case ASB_IO_DIN_DIRECT:
-                            data[1] = temp;
-                            _control->asbSend(ASB_PKGTYPE_MULTICAST, _config[i].target, sizeof(data), data);
-                            _config[i].last = temp;
-                        break;
-                        case ASB_IO_DIN_BTOGGLE:
-                            //we use bit 1 of last as current bus state
-                            //we use bit 2 of last as indicator for detecting button release
-                            if((_config[i].last & 0x04) == 0 && temp) {
-                                _config[i].last ^= 0x02;
-                                data[1] = ((_config[i].last & 0x02) >> 1);
-                                _control->asbSend(ASB_PKGTYPE_MULTICAST, _config[i].target, sizeof(data), data);
-                                _config[i].last |= 0x04;
-                            }else if((_config[i].last & 0x04) > 0 && !temp) {
-                                _config[i].last &= ~0x04;
-                            }
-                            _config[i].last ^= (-temp ^ _config[i].last) & 1;
+                //Buffered edges are older than the following poll
+                _edgeLost = false;
+                _edgeTail = _edgeHead;
+            }
+        #endif
+
+        for(g=0; g<_portItems; g++) {
+            scan(g, asbPortRead(_ports[g].port) ^ _ports[g].invert, now);
+        }
+        if(_gestures) gestureTimer(now);
+
+        return true;
+    }
+
+    void ASB_IO_DIN::scan(byte g, byte sample, unsigned int now) {
+        asbIoDIn cfg;
+        asbIoDInPort *port = &_ports[g];
+        byte i, state;
+        byte changed = sample ^ port->raw;
+        byte check = changed | port->pending;
+
+        if(check == 0) return; //Nothing to do on this port
+        port->pending = 0;
+
+        for(i=0; i<(_tableItems + _items); i++) {
+            if(_state[i].group != g || (_state[i].mask & check) == 0 || !cfgItem(i, cfg)) continue;
+
+            //Previous sample was stable until now
+            state = (port->raw & _state[i].mask) ? 1 : 0;
+            if(
+                (_state[i].last & 1) != state &&
+                (unsigned int)(now - _state[i].since) >= (cfg.debounce > 0 ? cfg.debounce : ASB_IO_DIN_DEBOUNCE)
+            ) {
+                change(i, cfg, state, now);
+            }
+
+            if(changed & _state[i].mask) { //Input is bouncing, restart settle time
+                _state[i].since = now;
+            }
+
+            state = (sample & _state[i].mask) ? 1 : 0;
+            if((_state[i].last & 1) != state) port->pending |= _state[i].mask;
+        }
+
+        port->raw = sample;
+    }
+
+    #ifdef ASB_IO_DIN_PCINT
+        bool ASB_IO_DIN::useInterrupts(bool enable) {
+            if(!enable) {
+                if(_pcOwner == this) _pcOwner = NULL;
+                return true;
+            }
+            if(_pcOwner != NULL && _pcOwner != this) return false;
+            _pcOwner = this;
+            return pcArm();
+        }
+
+        bool ASB_IO_DIN::pcArm(void) {
+            asbIoDIn cfg;
+            byte i, p, port;
+            bool ok = true;
+
+            _pcDirty = false;
+
+            noInterrupts();
+            _pcItems = 0;
+            for(i=0; i<(_tableItems + _items) && ok; i++) {
+                if(!cfgItem(i, cfg)) continue;
+
+                #ifdef digitalPinToPCICR
+                    if(digitalPinToPCICR(cfg.pin) == 0) {
+                        ok = false;
                         break;
-                        case ASB_IO_DIN_STOGGLE:
-                            //we use bit 1 of last as current bus state
-                            _config[i].last ^= (1<<1);
-                            data[1] = ((_config[i].last & 0x02) >> 1);
-                            _control->asbSend(ASB_PKGTYPE_MULTICAST, _config[i].target, sizeof(data), data);
-                            _config[i].last ^= (-temp ^ _config[i].last) & 1;
+                    }
+                    *digitalPinToPCMSK(cfg.pin) |= (1 << digitalPinToPCMSKbit(cfg.pin));
+                    *digitalPinToPCICR(cfg.pin) |= (1 << digitalPinToPCICRbit(cfg.pin));
+                #else
+                    ok = false;
+                    break;
+                #endif
+
+                port = asbPortOf(cfg.pin);
+                for(p=0; p<_pcItems; p++) {
+                    if(_pcPorts[p] == port) break;
+                }
+                if(p == _pcItems) {
+                    if(_pcItems >= ASB_IO_DIN_PCINT_PORTS) {
+                        ok = false;
                         break;
                     }
+                    _pcPorts[p] = port;
+                    _pcLast[p] = asbPortRead(port);
+                    _pcItems++;
                 }
             }
+            if(!ok) {
+                _pcItems = 0;
+                #ifdef digitalPinToPCICR
+                    //Polled inputs must not trigger interrupts
+                    for(i=0; i<(_tableItems + _items); i++) {
+                        if(cfgItem(i, cfg) && digitalPinToPCICR(cfg.pin) != 0) {
+                            *digitalPinToPCMSK(cfg.pin) &= ~(1 << digitalPinToPCMSKbit(cfg.pin));
+                        }
+                    }
+                #endif
+            }
+            _edgeLost = true; //Resync with one poll
+            interrupts();
+
+            #ifdef ASB_DEBUG
+                if(!ok) {
+                    Serial.print(F("Polling inputs")); Serial.println(); Serial.flush();
+                }
+            #endif
+
+            _pcArmed = ok;
+            return ok;
+        }
+
+        void ASB_IO_DIN::latch(void) {
+            byte p, sample, next;
+            unsigned int now = millis();
+
+            for(p=0; p<_pcItems; p++) {
+                sample = asbPortRead(_pcPorts[p]);
+                if(sample == _pcLast[p]) continue;
+                _pcLast[p] = sample;
+
+                next = (_edgeHead + 1) % ASB_IO_DIN_PCINT;
+                if(next == _edgeTail) { //Buffer full
+                    _edgeLost = true;
+                    continue;
+                }
+                _edges[_edgeHead].port = _pcPorts[p];
+                _edges[_edgeHead].sample = sample;
+                _edges[_edgeHead].time = now;
+                _edgeHead = next;
+            }
+        }
+    #endif
+
+    void ASB_IO_DIN::change(byte i, asbIoDIn &cfg, byte state, unsigned int now) {
+        byte data[2] = {ASB_CMD_1B, 0};
+        asbIoDInGesture *gesture;
+
+        switch(cfg.mode) {
+            case ASB_IO_DIN_DIRECT:
+                data[1] = state;
+                _control->asbSend(ASB_PKGTYPE_MULTICAST, cfg.target, sizeof(data), data);
+                _state[i].last = state;
+            break;
+            case ASB_IO_DIN_BTOGGLE:
+                //we use bit 1 of last as current bus state
+                //we use bit 2 of last as indicator for detecting button release
+                if((_state[i].last & 0x04) == 0 && state) {
+                    _state[i].last ^= 0x02;
+                    data[1] = ((_state[i].last & 0x02) >> 1);
+                    _control->asbSend(ASB_PKGTYPE_MULTICAST, cfg.target, sizeof(data), data);
+                    _state[i].last |= 0x04;
+                }else if((_state[i].last & 0x04) > 0 && !state) {
+                    _state[i].last &= ~0x04;
+                }
+                _state[i].last ^= (-state ^ _state[i].last) & 1;
+            break;
+            case ASB_IO_DIN_STOGGLE:
+                //we use bit 1 of last as current bus state
+                _state[i].last ^= (1<<1);
+                data[1] = ((_state[i].last & 0x02) >> 1);
+                _control->asbSend(ASB_PKGTYPE_MULTICAST, cfg.target, sizeof(data), data);
+                _state[i].last ^= (-state ^ _state[i].last) & 1;
+            break;
+            case ASB_IO_DIN_GESTURE:
+                _state[i].last ^= (-state ^ _state[i].last) & 1;
+                if((gesture = gestureOf(i)) == NULL) break;
+                if(state) {
+                    if(gesture->phase == ASB_IO_DIN_G_RELEASED) {
+                        data[0] = ASB_CMD_0B;
+                        _control->asbSend(ASB_PKGTYPE_MULTICAST, (cfg.dblTarget != 0) ? cfg.dblTarget : cfg.target, 1, data);
+                        gesture->phase = ASB_IO_DIN_G_SECOND;
+                    }else{
+                        gesture->phase = ASB_IO_DIN_G_PRESSED;
+                    }
+                }else{
+                    if(gesture->phase == ASB_IO_DIN_G_PRESSED && cfg.dblclick > 0) {
+                        gesture->phase = ASB_IO_DIN_G_RELEASED;
+                    }else{
+                        if(gesture->phase == ASB_IO_DIN_G_PRESSED) gestureToggle(i, cfg);
+                        gesture->phase = ASB_IO_DIN_G_IDLE;
+                    }
+                }
+                gesture->timer = now;
+                if(gesture->phase != ASB_IO_DIN_G_IDLE) _gestures = true;
+            break;
         }
-        
-        if(t) delay(100); //TODO Replace this very ugly line fooling people who dont read code there would be proper debounce ;)
-        return true;
     }
 
-    bool ASB_IO_DIN::attach(unsigned int target, byte pin, byte mode, bool invert, bool pullup) {
-        if(_control == NULL) return false;
+    void ASB_IO_DIN::gestureTimer(unsigned int now) {
         asbIoDIn cfg;
+        unsigned int elapsed;
+        byte n, i;
+
+        _gestures = false;
+        for(n=0; n<_gestureItems; n++) {
+            asbIoDInGesture &gesture = _gesture[n];
+            i = gesture.item;
+            if(gesture.phase == ASB_IO_DIN_G_IDLE || !cfgItem(i, cfg)) continue;
+            elapsed = now - gesture.timer;
+
+            switch(gesture.phase) {
+                case ASB_IO_DIN_G_PRESSED:
+                    if(elapsed < ((cfg.hold > 0) ? (cfg.hold * 10) : ASB_IO_DIN_HOLD)) break;
+                    //Dim up if off or at minimum, down if at maximum, otherwise reverse last direction
+                    if((_state[i].last & 0x02) == 0 || gesture.level == 0) {
+                        _state[i].last &= ~0x08;
+                    }else if(gesture.level >= 100) {
+                        _state[i].last |= 0x08;
+                    }else{
+                        _state[i].last ^= 0x08;
+                    }
+                    gesture.phase = ASB_IO_DIN_G_HOLDING;
+                    gestureStep(gesture, cfg);
+                    gesture.timer = now;
+                break;
+                case ASB_IO_DIN_G_HOLDING:
+                    if(elapsed < ((cfg.repeat > 0) ? (cfg.repeat * 10) : ASB_IO_DIN_REPEAT)) break;
+                    gestureStep(gesture, cfg);
+                    gesture.timer = now;
+                break;
+                case ASB_IO_DIN_G_RELEASED:
+                    if(elapsed < (cfg.dblclick * 10)) break;
+                    gestureToggle(i, cfg);
+                    gesture.phase = ASB_IO_DIN_G_IDLE;
+                break;
+            }
+
+            if(gesture.phase != ASB_IO_DIN_G_IDLE && gesture.phase != ASB_IO_DIN_G_SECOND) _gestures = true;
+        }
+    }
+
+    void ASB_IO_DIN::gestureStep(asbIoDInGesture &gesture, asbIoDIn &cfg) {
+        byte step = (cfg.step > 0) ? cfg.step : ASB_IO_DIN_STEP;
+        byte data[2] = {ASB_CMD_PER, gesture.level};
+        byte &last = _state[gesture.item].last;
+
+        //we use bit 3 of last as dimming direction, set = down
+        if(last & 0x08) {
+            gesture.level = (gesture.level > step) ? (gesture.level - step) : 0;
+        }else{
+            gesture.level = (gesture.level < (100 - step)) ? (gesture.level + step) : 100;
+        }
+
+        if(gesture.level > 0) {
+            last |= 0x02;
+        }else{
+            last &= ~0x02;
+        }
+
+        if(data[1] == gesture.level) return; //Limit reached
+        data[1] = gesture.level;
+        _control->asbSend(ASB_PKGTYPE_MULTICAST, cfg.target, sizeof(data), data);
+    }
+
+    void ASB_IO_DIN::gestureToggle(byte i, asbIoDIn &cfg) {
+        //we use bit 1 of last as current bus state
+        _state[i].last ^= 0x02;
+        byte data[2] = {ASB_CMD_1B, (byte)((_state[i].last & 0x02) >> 1)};
+        _control->asbSend(ASB_PKGTYPE_MULTICAST, cfg.target, sizeof(data), data);
+    }
+
+    bool ASB_IO_DIN::attach(unsigned int target, byte pin, byte mode, bool invert, bool pullup) {
+        return attach(target, pin, mode, invert, pullup, 0);
+    }
+
+    bool ASB_IO_DIN::attach(unsigned int target, byte pin, byte mode, bool invert, bool pullup, byte debounce) {
+        asbIoDIn cfg = {};
 
         cfg.target = target;
         cfg.pin = pin;
         cfg.invert = invert;
         cfg.pullup = pullup;
         cfg.mode = mode;
+        cfg.debounce = debounce;
+        return attach(cfg);
+    }
+
+    bool ASB_IO_DIN::attach(asbIoDIn &cfg) {
+        if(_control == NULL) return false;
+        if(!asbIoDInValid(cfg)) return false;
+        if(_control->arenaAvailable() < (ASB_IO_DIN_STORED + sizeof(asbIoIndex) + sizeof(asbIoDInState) + sizeof(asbIoDInPort) + ((cfg.mode == ASB_IO_DIN_GESTURE) ? sizeof(asbIoDInGesture) : 0))) return false;
         if(!cfgWrite(cfg)) return false;
-        _control->hookDetachModule(_cfgId);
-        return _control->hookAttachModule(this);
+        return cfgReload();
+    }
+
+    bool ASB_IO_DIN::detach(byte pin) {
+        return cfgFreePin(pin);
     }
 
 #endif /* ASB_IO_DIN__C */
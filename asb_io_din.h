@@ -24,22 +24,78 @@
 
     #include <Arduino.h>
     #include <inttypes.h>
+    #include <stddef.h>
     #include <asb.h>
 
     #define ASB_IO_DIN_DIRECT  0 //pushed = on, released = off - e.g. switch, temporary action, etc
     #define ASB_IO_DIN_BTOGGLE 1 //toggle every time button is pushed - e.g. push-button as light swtich, etc
     #define ASB_IO_DIN_STOGGLE 2 //toggle every time button is pushed or released - e.g. multiple switches for switching lights
+    #define ASB_IO_DIN_GESTURE 3 //short press toggles, long press dims, double-click sends a pulse - e.g. push-button as dimmer
+
+    /**
+     * Default debounce time
+     *
+     * ASB_IO_DIN_DEBOUNCE sets the time in ms an input has to be stable
+     * before a change is accepted. It is used for all inputs without their
+     * own debounce setting. Default is 50.
+     */
+    #ifndef ASB_IO_DIN_DEBOUNCE
+        #define ASB_IO_DIN_DEBOUNCE 50
+    #endif
+
+    /**
+     * Gesture defaults
+     *
+     * Used by ASB_IO_DIN_GESTURE inputs for all timing fields set to 0.
+     * Times are in ms, the step is in % per repeat.
+     */
+    #ifndef ASB_IO_DIN_HOLD
+        #define ASB_IO_DIN_HOLD 500
+    #endif
+    #ifndef ASB_IO_DIN_REPEAT
+        #define ASB_IO_DIN_REPEAT 200
+    #endif
+    #ifndef ASB_IO_DIN_STEP
+        #define ASB_IO_DIN_STEP 10
+    #endif
+
+    /**
+     * Gesture phases, see asbIoDInGesture
+     */
+    #define ASB_IO_DIN_G_IDLE     0 //Button released
+    #define ASB_IO_DIN_G_PRESSED  1 //Pressed, not yet long enough for dimming
+    #define ASB_IO_DIN_G_HOLDING  2 //Held down, dimming
+    #define ASB_IO_DIN_G_RELEASED 3 //Released after a short press, waiting for a second click
+    #define ASB_IO_DIN_G_SECOND   4 //Second click handled, waiting for release
+
+    /**
+     * Pin change interrupt support
+     *
+     * Define ASB_IO_DIN_PCINT as the number of edges to buffer (e.g. 16) to
+     * let inputs latch edges using pin change interrupts instead of being
+     * polled, see ASB_IO_DIN::useInterrupts(). Not defined by default as the
+     * interrupt vectors are often used by other libraries like SoftwareSerial.
+     * ASB_IO_DIN_PCINT_PORTS sets how many ports can be watched, default is 3.
+     */
+    //#define ASB_IO_DIN_PCINT 16
+    #if defined(ASB_IO_DIN_PCINT) && !defined(ASB_IO_DIN_PCINT_PORTS)
+        #define ASB_IO_DIN_PCINT_PORTS 3
+    #endif
 
     /**
      * Direct input struct
-     * Contains pin numbers and configuration for outputs
+     * Contains pin numbers and configuration for inputs
+     *
+     * This is stored as-is in EEPROM or flash, runtime data is kept in
+     * asbIoDInState. Fields are ordered for aggregate initialization,
+     * new fields must be appended and use 0 as default.
      */
     typedef struct {
 
       /**
        * Affected pin
        */
-      byte pin = 0xFF;
+      byte pin;
 
       /**
        * Target address
@@ -47,30 +103,212 @@
        * Milticast/Broadcast: 0x0001 - 0xFFFF
        * 0x0 -> everything
        */
-      unsigned int target = 0;
+      unsigned int target;
 
       /**
        * Is pin inverted?
        */
-      boolean invert = false;
+      boolean invert;
 
       /**
        * Use Pull-Up?
        */
-      boolean pullup = false;
+      boolean pullup;
 
       /**
        * Input mode
        */
-      byte mode = ASB_IO_DIN_DIRECT;
+      byte mode;
 
       /**
-       * Last received state
+       * Debounce time in ms, 0 = ASB_IO_DIN_DEBOUNCE
+       */
+      byte debounce;
+
+      /**
+       * Gesture: time until a press starts dimming in 10ms, 0 = ASB_IO_DIN_HOLD
+       */
+      byte hold;
+
+      /**
+       * Gesture: time between dimming steps in 10ms, 0 = ASB_IO_DIN_REPEAT
+       */
+      byte repeat;
+
+      /**
+       * Gesture: dimming step in %, 0 = ASB_IO_DIN_STEP
+       */
+      byte step;
+
+      /**
+       * Gesture: double-click window in 10ms, 0 = no double-click
+       * Short presses are sent after this window has passed
+       */
+      byte dblclick;
+
+      /**
+       * Gesture: target for the double-click pulse, 0 = target
        */
-      byte last = LOW;
+      unsigned int dblTarget;
 
     } asbIoDIn;
 
+    /**
+     * Direct input runtime data
+     */
+    typedef struct {
+
+      /**
+       * Last received state
+       */
+      byte last;
+
+      /**
+       * Input is in use, false if unused or overridden by EEPROM
+       */
+      boolean active;
+
+      /**
+       * Lower 16 bit of millis() when the pin last changed
+       */
+      unsigned int since;
+
+      /**
+       * Index of the port group of this input
+       */
+      byte group;
+
+      /**
+       * Bit of this input inside its port
+       */
+      byte mask;
+
+    } asbIoDInState;
+
+    /**
+     * Bytes of asbIoDIn kept in RAM for EEPROM inputs
+     * The gesture fields starting at hold are only kept in asbIoDInGesture
+     */
+    #define ASB_IO_DIN_STORED offsetof(asbIoDIn, hold)
+
+    /**
+     * Gesture input data
+     * Only reserved for ASB_IO_DIN_GESTURE inputs
+     */
+    typedef struct {
+
+      /**
+       * Input index, flash inputs first, 0xFF if unused
+       */
+      byte item;
+
+      /**
+       * Gesture fields of asbIoDIn starting at hold
+       */
+      byte timing[sizeof(asbIoDIn) - ASB_IO_DIN_STORED];
+
+      /**
+       * Current phase, ASB_IO_DIN_G_*
+       */
+      byte phase;
+
+      /**
+       * Last known dimming level in %
+       */
+      byte level;
+
+      /**
+       * Lower 16 bit of millis() of the last phase change or step
+       */
+      unsigned int timer;
+
+    } asbIoDInGesture;
+
+    /**
+     * Direct input port group
+     * All inputs sharing a hardware port are sampled with one read
+     */
+    typedef struct {
+
+      /**
+       * Hardware port, see asbPortOf()
+       */
+      byte port;
+
+      /**
+       * Bits of inverted inputs
+       */
+      byte invert;
+
+      /**
+       * Last sample after inversion, may still bounce
+       */
+      byte raw;
+
+      /**
+       * Bits of inputs which differ from their accepted state
+       */
+      byte pending;
+
+    } asbIoDInPort;
+
+    #ifdef ASB_IO_DIN_PCINT
+        /**
+         * Latched input edge
+         */
+        typedef struct {
+
+          /**
+           * Hardware port
+           */
+          byte port;
+
+          /**
+           * Port sample after the edge, not inverted
+           */
+          byte sample;
+
+          /**
+           * Lower 16 bit of millis() at the edge
+           */
+          unsigned int time;
+
+        } asbIoDInEdge;
+    #endif
+
+    /**
+     * Check a single input configuration at compile time
+     * @param cfg asbIoDIn configuration
+     * @return true if valid
+     */
+    constexpr bool asbIoDInValid(const asbIoDIn &cfg) {
+        return cfg.pin != 0x00 && cfg.pin != 0xFF && cfg.mode <= ASB_IO_DIN_GESTURE;
+    }
+
+    /**
+     * Check a table of input configurations at compile time
+     * @param table array of asbIoDIn configurations
+     * @param items number of entries
+     * @return true if all entries are valid
+     */
+    constexpr bool asbIoDInValid(const asbIoDIn *table, unsigned int items) {
+        return items == 0 || (asbIoDInValid(table[0]) && asbIoDInValid(table+1, items-1));
+    }
+
+    /**
+     * Declare a validated input table in flash
+     *
+     * Entries use the field order of asbIoDIn:
+     *   ASB_IO_DIN_TABLE(inputs, {7, 0x1001, true, true, ASB_IO_DIN_BTOGGLE, 20});
+     *
+     * @param name name of the table
+     * @param ... asbIoDIn initializers
+     */
+    #define ASB_IO_DIN_TABLE(name, ...) \
+        constexpr asbIoDIn name[] PROGMEM = { __VA_ARGS__ }; \
+        static_assert(sizeof(name)/sizeof(asbIoDIn) < 0xFF, "Too many inputs in " #name); \
+        static_assert(asbIoDInValid(name, sizeof(name)/sizeof(asbIoDIn)), "Invalid input in " #name)
+
     /**
      * Digital input module
      * @see ASB_IO
@@ -78,14 +316,191 @@
     class ASB_IO_DIN : public ASB_IO {
         private:
             /**
-             * Number of configured inputs
+             * Number of inputs configured in EEPROM
              */
              byte _items;
 
             /**
-             * Array of configured inputs
+             * Inputs configured in EEPROM, ASB_IO_DIN_STORED bytes each
+             */
+             byte *_config;
+
+            /**
+             * Number of inputs configured in flash
+             */
+             byte _tableItems;
+
+            /**
+             * Array of inputs configured in flash
+             */
+             const asbIoDIn *_table;
+
+            /**
+             * Runtime data, flash inputs first
+             */
+             asbIoDInState *_state;
+
+            /**
+             * Active inputs sorted by target
+             */
+             asbIoIndex *_index;
+
+            /**
+             * Number of index entries
+             */
+             byte _indexItems;
+
+            /**
+             * Index matches current configuration
+             */
+             bool _indexed;
+
+            /**
+             * Number of port groups in use
+             */
+             byte _portItems;
+
+            /**
+             * Port groups, up to one per input
+             */
+             asbIoDInPort *_ports;
+
+            /**
+             * Number of gesture blocks
+             */
+             byte _gestureItems;
+
+            /**
+             * Gesture blocks, one per ASB_IO_DIN_GESTURE input
+             */
+             asbIoDInGesture *_gesture;
+
+            /**
+             * Some gestures are in progress and need timer checks
+             */
+             bool _gestures;
+
+            /**
+             * Find the gesture block of an input
+             * @param i input index, flash inputs first
+             * @return asbIoDInGesture pointer, NULL if the input has none
+             */
+            asbIoDInGesture *gestureOf(byte i);
+
+            /**
+             * Get configuration of an input
+             * @param i input index, flash inputs first
+             * @param cfg asbIoDIn reference to store the configuration
+             * @return bool true if input is active
+             */
+            bool cfgItem(byte i, asbIoDIn &cfg);
+
+            /**
+             * Rebuild the target index from all active inputs
+             */
+            void cfgIndex(void);
+
+            /**
+             * Set up pin, assign port group and request current group state
+             * @param i input index, flash inputs first
+             * @param cfg asbIoDIn configuration
+             */
+            void cfgInit(byte i, asbIoDIn &cfg);
+
+            /**
+             * Debounce a new sample of a port group
+             * @param g port group index
+             * @param sample port sample after inversion
+             * @param now lower 16 bit of millis() when the sample was taken
+             */
+            void scan(byte g, byte sample, unsigned int now);
+
+            #ifdef ASB_IO_DIN_PCINT
+                /**
+                 * Instance using pin change interrupts, NULL if polling
+                 */
+                static ASB_IO_DIN *_pcOwner;
+
+                /**
+                 * Ports watched by the interrupt handler
+                 */
+                static byte _pcPorts[ASB_IO_DIN_PCINT_PORTS];
+
+                /**
+                 * Last sample of each watched port
+                 */
+                static volatile byte _pcLast[ASB_IO_DIN_PCINT_PORTS];
+
+                /**
+                 * Number of watched ports
+                 */
+                static volatile byte _pcItems;
+
+                /**
+                 * Edge ring buffer
+                 */
+                static volatile asbIoDInEdge _edges[ASB_IO_DIN_PCINT];
+
+                /**
+                 * Next edge to write, changed by interrupt
+                 */
+                static volatile byte _edgeHead;
+
+                /**
+                 * Next edge to read
+                 */
+                static volatile byte _edgeTail;
+
+                /**
+                 * Edges were lost or ports have to be resynced, forces polling
+                 */
+                static volatile bool _edgeLost;
+
+                /**
+                 * All configured pins are watched by interrupts
+                 */
+                bool _pcArmed;
+
+                /**
+                 * Configuration changed, interrupts have to be set up again
+                 */
+                bool _pcDirty;
+
+                /**
+                 * Enable pin change interrupts for all configured inputs
+                 * @return bool true if all inputs are covered
+                 */
+                bool pcArm(void);
+            #endif
+
+            /**
+             * Handle a debounced change of an input
+             * @param i input index, flash inputs first
+             * @param cfg asbIoDIn configuration
+             * @param state new input state after inversion
+             * @param now lower 16 bit of millis() of the change
+             */
+            void change(byte i, asbIoDIn &cfg, byte state, unsigned int now);
+
+            /**
+             * Advance gestures waiting for a timeout
+             * @param now lower 16 bit of millis()
+             */
+            void gestureTimer(unsigned int now);
+
+            /**
+             * Send a dimming step of a gesture input
+             * @param gesture asbIoDInGesture of the input
+             * @param cfg asbIoDIn configuration
              */
-             asbIoDIn *_config;
+            void gestureStep(asbIoDInGesture &gesture, asbIoDIn &cfg);
+
+            /**
+             * Toggle the group of a gesture input
+             * @param i input index, flash inputs first
+             * @param cfg asbIoDIn configuration
+             */
+            void gestureToggle(byte i, asbIoDIn &cfg);
 
         public:
             /**
@@ -95,6 +510,25 @@
              */
             ASB_IO_DIN(byte cfgId);
 
+            /**
+             * Initialize with inputs stored in flash
+             *
+             * Flash inputs are used without copying them to RAM. Inputs
+             * stored in EEPROM for the same pin take precedence.
+             *
+             * @param read configuration objects using id X, 1-15
+             * @param table PROGMEM array of inputs, see ASB_IO_DIN_TABLE
+             * @param items number of inputs in table
+             */
+            ASB_IO_DIN(byte cfgId, const asbIoDIn *table, byte items);
+
+            /**
+             * Initialize with inputs stored in flash
+             * @param read configuration objects using id X, 1-15
+             * @param table PROGMEM array of inputs, see ASB_IO_DIN_TABLE
+             */
+            template <size_t N> ASB_IO_DIN(byte cfgId, const asbIoDIn (&table)[N]) : ASB_IO_DIN(cfgId, table, N) {}
+
             /**
              * Read configuration block starting at provided address
              * @param read configuration object from address X
@@ -110,18 +544,38 @@
             bool cfgWrite(asbIoDIn &cfg);
 
             /**
-             * Reset current configuration and free memory
+             * Reset current configuration and release memory
              * @return bool true if successful
              */
             bool cfgReset(void);
 
             /**
-             * Reserve memory for configuration
-             * @param objects number of configuration objects
+             * Reserve memory for configuration and activate flash inputs
+             * @param objects number of configuration objects in EEPROM
              * @return bool true if successful
              */
             bool cfgReserve(byte objects);
 
+            /**
+             * Commands this module wants to receive
+             * @return byte ASB_IO_CMD() bits
+             */
+            byte cfgCommands(void);
+
+            /**
+             * Group targets this module wants to receive
+             * @param n number of the target, starting at 0
+             * @param target reference to store the target
+             * @return bool false if there are no more targets
+             */
+            bool cfgTarget(byte n, unsigned int &target);
+
+            /**
+             * Configuration memory was moved inside the controller arena
+             * @param offset number of bytes the memory was moved
+             */
+            void cfgRelocate(int offset);
+
             /**
              * Process incoming packet
              * @param pkg Packet struct
@@ -135,6 +589,16 @@
              */
             bool loop(void);
 
+            /**
+             * Attach an input using a complete configuration
+             *
+             * Required for ASB_IO_DIN_GESTURE timings, unused fields must be 0
+             *
+             * @param cfg asbIoDIn configuration
+             * @return true if successfully added
+             */
+            bool attach(asbIoDIn &cfg);
+
             /**
              * Attach an input to a set of metadata
              *
@@ -148,6 +612,54 @@
              * @return true if successfully added
              */
             bool attach(unsigned int target, byte pin, byte mode, bool invert, bool pullup);
+
+            /**
+             * Attach an input to a set of metadata using a custom debounce time
+             *
+             * @param target target address between 0x0001 and 0xFFFF
+             * @param pin Pin number to monitor
+             * @param mode ASB_IN_DIRECT = Direct output, _TOGGLE = Toggle output when HIGH
+             * @param invert input
+             * @param pullup use internal pull-up resistor
+             * @param debounce time in ms the input has to be stable, 0 = default
+             * @return true if successfully added
+             */
+            bool attach(unsigned int target, byte pin, byte mode, bool invert, bool pullup, byte debounce);
+
+            #ifdef ASB_IO_DIN_PCINT
+                /**
+                 * Use pin change interrupts to detect input changes
+                 *
+                 * Edges are latched together with their time and handled
+                 * by the next loop(), which no longer scans any ports while
+                 * nothing changed. Only one instance can use interrupts and
+                 * all its pins must support pin change interrupts, otherwise
+                 * the inputs keep being polled.
+                 *
+                 * @param enable true to use interrupts, false to poll
+                 * @return bool true if successful
+                 */
+                bool useInterrupts(bool enable);
+
+                /**
+                 * Latch changed ports into the edge buffer
+                 *
+                 * Called from the pin change interrupts. If these vectors
+                 * are shared with other code, define ASB_IO_DIN_PCINT_NOISR
+                 * and call latch() from your own handlers.
+                 */
+                static void latch(void);
+            #endif
+
+            /**
+             * Detach an input
+             *
+             * Removes all configuration entries for the supplied pin from EEPROM
+             *
+             * @param pin Pin number
+             * @return true if successfully removed
+             */
+            bool detach(byte pin);
     };
 
 #endif /* ASB_IO_DIN__H */
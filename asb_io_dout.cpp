@@ -26,158 +26,371 @@
     #include <inttypes.h>
     #include <asb.h>
 
+    /**
+     * LED dimming curve, 8 bit PWM value for 0-100%
+     * Precomputed from 2^(x / (100 * log10(2) / log10(255))) - 1
+     */
+    const byte asbIoDOutGamma[101] PROGMEM = {
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   1,   1,   1,   1,   1,   1,   1,
+          2,   2,   2,   2,   2,   2,   3,   3,   3,   3,
+          4,   4,   4,   5,   5,   5,   6,   6,   7,   7,
+          8,   8,   9,   9,  10,  11,  11,  12,  13,  14,
+         14,  15,  16,  17,  18,  20,  21,  22,  23,  25,
+         26,  28,  30,  31,  33,  35,  37,  39,  42,  44,
+         47,  50,  53,  56,  59,  62,  66,  70,  74,  78,
+         83,  87,  93,  98, 104, 110, 116, 123, 130, 137,
+        145, 153, 162, 172, 181, 192, 203, 214, 227, 240,
+        253
+    };
+
     ASB_IO_DOUT::ASB_IO_DOUT(byte cfgId) {
         _cfgId=cfgId;
     }
 
-    bool ASB_IO_DOUT::cfgRead(unsigned int address) {
-        if(_control == NULL) return false;
-        byte temp,temp2;
+    ASB_IO_DOUT::ASB_IO_DOUT(byte cfgId, const asbIoDOut *table, byte items) {
+        _cfgId=cfgId;
+        _table=table;
+        _tableItems=items;
+    }
 
-        byte check = EEPROM.read(address);
-        if(check == 0xFF || check == 0x00) return false;
-        if(((check & 0xF0) >> 4) != _cfgId) return false;
+    bool ASB_IO_DOUT::cfgItem(byte i, asbIoDOut &cfg) {
+        if(_state == NULL || i >= (_tableItems + _items) || !_state[i].active) return false;
 
-        for(temp=0; temp<_items; temp++) {
-            if(_config[temp].pin == 0xFF || _config[temp].pin == 0x00) { //Slot is free
-                EEPROM.get(address+1, _config[temp]);
+        if(i < _tableItems) {
+            memcpy_P(&cfg, &_table[i], sizeof(asbIoDOut));
+        }else{
+            cfg = _config[i - _tableItems];
+        }
+        return true;
+    }
 
-                if(_config[temp].pin == 0xFF || _config[temp].pin == 0x00) return false;
+    void ASB_IO_DOUT::cfgInit(byte i, asbIoDOut &cfg) {
+        byte temp;
 
-                ::pinMode(_config[temp].pin, OUTPUT);
+        ::pinMode(cfg.pin, OUTPUT);
 
-                temp2 = _config[temp].init;
-                _config[temp].last = temp2;
+        temp = cfg.init;
+        _state[i].last = temp;
+        _state[i].level = temp ? 100 : 0;
+        _state[i].goal = _state[i].level;
+        _state[i].pulse = -1;
+        _state[i].active = true;
+        _indexed = false;
+        _control->dispatchUpdate();
 
-                if(_config[temp].invert) temp2 ^= 0xFF;
-                //@TODO analog
-                ::digitalWrite(_config[temp].pin, temp2);
+        if(cfg.invert) temp ^= 0xFF;
+        //@TODO analog
+        ::digitalWrite(cfg.pin, temp);
 
-                //Poll other nodes for last state
-                byte data[1] = {ASB_CMD_REQ};
-                _control->asbSend(ASB_PKGTYPE_MULTICAST, _config[temp].target, sizeof(data), data);
+        //Poll other nodes for last state
+        _control->asbRequest(cfg.target);
+    }
 
+    bool ASB_IO_DOUT::cfgRead(unsigned int address) {
+        if(_control == NULL || _state == NULL) return false;
+        byte temp,i;
+
+        byte check = asbEEPROM.read(address);
+        if(check == 0xFF || check == 0x00) return false;
+        if(((check & 0xF0) >> 4) != _cfgId) return false;
+
+        for(temp=_tableItems; temp<(_tableItems + _items); temp++) {
+            if(!_state[temp].active) { //Slot is free
+                asbIoDOut &cfg = _config[temp - _tableItems];
+                if(!cfgLoad(address, &cfg, sizeof(cfg))) return false;
+                if(cfg.pin == 0xFF || cfg.pin == 0x00) return false;
+
+                //EEPROM overrides flash configuration for the same pin
+                for(i=0; i<_tableItems; i++) {
+                    if(pgm_read_byte(&_table[i].pin) == cfg.pin) _state[i].active = false;
+                }
+
+                cfgInit(temp, cfg);
                 return true;
             }
         }
         return false;
     }
 
-    bool ASB_IO_DOUT::cfgWrite(asbIoDOut &cfg) {
-        if(_control == NULL) {
-            #ifdef ASB_DEBUG
-                Serial.println(F("No controller...")); Serial.flush();
-            #endif
-            return false;
-        }
-        
-        unsigned int address;
-
-        if(cfg.pin == 0xFF) {
-            #ifdef ASB_DEBUG
-                Serial.println(F("No pin...")); Serial.flush();
-            #endif
-            return false;
-        }
+    static_assert(sizeof(asbIoDOut) + 2 * ASB_CFG_HEADER <= ASB_EEPROM_CACHE, "ASB_EEPROM_CACHE is too small for asbIoDOut");
 
-        address = _control->cfgFindFreeblock(sizeof(cfg)+1, _cfgId);
-        if(address == 0) {
-            #ifdef ASB_DEBUG
-                Serial.println(F("Got no address...")); Serial.flush();
-            #endif
-            return false;
-        }
-        address++; //Skip header
-        EEPROM.put(address, cfg);
-        
-        return true;
+    bool ASB_IO_DOUT::cfgWrite(asbIoDOut &cfg) {
+        return cfgStore(&cfg, sizeof(cfg));
     }
 
     bool ASB_IO_DOUT::cfgReset(void) {
-        if(_config == NULL) return true;
-        free(_config);
+        if(_state != NULL && _control != NULL) {
+            for(byte i=0; i<(_tableItems + _items); i++) {
+                if(_state[i].active && _state[i].pulse >= 0) _control->timerDetach(_state[i].pulse);
+            }
+            _control->arenaAlloc(this, 0);
+        }
+        _config = NULL;
+        _state = NULL;
+        _index = NULL;
+        _indexItems = 0;
+        _indexed = false;
+        if(_control != NULL) _control->dispatchUpdate();
         _items = 0;
+        _fading = false;
         return true;
     }
 
     bool ASB_IO_DOUT::cfgReserve(byte objects) {
+        asbIoDOut cfg;
+        byte i;
+
         cfgReset();
-        _config = (asbIoDOut *) calloc(objects, sizeof(asbIoDOut));
-        if(_config==NULL) {
-            _items = 0;
-            return false;
-        }else{
-            _items = objects;
-            return true;
+        if((_tableItems + objects) == 0) return true;
+        if(_control == NULL) return false;
+
+        //EEPROM configuration first, followed by target index and runtime data
+        _config = (asbIoDOut *) _control->arenaAlloc(this, objects * sizeof(asbIoDOut) + (_tableItems + objects) * (sizeof(asbIoIndex) + sizeof(asbIoDOutState)));
+        if(_config == NULL) return false;
+        _index = (asbIoIndex *) &_config[objects];
+        _state = (asbIoDOutState *) &_index[_tableItems + objects];
+        if(objects == 0) _config = NULL;
+        _items = objects;
+
+        //Flash outputs are used directly, EEPROM may override them later
+        for(i=0; i<_tableItems; i++) {
+            memcpy_P(&cfg, &_table[i], sizeof(asbIoDOut));
+            if(asbIoDOutValid(cfg)) cfgInit(i, cfg);
+        }
+        return true;
+    }
+
+    void ASB_IO_DOUT::cfgIndex(void) {
+        asbIoDOut cfg, other;
+        byte i, p, port;
+
+        _indexItems = 0;
+        for(i=0; i<(_tableItems + _items); i++) {
+            if(!cfgItem(i, cfg)) continue;
+
+            //Digital outputs of the same group and port are switched together by the first one
+            if(cfg.mode == ASB_IO_DOUT_DIO) {
+                port = asbPortOf(cfg.pin);
+                for(p=0; p<_indexItems; p++) {
+                    if(
+                        _index[p].target == cfg.target &&
+                        cfgItem(_index[p].item, other) &&
+                        other.mode == ASB_IO_DOUT_DIO &&
+                        asbPortOf(other.pin) == port
+                    ) break;
+                }
+                if(p < _indexItems) {
+                    _state[_index[p].item].mask |= asbPortMask(cfg.pin);
+                    if(cfg.invert) _state[_index[p].item].invert |= asbPortMask(cfg.pin);
+                    continue;
+                }
+                _state[i].mask = asbPortMask(cfg.pin);
+                _state[i].invert = cfg.invert ? _state[i].mask : 0;
+            }
+
+            _index[_indexItems].target = cfg.target;
+            _index[_indexItems].item = i;
+            _indexItems++;
         }
+        asbIoIndexSort(_index, _indexItems); //Outputs for all targets (0) come first
+        _indexed = true;
+    }
+
+    byte ASB_IO_DOUT::cfgCommands(void) {
+        return ASB_IO_CMD(ASB_CMD_0B) | ASB_IO_CMD(ASB_CMD_1B) | ASB_IO_CMD(ASB_CMD_PER);
+    }
+
+    bool ASB_IO_DOUT::cfgTarget(byte n, unsigned int &target) {
+        if(!_indexed) cfgIndex();
+        if(n >= _indexItems) return false;
+        target = _index[n].target;
+        return true;
+    }
+
+    void ASB_IO_DOUT::cfgRelocate(int offset) {
+        cfgMove(_config, offset);
+        cfgMove(_state, offset);
+        cfgMove(_index, offset);
     }
 
     bool ASB_IO_DOUT::process(asbPacket &pkg) {
         if(_control == NULL) return false;
-        byte i,temp;
-        
-        if(pkg.len > 0) {
-            switch(pkg.data[0]) {
-                //@TODO ASB_IO_DOUT_PULSE
-                case ASB_CMD_1B:
-                    if(pkg.meta.type != ASB_PKGTYPE_MULTICAST || pkg.len != 2) break;
-                    for(i=0; i<_items; i++) {
-                        if(_config[i].pin != 0xFF && _config[i].pin != 0x00 && (_config[i].target == pkg.meta.target || _config[i].target == 0)) {
-                            if(_config[i].invert) {
-                                digitalWrite(_config[i].pin, (pkg.data[1] ^ 1));
-                            }else{
-                                digitalWrite(_config[i].pin, pkg.data[1]);
-                            }
-                        }
-                    }
-                break;
-
-                case ASB_CMD_PER:
-                    if(pkg.meta.type != ASB_PKGTYPE_MULTICAST || pkg.len != 2) break;
-                    for(i=0; i<_items; i++) {
-                        if(_config[i].pin != 0xFF && _config[i].pin != 0x00 && (_config[i].target == pkg.meta.target || _config[i].target == 0)) {
-                            switch(_config[i].mode) {
-                                case ASB_IO_DOUT_LIN:
-                                    if(_config[i].invert) {
-                                        analogWrite(_config[i].pin, map(pkg.data[1], 0, 100, 255, 0));
-                                    }else{
-                                        analogWrite(_config[i].pin, map(pkg.data[1], 0, 100, 0, 255));
-                                    }
-                                break;
-                                case ASB_IO_DOUT_LED:
-                                    temp = pow (2, (pkg.data[1] / _ledFactor)) - 1;
-                                    if(_config[i].invert) temp = 255-temp;
-                                    analogWrite(_config[i].pin, temp);
-                                break;
-                                //@TODO ASB_IO_DOUT_SER
-                            }
-                        }
-                    }
-                break;
-            }
+        byte p;
+
+        if(pkg.len < 1 || pkg.meta.type != ASB_PKGTYPE_MULTICAST) return true;
+        if(pkg.data[0] == ASB_CMD_0B) {
+            if(pkg.len != 1) return true;
+        }else if(pkg.data[0] != ASB_CMD_1B && pkg.data[0] != ASB_CMD_PER) {
+            return true;
+        }else if(pkg.len != 2) {
+            return true;
+        }
+        if(!_indexed) cfgIndex();
+
+        //Outputs for all targets (0) are sorted first
+        for(p=0; p<_indexItems && _index[p].target == 0; p++) {
+            apply(_index[p].item, pkg);
+        }
+        if(pkg.meta.target == 0) return true;
+
+        for(p=asbIoIndexFind(_index, _indexItems, pkg.meta.target); p<_indexItems && _index[p].target == pkg.meta.target; p++) {
+            apply(_index[p].item, pkg);
         }
         return true;
     }
 
+    void ASB_IO_DOUT::apply(byte i, asbPacket &pkg) {
+        asbIoDOut cfg;
+
+        if(!cfgItem(i, cfg)) return;
+
+        switch(pkg.data[0]) {
+            case ASB_CMD_0B:
+            case ASB_CMD_1B:
+                if(cfg.mode == ASB_IO_DOUT_PULSE || cfg.mode == ASB_IO_DOUT_STAIR) {
+                    if(pkg.data[0] == ASB_CMD_0B || pkg.data[1] > 0) {
+                        pulseStart(i, cfg);
+                    }else if(cfg.mode == ASB_IO_DOUT_STAIR) {
+                        if(_state[i].pulse >= 0) _control->timerDetach(_state[i].pulse);
+                        _state[i].pulse = -1;
+                        set(cfg, 0);
+                    }
+                    break;
+                }
+                if(pkg.data[0] == ASB_CMD_0B) break;
+
+                if(cfg.mode == ASB_IO_DOUT_DIO) { //Whole group at once, see cfgIndex()
+                    asbPortWrite(asbPortOf(cfg.pin), _state[i].mask, (pkg.data[1] ? 0xFF : 0x00) ^ _state[i].invert);
+                    break;
+                }
+
+                set(cfg, pkg.data[1]);
+                //Stop running fades
+                _state[i].level = pkg.data[1] ? 100 : 0;
+                _state[i].goal = _state[i].level;
+            break;
+
+            case ASB_CMD_PER:
+                if(cfg.mode != ASB_IO_DOUT_LIN && cfg.mode != ASB_IO_DOUT_LED) break; //@TODO ASB_IO_DOUT_SER
+                if(cfg.fade > 0 && _state[i].level == _state[i].goal) { //Start new fade
+                    _state[i].timer = millis();
+                }
+                _state[i].goal = (pkg.data[1] > 100) ? 100 : pkg.data[1];
+                if(cfg.fade > 0) {
+                    _fading = true;
+                }else{
+                    _state[i].level = _state[i].goal;
+                    pwm(cfg, _state[i].level);
+                }
+            break;
+        }
+    }
+
+    void ASB_IO_DOUT::set(asbIoDOut &cfg, byte state) {
+        if(cfg.invert) {
+            digitalWrite(cfg.pin, (state ^ 1));
+        }else{
+            digitalWrite(cfg.pin, state);
+        }
+    }
+
+    void ASB_IO_DOUT::pulseStart(byte i, asbIoDOut &cfg) {
+        unsigned long duration = (cfg.duration > 0) ? (cfg.duration * 100UL) : 1000;
+
+        if(_state[i].pulse >= 0) _control->timerDetach(_state[i].pulse);
+        _state[i].pulse = _control->timerAttach(duration, 0, pulseEnd, this, i);
+
+        if(_state[i].pulse < 0) { //Never switch on without a way to switch off
+            #ifdef ASB_DEBUG
+                Serial.println(F("No timer...")); Serial.flush();
+            #endif
+            return;
+        }
+        set(cfg, 1);
+    }
+
+    void ASB_IO_DOUT::pulseEnd(void *arg, byte i) {
+        ASB_IO_DOUT *module = (ASB_IO_DOUT *)arg;
+        asbIoDOut cfg;
+
+        if(!module->cfgItem(i, cfg)) return;
+        module->_state[i].pulse = -1;
+        module->set(cfg, 0);
+
+        if(cfg.mode == ASB_IO_DOUT_STAIR) {
+            byte data[2] = {ASB_CMD_1B, 0};
+            module->_control->asbSend(ASB_PKGTYPE_MULTICAST, cfg.target, sizeof(data), data);
+        }
+    }
+
+    void ASB_IO_DOUT::pwm(asbIoDOut &cfg, byte level) {
+        byte temp;
+
+        if(cfg.mode == ASB_IO_DOUT_LED) {
+            temp = pgm_read_byte(&asbIoDOutGamma[level]);
+        }else{
+            temp = ((unsigned int)level * 255) / 100;
+        }
+        if(cfg.invert) temp = 255-temp;
+        analogWrite(cfg.pin, temp);
+    }
+
     bool ASB_IO_DOUT::loop(void) {
         if(_control == NULL) return false;
+        if(!_fading) return true;
+
+        asbIoDOut cfg;
+        unsigned int now = millis();
+        unsigned int time, steps;
+        byte i;
+
+        _fading = false;
+        for(i=0; i<(_tableItems + _items); i++) {
+            if(_state[i].level == _state[i].goal || !cfgItem(i, cfg)) continue;
+
+            //fade is the time for 100 steps in 100ms, so each 1% step takes fade ms
+            time = (cfg.fade > 0) ? cfg.fade : 1;
+            steps = (unsigned int)(now - _state[i].timer) / time;
+            if(steps > 0) {
+                _state[i].timer += steps * time;
+                if(_state[i].level < _state[i].goal) {
+                    _state[i].level = (steps < (unsigned int)(_state[i].goal - _state[i].level)) ? (_state[i].level + steps) : _state[i].goal;
+                }else{
+                    _state[i].level = (steps < (unsigned int)(_state[i].level - _state[i].goal)) ? (_state[i].level - steps) : _state[i].goal;
+                }
+                pwm(cfg, _state[i].level);
+            }
+
+            if(_state[i].level != _state[i].goal) {
+                _fading = true;
+            }
+        }
         return true;
     }
 
     bool ASB_IO_DOUT::attach(unsigned int target, byte pin, byte mode, bool invert, bool init) {
-        if(_control == NULL) return false;
-        
-        asbIoDOut cfg;
+        asbIoDOut cfg = {};
 
         cfg.target = target;
         cfg.pin = pin;
         cfg.invert = invert;
         cfg.mode = mode;
         cfg.init = init;
+        return attach(cfg);
+    }
+
+    bool ASB_IO_DOUT::attach(asbIoDOut &cfg) {
+        if(_control == NULL) return false;
+        if(!asbIoDOutValid(cfg)) return false;
+
+        if(_control->arenaAvailable() < (sizeof(asbIoDOut) + sizeof(asbIoIndex) + sizeof(asbIoDOutState))) return false;
+        if(!cfgWrite(cfg)) return false;
+        return cfgReload();
+    }
 
-        cfgWrite(cfg);
-        _control->hookDetachModule(_cfgId);
-        return _control->hookAttachModule(this);
+    bool ASB_IO_DOUT::detach(byte pin) {
+        return cfgFreePin(pin);
     }
 
 #endif /* ASB_IO_DOUT__C */
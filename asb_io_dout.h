@@ -23,10 +23,11 @@
 #define ASB_IO_DOUT__H
 
     #define ASB_IO_DOUT_DIO   0 //Digital IO
-    #define ASB_IO_DOUT_PULSE 1 //Pulse for 1 second
+    #define ASB_IO_DOUT_PULSE 1 //Pulse for duration (default 1 second), e.g. door opener
     #define ASB_IO_DOUT_LIN   2 //Linear PWM
     #define ASB_IO_DOUT_LED   3 //LED PWM
     #define ASB_IO_DOUT_SER   4 //Servo PWM
+    #define ASB_IO_DOUT_STAIR 5 //On for duration, retriggerable, sends off to the group - e.g. staircase light
 
     #include <Arduino.h>
     #include <inttypes.h>
@@ -35,13 +36,17 @@
     /**
      * Direct output struct
      * Contains pin numbers and configuration for outputs
+     *
+     * This is stored as-is in EEPROM or flash, runtime data is kept in
+     * asbIoDOutState. Fields are ordered for aggregate initialization,
+     * new fields must be appended and use 0 as default.
      */
     typedef struct {
 
       /**
        * Affected pin
        */
-      byte pin = 0xFF;
+      byte pin;
 
       /**
        * Target address
@@ -49,30 +54,120 @@
        * Milticast/Broadcast: 0x0001 - 0xFFFF
        * 0x0 -> everything
        */
-      unsigned int target = 0;
+      unsigned int target;
 
       /**
        * Is pin inverted?
        */
-      boolean invert = false;
+      boolean invert;
 
       /**
        * Initial pin state
        */
-      boolean init = false;
+      boolean init;
 
       /**
        * Output mode
        */
-      byte mode = ASB_IO_DIN_DIRECT;
+      byte mode;
 
       /**
-       * Last received state
+       * PWM fade time from 0 to 100% in 100ms, 0 = change immediately
+       */
+      byte fade;
+
+      /**
+       * PULSE/STAIR on-time in 100ms, 0 = 1 second
        */
-      byte last = LOW;
+      unsigned int duration;
 
   } asbIoDOut;
 
+    /**
+     * Direct output runtime data
+     */
+    typedef struct {
+
+      /**
+       * Last received state
+       */
+      byte last;
+
+      /**
+       * Output is in use, false if unused or overridden by EEPROM
+       */
+      boolean active;
+
+      /**
+       * PWM: current level in %
+       */
+      byte level;
+
+      /**
+       * PWM: requested level in %
+       */
+      byte goal;
+
+      /**
+       * PWM: lower 16 bit of millis() of the last fade step
+       */
+      unsigned int timer;
+
+      /**
+       * PULSE/STAIR: running timer, -1 if off
+       */
+      asbTimerId pulse;
+
+      /**
+       * DIO: port bits switched together with this output, see asbPortMask()
+       */
+      byte mask;
+
+      /**
+       * DIO: inverted bits of mask
+       */
+      byte invert;
+
+    } asbIoDOutState;
+
+    /**
+     * LED dimming curve used by ASB_IO_DOUT_LED, 8 bit PWM value for 0-100%
+     */
+    extern const byte asbIoDOutGamma[101];
+
+    /**
+     * Check a single output configuration at compile time
+     * @param cfg asbIoDOut configuration
+     * @return true if valid
+     */
+    constexpr bool asbIoDOutValid(const asbIoDOut &cfg) {
+        return cfg.pin != 0x00 && cfg.pin != 0xFF && cfg.mode <= ASB_IO_DOUT_STAIR;
+    }
+
+    /**
+     * Check a table of output configurations at compile time
+     * @param table array of asbIoDOut configurations
+     * @param items number of entries
+     * @return true if all entries are valid
+     */
+    constexpr bool asbIoDOutValid(const asbIoDOut *table, unsigned int items) {
+        return items == 0 || (asbIoDOutValid(table[0]) && asbIoDOutValid(table+1, items-1));
+    }
+
+    /**
+     * Declare a validated output table in flash
+     *
+     * Entries use the field order of asbIoDOut:
+     *   ASB_IO_DOUT_TABLE(outputs, {9, 0x1001, false, false, ASB_IO_DOUT_LED});
+     *
+     * @param name name of the table
+     * @param ... asbIoDOut initializers
+     */
+    #define ASB_IO_DOUT_TABLE(name, ...) \
+        constexpr asbIoDOut name[] PROGMEM = { __VA_ARGS__ }; \
+        static_assert(sizeof(name)/sizeof(asbIoDOut) < 0xFF, "Too many outputs in " #name); \
+        static_assert(asbIoDOutValid(name, sizeof(name)/sizeof(asbIoDOut)), "Invalid output in " #name)
+
     /**
      * Digital output module
      * @see ASB_IO
@@ -80,19 +175,107 @@
     class ASB_IO_DOUT : public ASB_IO {
         private:
             /**
-             * Number of configured inputs
+             * Number of outputs configured in EEPROM
              */
              byte _items;
 
             /**
-             * Array of configured inputs
+             * Array of outputs configured in EEPROM
              */
              asbIoDOut *_config;
 
-             /**
-              * LED dimming multiplier for 8 bit
-              */
-             const float _ledFactor = (100 * log10(2))/(log10(255));
+            /**
+             * Number of outputs configured in flash
+             */
+             byte _tableItems;
+
+            /**
+             * Array of outputs configured in flash
+             */
+             const asbIoDOut *_table;
+
+            /**
+             * Runtime data, flash outputs first
+             */
+             asbIoDOutState *_state;
+
+            /**
+             * Active outputs sorted by target
+             */
+             asbIoIndex *_index;
+
+            /**
+             * Number of index entries
+             */
+             byte _indexItems;
+
+            /**
+             * Index matches current configuration
+             */
+             bool _indexed;
+
+            /**
+             * Get configuration of an output
+             * @param i output index, flash outputs first
+             * @param cfg asbIoDOut reference to store the configuration
+             * @return bool true if output is active
+             */
+            bool cfgItem(byte i, asbIoDOut &cfg);
+
+            /**
+             * Rebuild the target index from all active outputs
+             *
+             * Digital outputs sharing group and port are merged into one
+             * entry so they can be switched with a single port write
+             */
+            void cfgIndex(void);
+
+            /**
+             * Apply a packet to an output
+             * @param i output index, flash outputs first
+             * @param pkg Packet struct, ASB_CMD_0B, ASB_CMD_1B or ASB_CMD_PER
+             */
+            void apply(byte i, asbPacket &pkg);
+
+            /**
+             * Set up pin and request current group state
+             * @param i output index, flash outputs first
+             * @param cfg asbIoDOut configuration
+             */
+            void cfgInit(byte i, asbIoDOut &cfg);
+
+            /**
+             * Some outputs are fading and need timer checks
+             */
+             bool _fading;
+
+            /**
+             * Switch a PULSE/STAIR output on and (re)start its timer
+             * @param i output index, flash outputs first
+             * @param cfg asbIoDOut configuration
+             */
+            void pulseStart(byte i, asbIoDOut &cfg);
+
+            /**
+             * Timer callback ending a pulse
+             * @param arg ASB_IO_DOUT instance
+             * @param i output index, flash outputs first
+             */
+            static void pulseEnd(void *arg, byte i);
+
+            /**
+             * Switch a digital output
+             * @param cfg asbIoDOut configuration
+             * @param state new state before inversion
+             */
+            void set(asbIoDOut &cfg, byte state);
+
+            /**
+             * Set PWM output to a level
+             * @param cfg asbIoDOut configuration
+             * @param level level in %
+             */
+            void pwm(asbIoDOut &cfg, byte level);
 
         public:
             /**
@@ -102,6 +285,25 @@
              */
             ASB_IO_DOUT(byte cfgId);
 
+            /**
+             * Initialize with outputs stored in flash
+             *
+             * Flash outputs are used without copying them to RAM. Outputs
+             * stored in EEPROM for the same pin take precedence.
+             *
+             * @param read configuration objects using id X, 1-15
+             * @param table PROGMEM array of outputs, see ASB_IO_DOUT_TABLE
+             * @param items number of outputs in table
+             */
+            ASB_IO_DOUT(byte cfgId, const asbIoDOut *table, byte items);
+
+            /**
+             * Initialize with outputs stored in flash
+             * @param read configuration objects using id X, 1-15
+             * @param table PROGMEM array of outputs, see ASB_IO_DOUT_TABLE
+             */
+            template <size_t N> ASB_IO_DOUT(byte cfgId, const asbIoDOut (&table)[N]) : ASB_IO_DOUT(cfgId, table, N) {}
+
             /**
              * Read configuration block starting at provided address
              * @param read configuration object from address X
@@ -117,18 +319,38 @@
             bool cfgWrite(asbIoDOut &cfg);
 
             /**
-             * Reset current configuration
+             * Reset current configuration and release memory
              * @return bool true if successful
              */
             bool cfgReset(void);
 
             /**
-             * Reserve memory for configuration
-             * @param objects number of configuration objects
+             * Reserve memory for configuration and activate flash outputs
+             * @param objects number of configuration objects in EEPROM
              * @return bool true if successful
              */
             bool cfgReserve(byte objects);
 
+            /**
+             * Commands this module wants to receive
+             * @return byte ASB_IO_CMD() bits
+             */
+            byte cfgCommands(void);
+
+            /**
+             * Group targets this module wants to receive
+             * @param n number of the target, starting at 0
+             * @param target reference to store the target
+             * @return bool false if there are no more targets
+             */
+            bool cfgTarget(byte n, unsigned int &target);
+
+            /**
+             * Configuration memory was moved inside the controller arena
+             * @param offset number of bytes the memory was moved
+             */
+            void cfgRelocate(int offset);
+
             /**
              * Process incoming packet
              * @param pkg Packet struct
@@ -142,6 +364,16 @@
              */
             bool loop(void);
 
+            /**
+             * Attach an output using a complete configuration
+             *
+             * Required for fade times, unused fields must be 0
+             *
+             * @param cfg asbIoDOut configuration
+             * @return true if successfully added
+             */
+            bool attach(asbIoDOut &cfg);
+
             /**
              * Attach an input to a set of metadata
              *
@@ -155,6 +387,16 @@
              * @return true if successfully added
              */
             bool attach(unsigned int target, byte pin, byte mode, bool invert, bool init);
+
+            /**
+             * Detach an output
+             *
+             * Removes all configuration entries for the supplied pin from EEPROM
+             *
+             * @param pin Pin number
+             * @return true if successfully removed
+             */
+            bool detach(byte pin);
     };
 
 #endif /* ASB_IO_DOUT__H */
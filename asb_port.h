@@ -0,0 +1,105 @@
+/**
+  aSysBus port access
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASB_PORT__H
+#define ASB_PORT__H
+
+    #include <Arduino.h>
+    #include <inttypes.h>
+
+    /**
+     * Port access
+     *
+     * Modules handling many pins group them by hardware port so all pins
+     * of a port can be sampled or switched with a single register access.
+     * This is used on AVR, where ports are 8 bit wide, or if
+     * ASB_PORT_REGISTER is defined - e.g. for host builds simulating ports.
+     * Other targets fall back to one digitalRead()/digitalWrite() per pin,
+     * each pin being its own port.
+     */
+    #if defined(__AVR__) && !defined(ASB_PORT_REGISTER)
+        #define ASB_PORT_REGISTER
+    #endif
+
+    #if defined(ASB_PORT_REGISTER) && defined(digitalPinToPort) && defined(portInputRegister) && defined(portOutputRegister) && defined(digitalPinToBitMask)
+
+        /**
+         * Get port of a pin
+         * @param pin Arduino pin number
+         * @return byte port number, NOT_A_PORT if invalid
+         */
+        inline byte asbPortOf(byte pin) {
+            return digitalPinToPort(pin);
+        }
+
+        /**
+         * Get bit of a pin inside its port
+         * @param pin Arduino pin number
+         * @return byte bitmask
+         */
+        inline byte asbPortMask(byte pin) {
+            return digitalPinToBitMask(pin);
+        }
+
+        /**
+         * Sample all pins of a port
+         * @param port port number
+         * @return byte current input levels
+         */
+        inline byte asbPortRead(byte port) {
+            if(port == NOT_A_PORT) return 0;
+            return *portInputRegister(port);
+        }
+
+        /**
+         * Switch pins of a port at once
+         * @param port port number
+         * @param mask bits to change
+         * @param value new levels, only bits in mask are used
+         */
+        inline void asbPortWrite(byte port, byte mask, byte value) {
+            if(port == NOT_A_PORT) return;
+            volatile uint8_t *out = portOutputRegister(port);
+            uint8_t sreg = SREG;
+            cli(); //Interrupts might change other pins of this port
+            *out = (*out & ~mask) | (value & mask);
+            SREG = sreg;
+        }
+
+    #else
+
+        inline byte asbPortOf(byte pin) {
+            return pin;
+        }
+
+        inline byte asbPortMask(byte pin) {
+            return 1;
+        }
+
+        inline byte asbPortRead(byte port) {
+            return ::digitalRead(port) ? 1 : 0;
+        }
+
+        inline void asbPortWrite(byte port, byte mask, byte value) {
+            if(mask & 1) ::digitalWrite(port, value & 1);
+        }
+
+    #endif
+
+#endif /* ASB_PORT__H */
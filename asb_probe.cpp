@@ -0,0 +1,191 @@
+/**
+  aSysBus probe module - node discovery and round trip times
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASB_PROBE__C
+    #define ASB_PROBE__C
+
+    #include <Arduino.h>
+    #include <inttypes.h>
+    #include <asb.h>
+
+    static_assert(ASB_PROBE_SLOTS >= 1 && ASB_PROBE_SLOTS <= 31, "ASB_PROBE_SLOTS must be between 1 and 31");
+    static_assert(ASB_PROBE_WINDOW >= 1 && ASB_PROBE_WINDOW <= ASB_PROBE_SLOTS, "ASB_PROBE_WINDOW must be between 1 and ASB_PROBE_SLOTS");
+
+    ASB_PROBE::ASB_PROBE(byte cfgId) {
+        _cfgId = cfgId;
+        window = ASB_PROBE_WINDOW;
+    }
+
+    bool ASB_PROBE::cfgRead(unsigned int address) {
+        return false;
+    }
+
+    bool ASB_PROBE::cfgReset(void) {
+        stop();
+        return true;
+    }
+
+    bool ASB_PROBE::cfgReserve(byte objects) {
+        return true;
+    }
+
+    byte ASB_PROBE::cfgCommands(void) {
+        return ASB_IO_CMD(ASB_CMD_PONG);
+    }
+
+    bool ASB_PROBE::start(unsigned int first, unsigned int last) {
+        return start(first, last, 1);
+    }
+
+    bool ASB_PROBE::start(unsigned int first, unsigned int last, byte rounds) {
+        if(busy()) return false;
+        if(first < 0x0001 || last > 0x07FF || first > last || rounds == 0) return false;
+
+        _next = first;
+        _last = last;
+        _rounds = rounds;
+
+        found = 0;
+        missing = 0;
+        rttMin = ASB_PROBE_MISSING;
+        rttMax = 0;
+        for(byte i=0; i<ASB_PROBE_BUCKETS; i++) histogram[i] = 0;
+        return true;
+    }
+
+    void ASB_PROBE::stop(void) {
+        _next = 0;
+        for(byte i=0; i<ASB_PROBE_SLOTS; i++) _slots[i].node = 0;
+    }
+
+    bool ASB_PROBE::busy(void) {
+        if(_next != 0) return true;
+        for(byte i=0; i<ASB_PROBE_SLOTS; i++) {
+            if(_slots[i].node != 0) return true;
+        }
+        return false;
+    }
+
+    void ASB_PROBE::resultHook(void (*function)(unsigned int node, unsigned long rtt)) {
+        _result = function;
+    }
+
+    byte ASB_PROBE::bucket(unsigned long rtt) {
+        byte i = 0;
+        rtt /= 1000;
+        while(rtt > 0 && i < (ASB_PROBE_BUCKETS - 1)) {
+            rtt >>= 1;
+            i++;
+        }
+        return i;
+    }
+
+    bool ASB_PROBE::ping(byte slot, bool retry) {
+        if(!retry) _slots[slot].seq = _seq++;
+        byte data[2] = {ASB_CMD_PING, _slots[slot].seq};
+
+        _slots[slot].sent = micros();
+        //Port 0 can't be sent over ASB_UART
+        return _control->asbSend(ASB_PKGTYPE_UNICAST, _slots[slot].node, (char)(slot + 1), sizeof(data), data) == 0;
+    }
+
+    void ASB_PROBE::result(unsigned int node, unsigned long rtt) {
+        if(rtt == ASB_PROBE_MISSING) {
+            missing++;
+        }else{
+            histogram[bucket(rtt)]++;
+            if(rtt < rttMin) rttMin = rtt;
+            if(rtt > rttMax) rttMax = rtt;
+        }
+        if(_result != NULL) _result(node, rtt);
+    }
+
+    bool ASB_PROBE::process(asbPacket &pkg) {
+        if(_control == NULL) return false;
+        if(pkg.len < 1 || pkg.data[0] != ASB_CMD_PONG || pkg.meta.type != ASB_PKGTYPE_UNICAST) return true;
+        if(pkg.meta.port < 1 || pkg.meta.port > ASB_PROBE_SLOTS) return true;
+
+        asbProbeSlot &slot = _slots[pkg.meta.port - 1];
+        if(slot.node == 0 || slot.node != pkg.meta.source) return true;
+
+        //Nodes echo the sequence number, older firmware only answers with the command
+        if(pkg.len >= 2 && pkg.data[1] != slot.seq) return true;
+
+        unsigned long rtt = micros() - slot.sent;
+        if(slot.left + 1 == _rounds) found++;
+        result(slot.node, rtt);
+
+        if(slot.left > 0) {
+            slot.left--;
+            slot.tries = 0;
+            if(!ping(pkg.meta.port - 1, false)) slot.sent = micros() - (ASB_PROBE_TIMEOUT * 1000UL); //Retried by loop()
+        }else{
+            slot.node = 0;
+        }
+        return true;
+    }
+
+    bool ASB_PROBE::loop(void) {
+        if(_control == NULL) return false;
+        unsigned long now = micros();
+        byte i, used = 0;
+        char free = -1;
+        bool late = false;
+
+        for(i=0; i<ASB_PROBE_SLOTS; i++) {
+            asbProbeSlot &slot = _slots[i];
+            if(slot.node == 0) {
+                if(free < 0 && i < window) free = i;
+                continue;
+            }
+            used++;
+            if((now - slot.sent) < (ASB_PROBE_TIMEOUT * 1000UL)) {
+                if((now - slot.sent) >= (ASB_PROBE_TIMEOUT * 500UL)) late = true;
+                continue;
+            }
+
+            if(slot.tries >= ASB_PROBE_RETRY) {
+                if(slot.left + 1 == _rounds) result(slot.node, ASB_PROBE_MISSING);
+                slot.node = 0;
+                used--;
+                if(free < 0 && i < window) free = i;
+            }else{
+                //A PING which could not be sent is no try, it is repeated after the timeout
+                if(ping(i, true)) slot.tries++;
+                return true; //One PING per call
+            }
+        }
+
+        //Start the next node, unless PINGs on higher ports lose every arbitration
+        if(_next == 0 || free < 0 || used >= window || late) return true;
+
+        _slots[(byte)free].node = _next;
+        _slots[(byte)free].tries = 0;
+        _slots[(byte)free].left = _rounds - 1;
+        if(_next == _control->getNodeId()) {
+            _slots[(byte)free].node = 0; //Skip ourselves
+        }else if(!ping(free, false)) {
+            _slots[(byte)free].node = 0;
+            return true; //Try again next call
+        }
+        _next = (_next < _last) ? _next + 1 : 0;
+        return true;
+    }
+
+#endif /* ASB_PROBE__C */
@@ -0,0 +1,311 @@
+/**
+  aSysBus probe module - node discovery and round trip times
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASB_PROBE__H
+#define ASB_PROBE__H
+
+    #include <Arduino.h>
+    #include <inttypes.h>
+    #include <asb.h>
+
+    /**
+     * Maximum number of PINGs in flight
+     *
+     * Every PING uses its own port starting at 1, so at most 31 are
+     * possible. Each slot takes 9 bytes of RAM. Default is 16.
+     */
+    #ifndef ASB_PROBE_SLOTS
+        #define ASB_PROBE_SLOTS 16
+    #endif
+
+    /**
+     * Default number of PINGs in flight
+     *
+     * Two PINGs in flight already keep a 125kbit/s CAN segment busy. The
+     * port is part of the CAN identifier, so with more of them the low
+     * ports win every arbitration and PINGs on higher ports starve. No
+     * new node is started while a PING waits for more than half of
+     * ASB_PROBE_TIMEOUT, so they get through before they time out, but
+     * the sweep gets slower: asbsim sweeping 100 nodes twice (-n 100 -p 2)
+     * takes 283ms with a window of 2 and 449ms with 16. Without holding
+     * back, a window of 16 reported one of them as missing. Raise
+     * ASB_PROBE::window at runtime for faster interfaces. Default is 2.
+     */
+    #ifndef ASB_PROBE_WINDOW
+        #define ASB_PROBE_WINDOW 2
+    #endif
+
+    /**
+     * Time to wait for a PONG in ms
+     *
+     * Default is 50, enough for a loaded 125kbit/s CAN segment.
+     */
+    #ifndef ASB_PROBE_TIMEOUT
+        #define ASB_PROBE_TIMEOUT 50
+    #endif
+
+    /**
+     * Number of PINGs repeated before a node counts as missing
+     *
+     * Repeated PINGs keep their sequence number, so a late answer to an
+     * earlier one still counts. Default is 1.
+     */
+    #ifndef ASB_PROBE_RETRY
+        #define ASB_PROBE_RETRY 1
+    #endif
+
+    /**
+     * Number of round trip time classes
+     *
+     * Class 0 are answers below 1ms, every following class doubles the
+     * time, the last one takes everything above. Default is 8, i.e. up to
+     * 64ms.
+     */
+    #ifndef ASB_PROBE_BUCKETS
+        #define ASB_PROBE_BUCKETS 8
+    #endif
+
+    /**
+     * Round trip time reported for missing nodes
+     */
+    #define ASB_PROBE_MISSING 0xFFFFFFFF
+
+    /**
+     * PING in flight
+     */
+    typedef struct {
+
+      /**
+       * Pinged node, 0 if the slot is free
+       */
+      unsigned int node;
+
+      /**
+       * micros() when the PING was sent
+       */
+      unsigned long sent;
+
+      /**
+       * Sequence number, echoed in the PONG, kept for repeated PINGs
+       */
+      byte seq;
+
+      /**
+       * PINGs of this node without answer
+       */
+      byte tries;
+
+      /**
+       * PINGs left for this node after the current one
+       */
+      byte left;
+
+    } asbProbeSlot;
+
+    /**
+     * Probe module
+     *
+     * Sends ASB_CMD_PING to a range of nodes while keeping up to
+     * ASB_PROBE_SLOTS requests in flight. Requests are told apart by their
+     * port and a sequence number, so a sweep of all node IDs takes seconds
+     * instead of minutes. Every answer and every missing node is reported
+     * to a function, round trip times of the whole sweep are collected in
+     * classes.
+     *
+     *   ASB_PROBE probe(15);
+     *   asb0.hookAttachModule(&probe);
+     *   probe.resultHook(found);
+     *   probe.start(0x001, 0x7FF, 4);
+     *
+     * @see ASB_IO
+     */
+    class ASB_PROBE : public ASB_IO {
+        private:
+            /**
+             * PINGs in flight, index is the port - 1
+             */
+            asbProbeSlot _slots[ASB_PROBE_SLOTS];
+
+            /**
+             * Next node to ping, 0 if all were started
+             */
+            unsigned int _next;
+
+            /**
+             * Last node to ping
+             */
+            unsigned int _last;
+
+            /**
+             * PINGs per node
+             */
+            byte _rounds;
+
+            /**
+             * Next sequence number
+             */
+            byte _seq;
+
+            /**
+             * Function to call for every result
+             */
+            void (*_result)(unsigned int node, unsigned long rtt);
+
+            /**
+             * Send a PING using a slot
+             * @param slot slot number
+             * @param retry true to repeat the last PING, false to use a new sequence number
+             * @return bool true if the PING was sent
+             */
+            bool ping(byte slot, bool retry);
+
+            /**
+             * Report a result and count it
+             * @param node node address
+             * @param rtt round trip time in us, ASB_PROBE_MISSING if the node did not answer
+             */
+            void result(unsigned int node, unsigned long rtt);
+
+        public:
+            /**
+             * Number of nodes that answered during the current sweep
+             */
+            unsigned int found;
+
+            /**
+             * Number of nodes that did not answer during the current sweep
+             */
+            unsigned int missing;
+
+            /**
+             * Shortest round trip time in us
+             */
+            unsigned long rttMin;
+
+            /**
+             * Longest round trip time in us
+             */
+            unsigned long rttMax;
+
+            /**
+             * Number of answers per round trip time class
+             * @see bucket()
+             */
+            unsigned int histogram[ASB_PROBE_BUCKETS];
+
+            /**
+             * Number of PINGs in flight, 1 to ASB_PROBE_SLOTS
+             * @see ASB_PROBE_WINDOW
+             */
+            byte window;
+
+            /**
+             * Initialize
+             * @param cfgId module id used for ASB::hookDetachModule(), nothing is stored in EEPROM
+             */
+            ASB_PROBE(byte cfgId);
+
+            /**
+             * No configuration is stored
+             * @return bool always false
+             */
+            bool cfgRead(unsigned int address);
+
+            /**
+             * Stop a running sweep
+             * @return bool always true
+             */
+            bool cfgReset(void);
+
+            /**
+             * Nothing to reserve
+             * @param objects number of configuration objects in EEPROM
+             * @return bool always true
+             */
+            bool cfgReserve(byte objects);
+
+            /**
+             * Commands this module wants to receive
+             * @return byte ASB_IO_CMD() bits
+             */
+            byte cfgCommands(void);
+
+            /**
+             * Process incoming packet
+             * @param pkg Packet struct
+             * @return bool true if successful
+             */
+            bool process(asbPacket &pkg);
+
+            /**
+             * Main loop call, sends one PING per call and checks timeouts
+             * @return bool true if successful
+             */
+            bool loop(void);
+
+            /**
+             * Ping every node once
+             * @param first first node address
+             * @param last last node address
+             * @return bool false if the range is invalid or a sweep is running
+             */
+            bool start(unsigned int first, unsigned int last);
+
+            /**
+             * Ping every node several times
+             *
+             * Missing nodes are only reported once.
+             *
+             * @param first first node address
+             * @param last last node address
+             * @param rounds number of PINGs per node
+             * @return bool false if the range is invalid or a sweep is running
+             */
+            bool start(unsigned int first, unsigned int last, byte rounds);
+
+            /**
+             * Cancel the current sweep
+             */
+            void stop(void);
+
+            /**
+             * Check if a sweep is running
+             * @return bool true until all nodes answered or timed out
+             */
+            bool busy(void);
+
+            /**
+             * Set the function to call for every answer and missing node
+             *
+             * rtt is the round trip time in us, ASB_PROBE_MISSING if the
+             * node did not answer.
+             *
+             * @param function function to call, NULL to disable
+             */
+            void resultHook(void (*function)(unsigned int node, unsigned long rtt));
+
+            /**
+             * Round trip time class
+             * @param rtt round trip time in us
+             * @return byte index into histogram
+             */
+            static byte bucket(unsigned long rtt);
+    };
+
+#endif /* ASB_PROBE__H */
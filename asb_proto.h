@@ -20,7 +20,17 @@
 #ifndef ASB_PROTO__H
 #define ASB_PROTO__H
 
-    #include <Arduino.h>
+    #ifdef ASB_HOST
+        //Host tools like tools/asbdecode.cpp only use the protocol definitions
+        #include <stdint.h>
+        #include <string.h>
+        typedef uint8_t byte;
+        #ifndef PROGMEM
+            #define PROGMEM
+        #endif
+    #else
+        #include <Arduino.h>
+    #endif
     #include <inttypes.h>
 
     #define ASB_PKGTYPE_BROADCAST 0x00
@@ -35,10 +45,13 @@
     #define ASB_CMD_PER           0x52 //%
     #define ASB_CMD_PING          0x70
     #define ASB_CMD_PONG          0x71
+    #define ASB_CMD_UTIL          0x72 //Bus utilization, answered with % per interface
+    #define ASB_CMD_MEMBER        0x73 //Group membership bitmap, no payload = every group
     #define ASB_CMD_CFG_READ      0x80 //2-byte address
     #define ASB_CMD_CFG_WRITE     0x81 //2-byte-address + data
     #define ASB_CMD_CFG_COMMIT    0x82 //2-byte-address
     #define ASB_CMD_IDENT         0x85 //Change local address, 2-byte-address
+    //Sensor values, payload widths and units are described in asb_sensor.h
     #define ASB_CMD_S_TEMP        0xA0 //x*0.1°C, int
     #define ASB_CMD_S_HUM         0xA1 //x*0.1%RH, unsigned int
     #define ASB_CMD_S_PRS         0xA2 //x*0.1hPa, unsigned int
@@ -60,6 +73,24 @@
     #define ASB_CMD_S_PM          0xD9 //smth per Minute, unsinged int (RPM, Pulse PM, etc)
     #define ASB_CMD_S_PS          0xDA //smth per Second, unsinged int
 
+    /**
+     * Size of the group membership bitmap in bits
+     *
+     * ASB_CMD_MEMBER carries one bit per hashed group target, so a single
+     * frame describes every group a node listens to. Groups sharing a bit
+     * only cause packets to be routed where nobody needs them.
+     */
+    #define ASB_MEMBER_BITS 56
+
+    /**
+     * Bit of a group target in the membership bitmap
+     * @param target group target
+     * @return byte bit number, bit 0 is the MSB of the first byte
+     */
+    constexpr byte asbMemberBit(unsigned int target) {
+        return ((((40503UL * target) & 0xFFFF) * ASB_MEMBER_BITS) >> 16);
+    }
+
     /**
      * Packet metadata
      * Contains all data except things related to the actual payload
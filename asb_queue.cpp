@@ -0,0 +1,94 @@
+/**
+  aSysBus send queue
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASB_QUEUE__C
+#define ASB_QUEUE__C
+    #include "asb.h"
+
+    static_assert(ASB_QUEUE_SIZE >= 1 && ASB_QUEUE_SIZE <= 64 && (ASB_QUEUE_SIZE & (ASB_QUEUE_SIZE - 1)) == 0, "ASB_QUEUE_SIZE must be a power of 2 up to 64");
+
+    ASB_QUEUE::ASB_QUEUE(void) {
+        for(byte i=0; i<ASB_QUEUE_SIZE; i++) _slots[i].seq = i;
+        _head = 0;
+        _tail = 0;
+    }
+
+    bool ASB_QUEUE::claim(byte &pos) {
+        #ifdef __AVR__
+            bool free = false;
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                pos = _head;
+                if(_slots[pos & (ASB_QUEUE_SIZE - 1)].seq == pos) {
+                    _head = pos + 1;
+                    free = true;
+                }
+            }
+            return free;
+        #else
+            pos = _head;
+            for(;;) {
+                signed char diff = (byte)(_slots[pos & (ASB_QUEUE_SIZE - 1)].seq - pos);
+                if(diff < 0) return false; //Not yet taken out
+
+                //Another producer was faster, the failed exchange loads the new head
+                if(diff == 0 && _head.compare_exchange_weak(pos, (byte)(pos + 1))) return true;
+                if(diff > 0) pos = _head;
+            }
+        #endif
+    }
+
+    bool ASB_QUEUE::push(byte type, unsigned int target, char port, byte len, const byte *data) {
+        byte pos, i;
+
+        if(len > 8) return false;
+        if(!claim(pos)) return false;
+
+        asbQueueSlot &slot = _slots[pos & (ASB_QUEUE_SIZE - 1)];
+        slot.type = type;
+        slot.target = target;
+        slot.port = port;
+        slot.len = len;
+        for(i=0; i<len; i++) slot.data[i] = data[i];
+
+        ASB_QUEUE_BARRIER();
+        slot.seq = pos + 1;
+        return true;
+    }
+
+    bool ASB_QUEUE::pop(asbPacket &pkg) {
+        byte i;
+        asbQueueSlot &slot = _slots[_tail & (ASB_QUEUE_SIZE - 1)];
+
+        if(slot.seq != (byte)(_tail + 1)) return false; //Empty or still being written
+        ASB_QUEUE_BARRIER();
+
+        pkg.meta.type = slot.type;
+        pkg.meta.target = slot.target;
+        pkg.meta.port = slot.port;
+        pkg.meta.busId = -1;
+        pkg.len = slot.len;
+        for(i=0; i<slot.len; i++) pkg.data[i] = slot.data[i];
+
+        ASB_QUEUE_BARRIER();
+        slot.seq = _tail + ASB_QUEUE_SIZE;
+        _tail++;
+        return true;
+    }
+
+#endif /* ASB_QUEUE__C */
@@ -0,0 +1,156 @@
+/**
+  aSysBus send queue
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASB_QUEUE__H
+#define ASB_QUEUE__H
+    #include "asb_proto.h"
+
+    #ifdef __AVR__
+        #include <util/atomic.h>
+    #else
+        #include <atomic>
+    #endif
+
+    /**
+     * Number of queued packets
+     *
+     * ASB_QUEUE_SIZE sets how many packets interrupts may queue using
+     * ASB::asbQueue() until the next ASB::loop(). Each entry uses 14 bytes
+     * of RAM on AVR. Must be a power of 2 up to 64, default is 2.
+     */
+    #ifndef ASB_QUEUE_SIZE
+        #define ASB_QUEUE_SIZE 2
+    #endif
+
+    #ifdef __AVR__
+        /**
+         * Sequence number, AVR reads and writes single bytes atomically
+         */
+        typedef volatile byte asbQueueSeq;
+
+        /**
+         * Keep the compiler from moving payload accesses across sequence numbers
+         */
+        #define ASB_QUEUE_BARRIER() __asm__ __volatile__("" ::: "memory")
+    #else
+        typedef std::atomic<byte> asbQueueSeq;
+        #define ASB_QUEUE_BARRIER()
+    #endif
+
+    /**
+     * Queued packet
+     */
+    typedef struct {
+      /**
+       * Position this slot is free for, position + 1 once it is filled
+       */
+      asbQueueSeq seq;
+
+      /**
+       * Message type, ASB_PKGTYPE_*
+       */
+      byte type;
+
+      /**
+       * Port, -1 if unused
+       */
+      char port;
+
+      /**
+       * Target address
+       */
+      unsigned int target;
+
+      /**
+       * Number of data bytes
+       */
+      byte len;
+
+      /**
+       * Payload
+       */
+      byte data[8];
+    } asbQueueSlot;
+
+    /**
+     * Send queue for interrupts
+     *
+     * Any number of producers - interrupts, or threads on host builds - add
+     * packets without locks, a single consumer takes them out in the order
+     * their slots were claimed. A packet still being written holds back
+     * the ones behind it, so the order is kept.
+     *
+     * Slots carry a sequence number: a producer claims the next position if
+     * its slot is free for it and publishes the packet by advancing the
+     * sequence number, the consumer frees the slot for the position one
+     * round later. AVR has no compare-and-swap, there claiming a position
+     * blocks interrupts for a few cycles instead.
+     *
+     * @see ASB::asbQueue()
+     */
+    class ASB_QUEUE {
+        private:
+            /**
+             * Packets
+             */
+            asbQueueSlot _slots[ASB_QUEUE_SIZE];
+
+            /**
+             * Next position to claim
+             */
+            asbQueueSeq _head;
+
+            /**
+             * Next position to take out, only used by the consumer
+             */
+            byte _tail;
+
+            /**
+             * Claim the next position
+             * @param pos reference to store the position
+             * @return bool false if the queue is full
+             */
+            bool claim(byte &pos);
+
+        public:
+            /**
+             * Constructor
+             */
+            ASB_QUEUE(void);
+
+            /**
+             * Add a packet, safe to call from interrupts
+             * @param type 2 bit message type (ASB_PKGTYPE_*)
+             * @param target target address between 0x0001 and 0x07FF/0xFFFF
+             * @param port port address between 0x00 and 0x1F, Unicast only
+             * @param len number of data bytes
+             * @param data array of data bytes
+             * @return bool false if the queue is full
+             */
+            bool push(byte type, unsigned int target, char port, byte len, const byte *data);
+
+            /**
+             * Take out the oldest packet, only one caller at a time
+             * @param pkg asbPacket-Reference to store the packet, source is not set
+             * @return bool false if no packet is ready
+             */
+            bool pop(asbPacket &pkg);
+    };
+
+#endif /* ASB_QUEUE__H */
@@ -0,0 +1,124 @@
+/**
+  aSysBus capture replay
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASB_REPLAY__C
+#define ASB_REPLAY__C
+    #include "asb.h"
+
+    ASB_REPLAY::ASB_REPLAY(Stream &in, unsigned int speed) {
+        _in = &in;
+        _speed = speed;
+    }
+
+    unsigned long ASB_REPLAY::get32(const byte *data) {
+        if(_swapped) {
+            return ((unsigned long)data[0] << 24) | ((unsigned long)data[1] << 16) | ((unsigned int)data[2] << 8) | data[3];
+        }
+        return ((unsigned long)data[3] << 24) | ((unsigned long)data[2] << 16) | ((unsigned int)data[1] << 8) | data[0];
+    }
+
+    byte ASB_REPLAY::begin(void) {
+        byte header[ASB_CAPTURE_HEADER];
+
+        if(_in->readBytes(header, sizeof(header)) != sizeof(header)) return 1;
+
+        //Magic is stored in the byte order of the writer
+        _swapped = false;
+        unsigned long magic = get32(header);
+        if(magic != ASB_CAPTURE_MAGIC && magic != ASB_CAPTURE_MAGIC_NS) {
+            _swapped = true;
+            magic = get32(header);
+        }
+        if(magic != ASB_CAPTURE_MAGIC && magic != ASB_CAPTURE_MAGIC_NS) return 2;
+        _nano = (magic == ASB_CAPTURE_MAGIC_NS);
+
+        if(get32(&header[20]) != ASB_CAPTURE_LINKTYPE) return 3;
+
+        _pending = false;
+        _started = false;
+        packets = 0;
+        skipped = 0;
+        return 0;
+    }
+
+    bool ASB_REPLAY::fetch(void) {
+        byte record[ASB_CAPTURE_RECORD + ASB_CAPTURE_FRAME];
+        unsigned long stamp, id;
+        byte len, i;
+
+        while(_in->available() >= (int)sizeof(record)) {
+            if(_in->readBytes(record, ASB_CAPTURE_RECORD) != ASB_CAPTURE_RECORD) return false;
+
+            //Frames of other sizes, e.g. CAN FD, are skipped as a whole
+            unsigned long incl = get32(&record[8]);
+            if(incl != ASB_CAPTURE_FRAME) {
+                while(incl-- > 0 && _in->read() >= 0);
+                skipped++;
+                continue;
+            }
+            if(_in->readBytes(&record[ASB_CAPTURE_RECORD], ASB_CAPTURE_FRAME) != ASB_CAPTURE_FRAME) return false;
+
+            //Only extended data frames carry aSysBus packets
+            id = ((unsigned long)record[16] << 24) | ((unsigned long)record[17] << 16) | ((unsigned int)record[18] << 8) | record[19];
+            len = record[20];
+            if((id & 0xE0000000) != 0x80000000 || len > 8) {
+                skipped++;
+                continue;
+            }
+            if(record[16 + ASB_CAPTURE_TYPE] & 0x01) id |= 0x20000000;
+
+            _pkg.meta = ASB_CAN::asbCanAddrParse(id);
+            _pkg.len = len;
+            for(i=0; i<len; i++) _pkg.data[i] = record[24+i];
+
+            stamp = get32(&record[0]) * 1000 + get32(&record[4]) / (_nano ? 1000000 : 1000);
+            if(!_started) {
+                _first = stamp;
+                _start = millis();
+                _started = true;
+            }
+
+            //Scale without overflowing for long captures
+            stamp -= _first;
+            if(_speed == 0) {
+                _due = 0;
+            }else{
+                _due = stamp / _speed * 100 + (stamp % _speed) * 100 / _speed;
+            }
+            _pending = true;
+            return true;
+        }
+        return false;
+    }
+
+    bool ASB_REPLAY::asbSend(byte type, unsigned int target, unsigned int source, char port, byte len, const byte *data) {
+        return true;
+    }
+
+    bool ASB_REPLAY::asbReceive(asbPacket &pkg) {
+        if(!_pending && !fetch()) return false;
+        if((millis() - _start) < _due) return false;
+
+        pkg = _pkg;
+        _pending = false;
+        packets++;
+        return true;
+    }
+
+#endif /* ASB_REPLAY__C */
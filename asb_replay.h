@@ -0,0 +1,145 @@
+/**
+  aSysBus capture replay
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASB_REPLAY__H
+#define ASB_REPLAY__H
+    #include "asb.h"
+    #include "Stream.h"
+
+    /**
+     * Capture replay interface
+     *
+     * Reads a capture written by ASB_CAPTURE, or any SocketCAN pcap file
+     * using the aSysBus addressing, and hands the packets to the controller
+     * as if they were received from a bus. Sent packets are discarded.
+     * Error frames are skipped, the upper bit of the packet type is taken
+     * from the frame byte ASB_CAPTURE_TYPE.
+     *
+     * @see ASB_COMM
+     * @see ASB_CAPTURE
+     */
+    class ASB_REPLAY : public ASB_COMM {
+        private:
+            /**
+             * Capture source
+             */
+            Stream *_in;
+
+            /**
+             * Replay speed in percent, 0 = as fast as possible
+             */
+            unsigned int _speed;
+
+            /**
+             * Header bytes have to be swapped
+             */
+            bool _swapped = false;
+
+            /**
+             * Time stamps are in nanoseconds
+             */
+            bool _nano = false;
+
+            /**
+             * A record is waiting for its time stamp
+             */
+            bool _pending = false;
+
+            /**
+             * First record was read
+             */
+            bool _started = false;
+
+            /**
+             * millis() when the first record was replayed
+             */
+            unsigned long _start;
+
+            /**
+             * Time stamp of the first record in ms
+             */
+            unsigned long _first;
+
+            /**
+             * Time of the pending record relative to the first in ms
+             */
+            unsigned long _due;
+
+            /**
+             * Pending record
+             */
+            asbPacket _pkg;
+
+            /**
+             * Read a 32 bit value in capture byte order
+             * @param data 4 bytes
+             * @return unsigned long value
+             */
+            unsigned long get32(const byte *data);
+
+            /**
+             * Read the next usable record
+             * @return bool false if no complete record is available
+             */
+            bool fetch(void);
+
+        public:
+            /**
+             * Number of packets replayed
+             */
+            unsigned long packets = 0;
+
+            /**
+             * Number of records skipped, e.g. standard CAN frames
+             */
+            unsigned long skipped = 0;
+
+            /**
+             * Constructor
+             * @param in Stream to read the capture from
+             * @param speed replay speed in percent, 100 = original timing, 0 = as fast as possible
+             */
+            ASB_REPLAY(Stream &in, unsigned int speed);
+
+            /**
+             * Read and check the file header
+             * @return error code, 0=OK
+             */
+            byte begin(void);
+
+            /**
+             * Discard a message, captures are read only
+             * @param type 2 bit message type (ASB_PKGTYPE_*)
+             * @param target address between 0x0001 and 0x07FF/0xFFFF
+             * @param source source address between 0x0001 and 0x07FF
+             * @param port port address between 0x00 and 0x1F, Unicast only
+             * @param len number of bytes to send (0-8)
+             * @param data array of bytes to send
+             */
+            bool asbSend(byte type, unsigned int target, unsigned int source, char port, byte len, const byte *data);
+
+            /**
+             * Get the next packet once its time has come
+             * @param pkg asbPacket-Reference to store received packet
+             * @return true if a message was received
+             */
+            bool asbReceive(asbPacket &pkg);
+    };
+
+#endif /* ASB_REPLAY__H */
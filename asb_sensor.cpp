@@ -0,0 +1,55 @@
+/**
+  aSysBus sensor payloads
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASB_SENSOR__C
+#define ASB_SENSOR__C
+
+    #include <Arduino.h>
+    #include <inttypes.h>
+    #include "asb_sensor.h"
+
+    bool asbSensorInfo(byte cmd, asbSensorType &info) {
+        for(byte i=0; i<asbSensorItems; i++) {
+            if(pgm_read_byte(&asbSensorTypes[i].cmd) == cmd) {
+                memcpy_P(&info, &asbSensorTypes[i], sizeof(asbSensorType));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    byte asbSensorEncode(byte cmd, byte *data, long value) {
+        asbSensorType info;
+
+        if(!asbSensorInfo(cmd, info)) return 0;
+        data[0] = cmd;
+        asbSensorPut(data, info.width, asbSensorClamp(value, info.width, info.sign));
+        return 1 + info.width;
+    }
+
+    bool asbSensorDecode(const asbPacket &pkg, long &value) {
+        asbSensorType info;
+
+        if(pkg.len < 1 || !asbSensorInfo(pkg.data[0], info)) return false;
+        if(pkg.len != 1 + info.width) return false;
+        value = asbSensorGet(pkg.data, info.width, info.sign);
+        return true;
+    }
+
+#endif /* ASB_SENSOR__C */
@@ -0,0 +1,223 @@
+/**
+  aSysBus sensor payloads
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASB_SENSOR__H
+#define ASB_SENSOR__H
+
+    #include "asb_proto.h"
+    #include <inttypes.h>
+
+    /**
+     * Value payload description
+     *
+     * Values are sent directly after the command byte, MSB first.
+     */
+    typedef struct {
+
+      /**
+       * Command, ASB_CMD_*
+       */
+      byte cmd;
+
+      /**
+       * Payload width in bytes: 1, 2 or 4
+       */
+      byte width;
+
+      /**
+       * Value is signed
+       */
+      bool sign;
+
+      /**
+       * Number of decimals, e.g. 1 for x*0.1
+       */
+      byte decimals;
+
+      /**
+       * Unit, UTF-8
+       */
+      char unit[5];
+
+    } asbSensorType;
+
+    /**
+     * Payloads of all value commands
+     * Kept in flash, use asbSensorInfo() to read entries at runtime
+     */
+    constexpr asbSensorType asbSensorTypes[] PROGMEM = {
+        {ASB_CMD_1B,     1, false, 0, ""},
+        {ASB_CMD_PER,    1, false, 0, "%"},
+        {ASB_CMD_S_TEMP, 2, true,  1, "°C"},
+        {ASB_CMD_S_HUM,  2, false, 1, "%RH"},
+        {ASB_CMD_S_PRS,  2, false, 1, "hPa"},
+        {ASB_CMD_S_LUX,  4, false, 0, "lx"},
+        {ASB_CMD_S_UV,   2, false, 1, ""},
+        {ASB_CMD_S_IR,   4, false, 0, ""},
+        {ASB_CMD_S_VOLT, 2, true,  2, "V"},
+        {ASB_CMD_S_AMP,  2, true,  2, "A"},
+        {ASB_CMD_S_PWR,  4, true,  1, "W"},
+        {ASB_CMD_S_PER,  1, false, 0, "%"},
+        {ASB_CMD_S_PML,  2, false, 0, "‰"},
+        {ASB_CMD_S_PPM,  2, false, 0, "ppm"},
+        {ASB_CMD_S_PY,   2, false, 0, "/y"},
+        {ASB_CMD_S_PMo,  2, false, 0, "/mo"},
+        {ASB_CMD_S_PD,   2, false, 0, "/d"},
+        {ASB_CMD_S_PH,   2, false, 0, "/h"},
+        {ASB_CMD_S_PM,   2, false, 0, "/min"},
+        {ASB_CMD_S_PS,   2, false, 0, "/s"},
+    };
+
+    /**
+     * Number of entries in asbSensorTypes
+     */
+    constexpr byte asbSensorItems = sizeof(asbSensorTypes)/sizeof(asbSensorType);
+
+    /**
+     * Find a command in asbSensorTypes at compile time
+     * @param cmd ASB_CMD_*
+     * @param i first entry to check
+     * @return byte entry index, asbSensorItems if unknown
+     */
+    constexpr byte asbSensorFind(byte cmd, byte i) {
+        return (i >= asbSensorItems || asbSensorTypes[i].cmd == cmd) ? i : asbSensorFind(cmd, i+1);
+    }
+
+    /**
+     * Payload of a command known at compile time
+     *
+     * Fails to compile for commands without a value payload:
+     *   byte len = 1 + asbSensor<ASB_CMD_S_TEMP>::width;
+     *
+     * @param CMD ASB_CMD_*
+     */
+    template <byte CMD> struct asbSensor {
+        static_assert(asbSensorFind(CMD, 0) < asbSensorItems, "Command has no value payload");
+
+        enum : byte {
+            width = asbSensorTypes[asbSensorFind(CMD, 0)].width,
+            sign = asbSensorTypes[asbSensorFind(CMD, 0)].sign,
+            decimals = asbSensorTypes[asbSensorFind(CMD, 0)].decimals
+        };
+    };
+
+    /**
+     * Limit a value to what fits a payload
+     * @param value value
+     * @param width payload width in bytes
+     * @param sign payload is signed
+     * @return long limited value
+     */
+    inline long asbSensorClamp(long value, byte width, bool sign) {
+        if(width >= 4) return value;
+        long max = (1L << (8 * width - (sign ? 1 : 0))) - 1;
+        long min = sign ? (-max - 1) : 0;
+        return (value < min) ? min : ((value > max) ? max : value);
+    }
+
+    /**
+     * Write a value payload
+     * @param data buffer for the command and up to 4 bytes
+     * @param width payload width in bytes
+     * @param value value, already limited
+     */
+    inline void asbSensorPut(byte *data, byte width, long value) {
+        for(byte i=width; i>0; i--) {
+            data[i] = value & 0xFF;
+            value >>= 8;
+        }
+    }
+
+    /**
+     * Read a value payload
+     * @param data received data, starting at the command
+     * @param width payload width in bytes
+     * @param sign payload is signed
+     * @return long value, unsigned 32 bit values above 0x7FFFFFFF have to be cast
+     */
+    inline long asbSensorGet(const byte *data, byte width, bool sign) {
+        uint32_t value = 0;
+        for(byte i=1; i<=width; i++) value = (value << 8) | data[i];
+        if(!sign) return value;
+        if(width < 4 && (value & (1UL << (8 * width - 1)))) value |= 0xFFFFFFFFUL << (8 * width);
+        return (int32_t)value;
+    }
+
+    /**
+     * Encode a value for a command known at compile time
+     * @param CMD ASB_CMD_*
+     * @param data buffer, at least 5 bytes
+     * @param value value in units of CMD, limited to the payload range
+     * @return byte number of bytes used including the command
+     */
+    template <byte CMD> inline byte asbSensorEncode(byte *data, long value) {
+        data[0] = CMD;
+        asbSensorPut(data, asbSensor<CMD>::width, asbSensorClamp(value, asbSensor<CMD>::width, asbSensor<CMD>::sign));
+        return 1 + asbSensor<CMD>::width;
+    }
+
+    /**
+     * Encode a value into a packet for a command known at compile time
+     * @param CMD ASB_CMD_*
+     * @param pkg packet to fill, metadata is not changed
+     * @param value value in units of CMD
+     */
+    template <byte CMD> inline void asbSensorEncode(asbPacket &pkg, long value) {
+        pkg.len = asbSensorEncode<CMD>(pkg.data, value);
+    }
+
+    /**
+     * Decode a packet for a command known at compile time
+     * @param CMD ASB_CMD_*
+     * @param pkg received packet
+     * @param value reference to store the value
+     * @return bool false if the packet is not a valid CMD
+     */
+    template <byte CMD> inline bool asbSensorDecode(const asbPacket &pkg, long &value) {
+        if(pkg.len != 1 + asbSensor<CMD>::width || pkg.data[0] != CMD) return false;
+        value = asbSensorGet(pkg.data, asbSensor<CMD>::width, asbSensor<CMD>::sign);
+        return true;
+    }
+
+    /**
+     * Get the payload of a command at runtime
+     * @param cmd ASB_CMD_*
+     * @param info reference to store the description
+     * @return bool false if the command has no value payload
+     */
+    bool asbSensorInfo(byte cmd, asbSensorType &info);
+
+    /**
+     * Encode a value for a command
+     * @param cmd ASB_CMD_*
+     * @param data buffer, at least 5 bytes
+     * @param value value in units of cmd, limited to the payload range
+     * @return byte number of bytes used including the command, 0 if unknown
+     */
+    byte asbSensorEncode(byte cmd, byte *data, long value);
+
+    /**
+     * Decode any value packet
+     * @param pkg received packet
+     * @param value reference to store the value
+     * @return bool false if the packet carries no valid value
+     */
+    bool asbSensorDecode(const asbPacket &pkg, long &value);
+
+#endif /* ASB_SENSOR__H */
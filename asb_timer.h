@@ -0,0 +1,125 @@
+/**
+  aSysBus timer definitions
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASB_TIMER__H
+#define ASB_TIMER__H
+
+    #include <Arduino.h>
+    #include <inttypes.h>
+
+    /**
+     * Maximum number of active timers
+     *
+     * ASB_TIMERNUM sets the maximum number of timers in one instance. Each
+     * timer uses 13 bytes of RAM on AVR. You can set it to a integer between
+     * 1 and 32000, up to 126 timer IDs fit into one byte. The controller
+     * uses one while sending its announcements, every pulsing output one
+     * until the pulse ends. Default is 4.
+     */
+    #ifndef ASB_TIMERNUM
+        #define ASB_TIMERNUM 4
+    #endif
+
+    /**
+     * Timer resolution in ms
+     *
+     * Timers are rounded up to multiples of ASB_TIMER_TICK. Periods are
+     * limited to 65535 ticks, delays are not. Default is 10.
+     */
+    #ifndef ASB_TIMER_TICK
+        #define ASB_TIMER_TICK 10
+    #endif
+
+    /**
+     * Number of timer wheel slots
+     *
+     * Timers are spread over ASB_TIMER_SLOTS lists, each tick only checks
+     * the timers of one list. Must be a power of 2, default is 16.
+     */
+    #ifndef ASB_TIMER_SLOTS
+        #define ASB_TIMER_SLOTS 16
+    #endif
+
+    /**
+     * Timer has expired and waits for its function to be called
+     */
+    #define ASB_TIMER_DUE 0xFE
+
+    /**
+     * Timer ID as returned by ASB::timerAttach(), -1 if none
+     * Links inside the wheel store the ID + 1, 0 ends a list
+     */
+    #if ASB_TIMERNUM < 127
+        typedef signed char asbTimerId;
+        typedef byte asbTimerLink;
+    #else
+        typedef int asbTimerId;
+        typedef unsigned int asbTimerLink;
+    #endif
+
+    /**
+     * Timer callback
+     * @param arg pointer supplied on attach, e.g. a module
+     * @param data value supplied on attach, e.g. an item index
+     */
+    typedef void (*asbTimerFunction)(void *arg, byte data);
+
+    /**
+     * Timer struct
+     * Linked into one slot of the timer wheel while active
+     */
+    typedef struct {
+      /**
+       * Function to call, NULL if unused
+       */
+      asbTimerFunction execute;
+
+      /**
+       * Argument for execute
+       */
+      void *arg;
+
+      /**
+       * Ticks between calls, 0 = one-shot, up to 0xFFFF
+       */
+      unsigned int period;
+
+      /**
+       * Number of full wheel turns left before expiry
+       */
+      unsigned long rounds;
+
+      /**
+       * Value for execute
+       */
+      byte data;
+
+      /**
+       * Wheel slot or ASB_TIMER_DUE
+       */
+      byte slot;
+
+      /**
+       * Next timer in the same slot + 1, 0 = end of list
+       */
+      asbTimerLink next;
+
+    } asbTimer;
+
+#endif /* ASB_TIMER__H */
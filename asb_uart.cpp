@@ -27,37 +27,47 @@
         ASB_UART::_buf[0] = 0;
     }
 
+    ASB_UART::ASB_UART(Stream &serial, unsigned long baud) : ASB_UART(serial) {
+        _baud = baud;
+    }
+
+    unsigned long ASB_UART::bitrate(void) {
+        return _baud;
+    }
+
     byte ASB_UART::begin() {
         return 0;
     }
 
     bool ASB_UART::asbSend(byte type, unsigned int target, unsigned int source, char port, byte len, const byte *data) {
         byte tlen = 0;
-        _interface->write(0x01);
-        _interface->print(type,HEX);
-        _interface->write(0x1F);
-        _interface->print(target,HEX);
-        _interface->write(0x1F);
-        _interface->print(source,HEX);
-        _interface->write(0x1F);
+        unsigned int chars = 0;
+        chars += _interface->write(0x01);
+        chars += _interface->print(type,HEX);
+        chars += _interface->write(0x1F);
+        chars += _interface->print(target,HEX);
+        chars += _interface->write(0x1F);
+        chars += _interface->print(source,HEX);
+        chars += _interface->write(0x1F);
         if(port > 0) {
-            _interface->print(port,HEX);
+            chars += _interface->print(port,HEX);
         }else{
             //Arduino print internally casts to double :(
-            _interface->print(F("FF"));
+            chars += _interface->print(F("FF"));
         }
-        _interface->write(0x1F);
-        _interface->print(len,HEX);
+        chars += _interface->write(0x1F);
+        chars += _interface->print(len,HEX);
 
-        _interface->write(0x02);
+        chars += _interface->write(0x02);
         if(len > 0) {
             for(tlen = 0; tlen < len; tlen++) {
-                _interface->print(data[tlen], HEX);
-                _interface->write(0x1F);
+                chars += _interface->print(data[tlen], HEX);
+                chars += _interface->write(0x1F);
             }
         }
-        _interface->write(0x04);
-        _interface->println();
+        chars += _interface->write(0x04);
+        chars += _interface->println();
+        utilAdd(chars * ASB_UART_BITS);
         return true;
     }
 
@@ -99,11 +109,13 @@
         byte curwrite;
         bool retry = false;
         bool break2 = false;
+        unsigned int chars = 0;
 
         if(!_interface->available()) return false;
 
         while(_interface->available()) {
             read = _interface->read();
+            chars++;
 
             if(read == 0x01) bufShift(_buf[0]);
 
@@ -187,6 +199,7 @@
                                     break;
                                 case 8:
                                     bufShift(read);
+                                    utilAdd(chars * ASB_UART_BITS);
                                     return true;
                             }
                         }
@@ -196,6 +209,7 @@
                 }
             }while(retry);
         }
+        utilAdd(chars * ASB_UART_BITS);
         return false;
     }
 
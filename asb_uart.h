@@ -24,6 +24,15 @@
     #include "asb.h"
     #include "Stream.h"
 
+    /**
+     * Bits per character on the wire
+     *
+     * Used to estimate the utilization, default is 10 for 8N1.
+     */
+    #ifndef ASB_UART_BITS
+        #define ASB_UART_BITS 10
+    #endif
+
     /**
      * UART Communication Interface
      * @see ASB_COMM
@@ -36,6 +45,11 @@
             //unsigned int _interface;
             Stream *_interface;
 
+            /**
+             * Baud rate, 0 if unknown
+             */
+            unsigned long _baud = 0;
+
             /**
              * Incoming data buffer
              */
@@ -57,10 +71,16 @@
             /**
              * Constructor for UART interface
              * @param Serial object used for this communication
-             * @param unsigned int UART bus speed
              */
             ASB_UART(Stream &serial);
 
+            /**
+             * Constructor for UART interface with known speed
+             * @param Serial object used for this communication
+             * @param baud baud rate the Serial object was started with, used for utilization()
+             */
+            ASB_UART(Stream &serial, unsigned long baud);
+
             /**
              * Initialize UART, just a dummy
              * @return byte error code, always 0/success
@@ -90,6 +110,12 @@
              */
             bool asbReceive(asbPacket &pkg);
 
+            /**
+             * Baud rate given in the constructor
+             * @return unsigned long bits per second, 0 if unknown
+             */
+            unsigned long bitrate(void);
+
             /**
              * Convert ASCII hex to byte
              *
@@ -0,0 +1,94 @@
+/**
+ * aSysBus flash table example
+ *
+ * Nodes built for a fixed role don't need to read their configuration from
+ * EEPROM. Here the node ID, inputs, outputs and hooks are declared as tables
+ * which are checked while compiling and stay in flash, so they use no RAM
+ * for configuration. Entries stored in EEPROM for the same pin still take
+ * precedence, so only changes have to be written to the node.
+ */
+
+#include "asb.h"
+
+//Our node ID, compilation fails if it is out of range
+ASB_NODE_ID(nodeId, 0x123);
+
+//Send changes on pin 7 to group 0x1001, toggle on every high-pulse
+//Button is inverted and internal pull-up active
+//Pin 8 toggles group 0x1003 on short press, dims it while held and
+//sends a pulse to group 0x1002 on double-click within 400ms
+//Fields: pin, target, invert, pullup, mode, debounce in ms (optional),
+//        hold, repeat, step, double-click (10ms), double-click target (optional)
+ASB_IO_DIN_TABLE(inputs,
+  {7, 0x1001, true, true, ASB_IO_DIN_BTOGGLE, 20},
+  {8, 0x1003, true, true, ASB_IO_DIN_GESTURE, 0, 0, 0, 0, 40, 0x1002}
+);
+
+//Output requests targeted at group 0x1001 to pin 9 using LED-dimming for %-messages
+//Pin 10 follows group 0x1003 and fades from 0 to 100% within 2 seconds
+//Pin 11 is a staircase light for group 0x1004, switching off after 2 minutes
+//Fields: pin, target, invert, init, mode, fade in 100ms (optional),
+//        on-time in 100ms (optional)
+ASB_IO_DOUT_TABLE(outputs,
+  {9, 0x1001, false, false, ASB_IO_DOUT_LED},
+  {10, 0x1003, false, false, ASB_IO_DOUT_LED, 20},
+  {11, 0x1004, false, false, ASB_IO_DOUT_STAIR, 0, 1200}
+);
+
+//Send the temperature of a LM35 on A0 to group 0x2001 using 8 readings per value
+//A change of 0.5°C is sent at most every 5 seconds, unchanged values every 5 minutes
+//Fields: pin, target, command, value at 5V, value at 0V, samples, deadband,
+//        interval in 100ms, heartbeat in s
+ASB_IO_AIN_TABLE(sensors,
+  {A0, 0x2001, ASB_CMD_S_TEMP, 5000, 0, 8, 5, 50, 300}
+);
+
+//This is a custom actor, we link it below to a bus event
+void testHook(asbPacket &pkg) {
+  Serial.print(F("Group 0x1002 switched "));
+  Serial.println(pkg.data[1]);
+}
+
+//Fields: type, target, port, first data byte, function
+ASB_HOOK_TABLE(hooks,
+  {0xFF, 0x1002, -1, ASB_CMD_1B, testHook}
+);
+
+//Create new ASB node, use EEPROM address 0 - MAX for overrides
+//nodeId is used unless a different ID was stored in EEPROM
+ASB asb0(0, EEPROM.length() - 1, nodeId);
+
+//Start new CAN-Bus with 125KBps and 16MHz crystal using CS pin 10 and Interrupt pin 2
+ASB_CAN asbCan0(10, CAN_125KBPS, MCP_16MHz, 2);
+
+//Load modules with their flash tables, use ID 1 to 3 for EEPROM overrides
+ASB_IO_DIN asbDIn0(1, inputs);
+ASB_IO_DOUT asbDOut0(2, outputs);
+ASB_IO_AIN asbAIn0(3, sensors);
+
+void setup() {
+  //Initialize Serial port
+  Serial.begin(115200);
+  Serial.println(F("ASB Test Node started"));
+
+  //Attach the previously defined CAN-Bus to our controller
+  Serial.print(F("Attach CAN..."));
+  if(asb0.busAttach(&asbCan0) < 0) {
+    Serial.println(F("Error!"));
+  }else{
+    Serial.println(F("done!"));
+  }
+
+  //Use the hooks from flash
+  asb0.hookTable(hooks);
+
+  //Bind the modules, this activates the flash tables and reads overrides from EEPROM
+  asb0.hookAttachModule(&asbDIn0);
+  asb0.hookAttachModule(&asbDOut0);
+  asb0.hookAttachModule(&asbAIn0);
+}
+
+void loop() {
+  //Everything is handled in the asb0-object, not much to do here
+  asb0.loop();
+}
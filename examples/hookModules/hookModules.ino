@@ -13,7 +13,7 @@
 
 //Create new ASB node, use EEPROM address 0 - MAX for configuration
 //This is the "brain"
-ASB asb0(0, EEPROM.length());
+ASB asb0(0, EEPROM.length() - 1);
 
 //Start new CAN-Bus with 125KBps and 16MHz crystal using CS pin 10 and Interrupt pin 2
 ASB_CAN asbCan0(10, CAN_125KBPS, MCP_16MHz, 2);
@@ -86,6 +86,12 @@ void setup() {
 
   //Execute firstboot if neccesary
   asb0.firstboot(firstboot);
+
+  //Module configuration is stored inside the controller, see ASB_ARENA
+  Serial.print(F("Config memory used/free: "));
+  Serial.print(asb0.arenaUsed());
+  Serial.print(F("/"));
+  Serial.println(asb0.arenaAvailable());
 }
 
 void loop() {
@@ -0,0 +1,1540 @@
+/**
+  aSysBus host benchmarks
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Benchmarks and checks of single parts of the library
+ *
+ * Runs the library on a POSIX host using the Arduino API of tools/host.
+ * The first argument selects the test, every test prints CSV with its own
+ * columns. Tests exit with 1 if a check failed.
+ *
+ * Build on a POSIX host, the arena has to hold up to 128 outputs and the
+ * controller up to 500 timers, queue needs threads:
+ *   g++ -O2 -pthread -DASB_ARENA=4096 -DASB_TIMERNUM=512 -Ihost -I.. -o asbbench asbbench.cpp host/Arduino.cpp ../asb*.cpp
+ *
+ * Usage:
+ *   asbbench cfg [-n operations] [-S seed]
+ *   asbbench wear [-n commits] [-S seed]
+ *   asbbench crash [-n commits] [-S seed]
+ *   asbbench scan [-n loops] [-S seed]
+ *   asbbench din
+ *   asbbench gesture
+ *   asbbench fade
+ *   asbbench lookup [-n lookups] [-S seed]
+ *   asbbench timers [-n seconds] [-S seed]
+ *   asbbench group [-n packets]
+ *   asbbench dispatch [-n packets] [-S seed]
+ *   asbbench ain
+ *   asbbench replay [-n packets] [-S seed]
+ *   asbbench queue [-n packets]
+ *   asbbench util
+ *
+ * cfg allocates and frees configuration blocks at random, from 2 bytes up
+ * to the largest module configuration ASB_EEPROM_CACHE allows, like
+ * modules being attached and detached, keeping the configuration
+ * space about 70% full. Every tenth of the run adds a line with the
+ * columns ops, allocs, failed, used_blocks, used_bytes, free_blocks,
+ * free_bytes, free_largest, tail, util (percent of the space used) and
+ * frag (percent of the unused space not available as one block). The last
+ * line shows the result of ASB::cfgCompact(), which has to keep every
+ * block with its owner.
+ *
+ * wear commits transactions changing a few bytes out of a set of
+ * frequently used addresses to asbEEPROM in the 512 bytes of an ATmega328.
+ * Each line shows the columns addresses, changes (per commit), commits,
+ * journal, max_cell and writes with the most written cell and the total
+ * number of cell writes, max_cell_direct and writes_direct the same for
+ * writing every change in place.
+ *
+ * crash runs a sequence of transactions and cuts the power once at every
+ * single EEPROM write, see tools/host/EEPROM.h. After each power loss the
+ * configuration must show the interrupted transaction completely or not
+ * at all, and has to survive further commits and power cycles. Power
+ * lost after the CRC, while a full journal is written in place, has to
+ * keep the transaction, so completed must not be 0. The columns are
+ * points, completed, rolled_back and errors.
+ *
+ * scan attaches 8, 16 and 32 digital inputs on the simulated ports of
+ * tools/host and measures the wall clock time of ASB_IO_DIN::loop(). The
+ * columns are inputs, ports, loops, idle_ns per loop without changes and
+ * change_ns per loop with one random pin toggling every millisecond.
+ * Afterwards every input must have reported its final level.
+ *
+ * din bounces digital inputs on the simulated ports. Every change has to
+ * be sent once, after the level was stable for the debounce time of the
+ * input, shorter pulses not at all. The second input is stored in EEPROM
+ * without the debounce field and has to use ASB_IO_DIN_DEBOUNCE. The
+ * columns are phase, pin, toggles, sent, expected, latency_ms from the
+ * last edge to the packet and debounce_ms.
+ *
+ * gesture clicks, double-clicks and holds a push-button in gesture mode.
+ * A click has to toggle once the double-click window passed, a double-click
+ * has to send a pulse to its own target and holding has to dim in steps
+ * up to 100% and back down. The second button is stored in EEPROM without
+ * the gesture fields and has to use the defaults, toggling on release and
+ * dimming by 10% after 500ms and every 200ms. The columns are phase, pin,
+ * clicks, down_ms, up_ms, sent and expected packets, which have to match
+ * in command, target and value.
+ *
+ * fade checks the LED gamma table against the curve it was calculated
+ * from and fades PWM outputs up and down. Every millisecond the PWM value
+ * has to match the level expected from the fade time of one percent. The
+ * third output is stored in EEPROM without the fade field and has to
+ * change at once. The columns are phase, pin, from, to, fade_ms per
+ * percent, ms until the goal was reached, expected_ms and mismatches of
+ * the PWM value.
+ *
+ * lookup finds random group targets, half of them unused, in the target
+ * index of 4, 32 and 128 outputs. The columns are items, lookups, find_ns
+ * per asbIoIndexFind(), linear_ns per lookup comparing every entry and
+ * process_ns per packet handled by ASB_IO_DOUT::process(). Both searches
+ * have to find the same targets.
+ *
+ * timers runs 100, 250 and 500 periodic timers of 10ms to 1s for a number
+ * of simulated seconds, calling ASB::loop() every millisecond. One timer
+ * is replaced by a one-shot of 5 hours, which needs more than 65536 turns
+ * of the wheel. The columns are timers, seconds, calls, loop_ns per
+ * ASB::loop() and late_ms of the one-shot. Every timer has to be called
+ * once per period, a period longer than 65535 ticks has to be refused.
+ *
+ * group switches a group of six digital outputs spread over two ports,
+ * one of them inverted, on and off. Each switch has to update the output
+ * register of both ports once and must not write single pins. The columns
+ * are outputs, ports, switches, port_writes and pin_writes of this check
+ * and process_ns per packet of a longer run.
+ *
+ * dispatch passes group packets through ASB::asbProcess() to 16 modules
+ * handling one group each, half of the packets are for other groups.
+ * With "all" the modules keep the ASB_IO defaults and receive every
+ * packet like before the dispatch index, with "indexed" they subscribe
+ * to their group. The columns are modules, dispatch, packets,
+ * calls_per_packet of ASB_IO::process() and process_ns per packet.
+ *
+ * ain feeds readings set with hostAnalog() to an analog input with a
+ * deadband, minimum interval and heartbeat. The first value has to be
+ * sent, changes within the deadband not, larger changes once the interval
+ * has passed and an unchanged value once per heartbeat. Each phase shows
+ * the columns phase, value, ms, sent and expected. A second input is
+ * attached to EEPROM before.
+ *
+ * replay records packets of all types sent at random times with
+ * ASB::captureAttach() and replays the capture with ASB_REPLAY as fast as
+ * possible and at the original speed. No identifier may carry the
+ * SocketCAN error flag. Every packet has to come back unchanged, at
+ * speed 0 at once and at speed 100 no earlier than recorded and at most
+ * 1ms later. The columns are speed, packets, replayed, mismatched, early,
+ * late_max_ms and replay_ms.
+ *
+ * queue first fills ASB::asbQueue() up to ASB_QUEUE_SIZE, one more packet
+ * has to be refused and one ASB::loop() has to send them all. Then 1, 2,
+ * 4 and 8 threads queue a number of numbered packets each, retrying
+ * refused ones, while the main thread runs ASB::loop(). Every packet has
+ * to be sent once and the packets of each thread in their order. The
+ * columns are producers, packets (per producer), refused, loops and
+ * ns_per_packet.
+ *
+ * util checks ASB_CAN::frameBits() against the worst case of an extended
+ * frame, 80 bits plus 10 per data byte, and feeds 8 byte frames of 160
+ * bits to ASB_COMM::utilization() of a 125kbit/s interface every 10ms at
+ * a fixed millis(). The phases check the start after power up, half and
+ * full load, the window sliding over an idle bus and being reset after a
+ * whole idle window. Each phase shows the columns phase, frames (per
+ * 10ms), ms, util and expected. Interfaces without a known bitrate have
+ * to report 0xFF.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+#include <new>
+#include <vector>
+#include <atomic>
+#include <thread>
+
+#include "asb.h"
+
+/**
+ * Test parameters
+ */
+struct Options {
+    unsigned long count = 0; //Operations, 0 = default of the test
+    unsigned long seed = 1;
+};
+
+/**
+ * Random numbers, xorshift32
+ */
+static uint32_t random32(uint32_t &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+/**
+ * Create a controller like a sketch would, members without initializer rely on zeroed memory
+ * @param start first EEPROM address, stop < start for a controller without EEPROM
+ * @param stop last EEPROM address
+ * @param id node ID
+ */
+static ASB *controller(unsigned int start, unsigned int stop, unsigned int id) {
+    void *mem = calloc(1, sizeof(ASB));
+    if(stop < start) return new(mem) ASB(id);
+    return new(mem) ASB(start, stop, id);
+}
+
+/**
+ * Create a module like a sketch would, in zeroed memory
+ */
+template <typename T, typename... Args> static T *module(Args... args) {
+    return new(calloc(1, sizeof(T))) T(args...);
+}
+
+template <typename T> static void release(T *obj) {
+    obj->~T();
+    free(obj);
+}
+
+/**
+ * Monotonic wall clock for timing, independent of the simulated millis()
+ */
+static uint64_t nanos(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Packet sent through BenchBus
+ */
+struct BenchFrame {
+    unsigned long ms;
+    unsigned int target;
+    byte len;
+    byte data[8];
+};
+
+/**
+ * Bus counting sent packets per command
+ */
+class BenchBus : public ASB_COMM {
+    public:
+        unsigned long sent[256] = {};
+
+        /**
+         * Every sent packet if record is set
+         */
+        std::vector<BenchFrame> frames;
+        bool record = false;
+
+        byte begin(void) {
+            return 0;
+        }
+
+        bool asbSend(byte type, unsigned int target, unsigned int source, char port, byte len, const byte *data) {
+            if(len > 0) sent[data[0]]++;
+            if(record) {
+                BenchFrame frame = {millis(), target, len, {}};
+                memcpy(frame.data, data, (len < sizeof(frame.data)) ? len : sizeof(frame.data));
+                frames.push_back(frame);
+            }
+            return true;
+        }
+
+        bool asbReceive(asbPacket &pkg) {
+            return false;
+        }
+};
+
+/**
+ * Configuration block in use
+ */
+struct CfgBlock {
+    unsigned int address;
+    byte id;
+};
+
+static void cfgLine(ASB *asb, unsigned long ops, unsigned long allocs, unsigned long failed) {
+    asbCfgStats stats;
+    asb->cfgStats(stats);
+
+    unsigned int unused = stats.freeBytes + stats.tailBytes;
+    unsigned int space = stats.usedBytes + unused;
+    unsigned int largest = (stats.freeLargest > stats.tailBytes) ? stats.freeLargest : stats.tailBytes;
+    printf("%lu,%lu,%lu,%u,%u,%u,%u,%u,%u,%.1f,%.1f\n", ops, allocs, failed,
+        stats.usedBlocks, stats.usedBytes, stats.freeBlocks, stats.freeBytes, stats.freeLargest, stats.tailBytes,
+        (space > 0) ? stats.usedBytes * 100.0 / space : 0.0,
+        (unused > 0) ? (unused - largest) * 100.0 / unused : 0.0);
+}
+
+static int benchCfg(const Options &opt) {
+    unsigned long ops = (opt.count > 0) ? opt.count : 100000;
+    unsigned long allocs = 0, failed = 0, i;
+    uint32_t random = opt.seed | 1;
+    std::vector<CfgBlock> blocks;
+    unsigned int used = 0, address;
+    int errors = 0;
+
+    memset(EEPROM.mem, 0xFF, sizeof(EEPROM.mem));
+    ASB *asb = controller(0, EEPROM.length() - 1, 1);
+
+    //Everything except the node ID and the journal
+    asbCfgStats stats;
+    asb->cfgStats(stats);
+    unsigned int space = stats.tailBytes;
+    if(space != (unsigned int)(EEPROM.length() - 2 - ASB_EEPROM_JOURNAL)) errors++;
+
+    printf("ops,allocs,failed,used_blocks,used_bytes,free_blocks,free_bytes,free_largest,tail,util,frag\n");
+    for(i=1; i<=ops; i++) {
+        address = 0;
+        if(blocks.empty() || (used < space * 7 / 10 && random32(random) % 4 != 0)) {
+            byte bytes = 2 + random32(random) % (ASB_EEPROM_CACHE - 2 * ASB_CFG_HEADER - 1);
+            byte id = 1 + random32(random) % 15;
+            allocs++;
+            if((address = asb->cfgFindFreeblock(bytes, id)) != 0) {
+                blocks.push_back({address, id});
+                used += asbEEPROM.read(address + 1); //Split remainders too small for a block stay attached
+            }else{
+                failed++;
+            }
+        }
+
+        //Detach, also if no block fitted
+        if(address == 0 && !blocks.empty()) {
+            unsigned int n = random32(random) % blocks.size();
+            used -= asbEEPROM.read(blocks[n].address + 1);
+            if(!asb->cfgFree(blocks[n].address)) errors++;
+            blocks[n] = blocks.back();
+            blocks.pop_back();
+        }
+
+        if(i % (ops / 10 > 0 ? ops / 10 : 1) == 0) cfgLine(asb, i, allocs, failed);
+    }
+
+    //Every block has to be found by its owner
+    for(CfgBlock &block : blocks) {
+        for(address = 0; (address = asb->cfgNextBlock(address, block.id)) != 0 && address != block.address; );
+        if(address == 0) errors++;
+    }
+
+    //Compaction keeps every block with its owner and its length
+    std::vector<unsigned int> owned(16);
+    for(CfgBlock &block : blocks) owned[block.id] += asbEEPROM.read(block.address + 1);
+    asb->cfgCompact();
+    cfgLine(asb, ops, allocs, failed);
+    asb->cfgStats(stats);
+    if(stats.usedBlocks != blocks.size() || stats.freeBlocks != 0) errors++;
+    for(byte id=1; id<16; id++) {
+        for(address = 0; (address = asb->cfgNextBlock(address, id)) != 0; ) owned[id] -= asbEEPROM.read(address + 1);
+        if(owned[id] != 0) errors++;
+    }
+
+    //Fill up, the last block has to end at the last address of the space
+    for(int bytes=0xFF-ASB_CFG_HEADER; bytes>=0; bytes--) {
+        while(asb->cfgFindFreeblock(bytes, 1) != 0);
+    }
+    asb->cfgStats(stats);
+    if(stats.usedBytes != space || stats.tailBytes != 0) errors++;
+
+    release(asb);
+    if(errors > 0) fprintf(stderr, "cfg: %d inconsistencies\n", errors);
+    return errors > 0;
+}
+
+/**
+ * Transaction changing random bytes out of a small set of addresses
+ * @param random generator state
+ * @param mem expected content, updated
+ * @param addresses number of addresses used, starting at 2
+ * @param changes number of bytes to change
+ * @return bool result of commit()
+ */
+static bool eepromCommit(uint32_t &random, byte *mem, unsigned int addresses, byte changes) {
+    asbEEPROM.transaction();
+    for(byte i=0; i<changes; i++) {
+        unsigned int address = 2 + random32(random) % addresses;
+        mem[address] += 1 + random32(random) % 255; //Always changed
+        asbEEPROM.update(address, mem[address]);
+    }
+    return asbEEPROM.commit();
+}
+
+/**
+ * Compare the configuration space
+ * @param mem expected content
+ * @param last last address of the configuration space
+ * @return bool true if equal
+ */
+static bool eepromEqual(const byte *mem, unsigned int last) {
+    for(unsigned int address=0; address<=last; address++) {
+        if(asbEEPROM.read(address) != mem[address]) return false;
+    }
+    return true;
+}
+
+static int benchWear(const Options &opt) {
+    unsigned long commits = (opt.count > 0) ? opt.count : 10000;
+    unsigned long direct[ASB_HOST_EEPROM], i;
+    byte mem[ASB_HOST_EEPROM];
+    int errors = 0;
+
+    //Hot addresses and changes per commit
+    static const byte loads[][2] = {{1, 1}, {4, 1}, {4, 4}, {16, 1}, {16, 4}, {16, 8}};
+
+    printf("addresses,changes,commits,journal,max_cell,max_cell_direct,writes,writes_direct\n");
+    for(auto &load : loads) {
+        uint32_t random = opt.seed | 1;
+        unsigned long max = 0, maxDirect = 0, writes = 0, writesDirect = 0;
+
+        EEPROM.erase();
+        memset(mem, 0xFF, sizeof(mem));
+        memset(direct, 0, sizeof(direct));
+        unsigned int last = asbEEPROM.begin(0, 511);
+
+        for(i=0; i<commits; i++) {
+            byte before[ASB_HOST_EEPROM];
+            memcpy(before, mem, sizeof(mem));
+            if(!eepromCommit(random, mem, load[0], load[1])) errors++;
+            for(unsigned int address=0; address<=last; address++) {
+                if(mem[address] != before[address]) direct[address]++;
+            }
+        }
+
+        for(i=0; i<ASB_HOST_EEPROM; i++) {
+            if(EEPROM.writes[i] > max) max = EEPROM.writes[i];
+            if(direct[i] > maxDirect) maxDirect = direct[i];
+            writes += EEPROM.writes[i];
+            writesDirect += direct[i];
+        }
+
+        //Nothing may get lost by rebooting
+        asbEEPROM.begin(0, 511);
+        if(!eepromEqual(mem, last)) errors++;
+
+        printf("%u,%u,%lu,%u,%lu,%lu,%lu,%lu\n", load[0], load[1], commits, ASB_EEPROM_JOURNAL, max, maxDirect, writes, writesDirect);
+    }
+
+    if(errors > 0) fprintf(stderr, "wear: %d inconsistencies\n", errors);
+    return errors > 0;
+}
+
+static int benchCrash(const Options &opt) {
+    unsigned long commits = (opt.count > 0) ? opt.count : 100;
+    unsigned long points = 0, completed = 0, rolledBack = 0, errors = 0, i;
+    byte mem[ASB_HOST_EEPROM], before[ASB_HOST_EEPROM];
+    unsigned int last = 0;
+
+    for(long power=0; ; power++) {
+        uint32_t random = opt.seed | 1;
+        bool lost = false;
+
+        EEPROM.erase();
+        memset(mem, 0xFF, sizeof(mem));
+        last = asbEEPROM.begin(0, 511);
+        EEPROM.power = power;
+
+        for(i=0; i<commits && !lost; i++) {
+            memcpy(before, mem, sizeof(mem));
+            eepromCommit(random, mem, 24, 1 + random32(random) % 4);
+            lost = EEPROM.lost;
+        }
+        if(!lost) break; //Every write was interrupted once
+        points++;
+
+        //Reboot, the interrupted transaction is either complete or missing
+        EEPROM.powerOn();
+        asbEEPROM.begin(0, 511);
+        if(eepromEqual(mem, last)) {
+            completed++;
+        }else if(eepromEqual(before, last)) {
+            rolledBack++;
+            memcpy(mem, before, sizeof(mem));
+        }else{
+            errors++;
+            continue;
+        }
+
+        //Following commits must not be mixed up with records written before the power loss
+        for(i=0; i<8; i++) {
+            eepromCommit(random, mem, 24, 1 + random32(random) % 4);
+            asbEEPROM.begin(0, 511);
+            if(!eepromEqual(mem, last)) {
+                errors++;
+                break;
+            }
+        }
+    }
+
+    //Some cuts hit the writes in place behind a valid record
+    if(completed == 0) errors++;
+
+    printf("points,completed,rolled_back,errors\n%lu,%lu,%lu,%lu\n", points, completed, rolledBack, errors);
+    if(errors > 0) fprintf(stderr, "crash: %lu inconsistencies\n", errors);
+    return errors > 0;
+}
+
+static int benchScan(const Options &opt) {
+    unsigned long loops = (opt.count > 0) ? opt.count : 100000;
+    static const byte sizes[] = {8, 16, 32};
+    int errors = 0;
+
+    printf("inputs,ports,loops,idle_ns,change_ns\n");
+    for(byte inputs : sizes) {
+        uint32_t random = opt.seed | 1;
+        BenchBus bus;
+        ASB_IO_DIN *din = module<ASB_IO_DIN>(1);
+        unsigned long i;
+        byte pin;
+
+        EEPROM.erase();
+        memset(hostPorts, 0, sizeof(hostPorts));
+        ASB *asb = controller(0, EEPROM.length() - 1, 1);
+        asb->busAttach(&bus);
+        asb->hookAttachModule(din);
+        //Pin 0 is not valid for configuration, start with the second port
+        for(pin=8; pin<8+inputs; pin++) {
+            if(!din->attach(0x1000 + pin, pin, ASB_IO_DIN_DIRECT, false, false)) {
+                fprintf(stderr, "scan: no room for %u inputs, build with -DASB_ARENA=4096\n", inputs);
+                release(asb);
+                release(din);
+                return 1;
+            }
+        }
+
+        //Nothing changes, every port is sampled once
+        uint64_t start = nanos();
+        for(i=0; i<loops; i++) din->loop();
+        uint64_t idle = nanos() - start;
+
+        //One pin changes per millisecond and has to be debounced
+        start = nanos();
+        for(i=0; i<loops; i++) {
+            pin = 8 + random32(random) % inputs;
+            hostPin(pin, !digitalRead(pin));
+            delay(1);
+            din->loop();
+        }
+        uint64_t change = nanos() - start;
+
+        //Let everything settle, then every low input has to report going high once
+        delay(ASB_IO_DIN_DEBOUNCE);
+        din->loop();
+        unsigned long low = 0;
+        for(pin=8; pin<8+inputs; pin++) {
+            if(!digitalRead(pin)) low++;
+            hostPin(pin, HIGH);
+        }
+        bus.sent[ASB_CMD_1B] = 0;
+        din->loop();
+        delay(ASB_IO_DIN_DEBOUNCE);
+        din->loop();
+        if(bus.sent[ASB_CMD_1B] != low) errors++;
+
+        printf("%u,%u,%lu,%.1f,%.1f\n", inputs, (inputs + 7) / 8, loops, (double)idle / loops, (double)change / loops);
+        release(asb);
+        release(din);
+    }
+
+    if(errors > 0) fprintf(stderr, "scan: %d inconsistencies\n", errors);
+    return errors > 0;
+}
+
+static int benchDin(const Options &opt) {
+    int errors = 0;
+
+    //Pin 9 is stored in EEPROM without the debounce field and uses ASB_IO_DIN_DEBOUNCE
+    static const asbIoDIn table[] = {
+        {8, 0x1001, false, false, ASB_IO_DIN_DIRECT, 20},
+    };
+    //Toggles every ms apart, the last level is kept for hold ms
+    static const struct {
+        const char *name;
+        byte pin;
+        byte toggles;
+        byte every;
+        unsigned int hold;
+        unsigned long sent;
+        unsigned int debounce;
+    } phases[] = {
+        {"press", 8, 5, 2, 100, 1, 20},
+        {"release", 8, 7, 3, 100, 1, 20},
+        {"glitch", 8, 2, 10, 100, 0, 20},
+        {"default", 9, 3, 2, 100, 1, ASB_IO_DIN_DEBOUNCE},
+    };
+
+    BenchBus bus;
+    bus.record = true;
+    hostTime(0);
+    EEPROM.erase();
+    memset(hostPorts, 0, sizeof(hostPorts));
+    ASB *asb = controller(0, EEPROM.length() - 1, 1);
+    asb->busAttach(&bus);
+
+    //Short block followed by a block of another module, which must not be read as debounce
+    asbIoDIn cfg = {9, 0x1002, false, false, ASB_IO_DIN_DIRECT};
+    unsigned int address = asb->cfgFindFreeblock(offsetof(asbIoDIn, debounce), 1);
+    unsigned int other = asb->cfgFindFreeblock(sizeof(asbIoDIn), 2);
+    unsigned int i;
+    if(address == 0 || other == 0) errors++;
+    asbEEPROM.transaction();
+    for(i=0; i<offsetof(asbIoDIn, debounce); i++) asbEEPROM.update(address + ASB_CFG_HEADER + i, ((byte *) &cfg)[i]);
+    for(i=0; i<sizeof(asbIoDIn); i++) asbEEPROM.update(other + ASB_CFG_HEADER + i, 5);
+    if(!asbEEPROM.commit()) errors++;
+
+    ASB_IO_DIN *din = module<ASB_IO_DIN>(1, table, (byte)(sizeof(table) / sizeof(table[0])));
+    if(!asb->hookAttachModule(din)) {
+        fprintf(stderr, "din: no room for inputs\n");
+        release(asb);
+        release(din);
+        return 1;
+    }
+
+    printf("phase,pin,toggles,sent,expected,latency_ms,debounce_ms\n");
+    for(auto &phase : phases) {
+        unsigned long edge = 0;
+        long latency = -1;
+        byte t;
+
+        bus.frames.clear();
+        for(t=0; t<phase.toggles; t++) {
+            hostPin(phase.pin, !digitalRead(phase.pin));
+            edge = millis();
+            for(i=0; i<phase.every; i++) {
+                delay(1);
+                din->loop();
+            }
+        }
+        for(i=0; i<phase.hold; i++) {
+            delay(1);
+            din->loop();
+        }
+
+        //One packet with the final level once it was stable for the debounce time
+        if(bus.frames.size() != phase.sent) errors++;
+        if(!bus.frames.empty()) {
+            BenchFrame &frame = bus.frames.front();
+            latency = frame.ms - edge;
+            if(frame.data[0] != ASB_CMD_1B || frame.data[1] != digitalRead(phase.pin)) errors++;
+            if(latency < phase.debounce || latency > phase.debounce + 1) errors++;
+        }
+
+        printf("%s,%u,%u,%lu,%lu,%ld,%u\n", phase.name, phase.pin, phase.toggles, (unsigned long)bus.frames.size(), phase.sent, latency, phase.debounce);
+    }
+    release(asb);
+    release(din);
+
+    if(errors > 0) fprintf(stderr, "din: %d inconsistencies\n", errors);
+    return errors > 0;
+}
+
+static int benchGesture(const Options &opt) {
+    int errors = 0;
+
+    //Pin 16 holds after 400ms, repeats every 100ms by 20% and waits 300ms for a double-click
+    static const asbIoDIn table[] = {
+        {16, 0x2001, false, false, ASB_IO_DIN_GESTURE, 10, 40, 10, 20, 30, 0x2101},
+    };
+    //Presses of down ms, up ms apart, followed by a second of idle time
+    static const struct {
+        const char *name;
+        byte pin;
+        byte clicks;
+        unsigned int down;
+        unsigned int up;
+        byte sent;
+        BenchFrame expect[5];
+    } phases[] = {
+        {"click", 16, 1, 100, 0, 1, {{0, 0x2001, 2, {ASB_CMD_1B, 1}}}},
+        {"double", 16, 2, 100, 100, 1, {{0, 0x2101, 1, {ASB_CMD_0B}}}},
+        {"hold_up", 16, 1, 1000, 0, 5, {
+            {0, 0x2001, 2, {ASB_CMD_PER, 20}}, {0, 0x2001, 2, {ASB_CMD_PER, 40}}, {0, 0x2001, 2, {ASB_CMD_PER, 60}},
+            {0, 0x2001, 2, {ASB_CMD_PER, 80}}, {0, 0x2001, 2, {ASB_CMD_PER, 100}}}},
+        {"hold_down", 16, 1, 500, 0, 1, {{0, 0x2001, 2, {ASB_CMD_PER, 80}}}},
+        {"default_click", 17, 1, 100, 0, 1, {{0, 0x2002, 2, {ASB_CMD_1B, 1}}}},
+        {"default_hold", 17, 1, 800, 0, 2, {{0, 0x2002, 2, {ASB_CMD_PER, 10}}, {0, 0x2002, 2, {ASB_CMD_PER, 20}}}},
+    };
+
+    BenchBus bus;
+    bus.record = true;
+    hostTime(0);
+    EEPROM.erase();
+    memset(hostPorts, 0, sizeof(hostPorts));
+    ASB *asb = controller(0, EEPROM.length() - 1, 1);
+    asb->busAttach(&bus);
+
+    //Pin 17 is stored without the gesture fields, the following block must not be read as their values
+    asbIoDIn cfg = {17, 0x2002, false, false, ASB_IO_DIN_GESTURE};
+    unsigned int address = asb->cfgFindFreeblock(offsetof(asbIoDIn, hold), 1);
+    unsigned int other = asb->cfgFindFreeblock(sizeof(asbIoDIn), 2);
+    unsigned int i;
+    if(address == 0 || other == 0) errors++;
+    asbEEPROM.transaction();
+    for(i=0; i<offsetof(asbIoDIn, hold); i++) asbEEPROM.update(address + ASB_CFG_HEADER + i, ((byte *) &cfg)[i]);
+    for(i=0; i<sizeof(asbIoDIn); i++) asbEEPROM.update(other + ASB_CFG_HEADER + i, 5);
+    if(!asbEEPROM.commit()) errors++;
+
+    ASB_IO_DIN *din = module<ASB_IO_DIN>(1, table, (byte)(sizeof(table) / sizeof(table[0])));
+    if(!asb->hookAttachModule(din)) {
+        fprintf(stderr, "gesture: no room for inputs\n");
+        release(asb);
+        release(din);
+        return 1;
+    }
+
+    printf("phase,pin,clicks,down_ms,up_ms,sent,expected\n");
+    for(auto &phase : phases) {
+        byte c, n;
+
+        bus.frames.clear();
+        for(c=0; c<phase.clicks; c++) {
+            for(byte level : {HIGH, LOW}) {
+                hostPin(phase.pin, level);
+                for(i=0; i<((level == HIGH) ? phase.down : phase.up); i++) {
+                    delay(1);
+                    din->loop();
+                }
+            }
+        }
+        for(i=0; i<1000; i++) {
+            delay(1);
+            din->loop();
+        }
+
+        if(bus.frames.size() != phase.sent) errors++;
+        for(n=0; n<phase.sent && n<bus.frames.size(); n++) {
+            const BenchFrame &frame = bus.frames[n], &expect = phase.expect[n];
+            if(frame.target != expect.target || frame.len != expect.len || memcmp(frame.data, expect.data, expect.len) != 0) errors++;
+        }
+
+        printf("%s,%u,%u,%u,%u,%lu,%u\n", phase.name, phase.pin, phase.clicks, phase.down, phase.up, (unsigned long)bus.frames.size(), phase.sent);
+    }
+    release(asb);
+    release(din);
+
+    if(errors > 0) fprintf(stderr, "gesture: %d inconsistencies\n", errors);
+    return errors > 0;
+}
+
+static int benchFade(const Options &opt) {
+    int errors = 0;
+
+    //Pin 26 is stored in EEPROM without fade and duration
+    static const asbIoDOut table[] = {
+        {24, 0x3001, false, false, ASB_IO_DOUT_LED, 10},
+        {25, 0x3002, false, false, ASB_IO_DOUT_LIN, 5},
+    };
+    static const struct {
+        const char *name;
+        byte pin;
+        unsigned int target;
+        byte mode;
+        byte from;
+        byte to;
+        byte fade;
+    } phases[] = {
+        {"led_up", 24, 0x3001, ASB_IO_DOUT_LED, 0, 50, 10},
+        {"led_down", 24, 0x3001, ASB_IO_DOUT_LED, 50, 20, 10},
+        {"linear", 25, 0x3002, ASB_IO_DOUT_LIN, 0, 100, 5},
+        {"stored", 26, 0x3003, ASB_IO_DOUT_LED, 0, 50, 0},
+    };
+
+    //The table has to match the curve it was calculated from
+    double factor = (100 * log10(2)) / log10(255);
+    unsigned int i;
+    for(i=0; i<=100; i++) {
+        if(pgm_read_byte(&asbIoDOutGamma[i]) != (byte)(pow(2, i / factor) - 1)) errors++;
+    }
+
+    hostTime(0);
+    EEPROM.erase();
+    ASB *asb = controller(0, EEPROM.length() - 1, 1);
+
+    //Short block followed by a block of another module, which must not be read as fade
+    asbIoDOut cfg = {26, 0x3003, false, false, ASB_IO_DOUT_LED};
+    unsigned int address = asb->cfgFindFreeblock(offsetof(asbIoDOut, fade), 2);
+    unsigned int other = asb->cfgFindFreeblock(sizeof(asbIoDOut), 3);
+    if(address == 0 || other == 0) errors++;
+    asbEEPROM.transaction();
+    for(i=0; i<offsetof(asbIoDOut, fade); i++) asbEEPROM.update(address + ASB_CFG_HEADER + i, ((byte *) &cfg)[i]);
+    for(i=0; i<sizeof(asbIoDOut); i++) asbEEPROM.update(other + ASB_CFG_HEADER + i, 5);
+    if(!asbEEPROM.commit()) errors++;
+
+    ASB_IO_DOUT *dout = module<ASB_IO_DOUT>(2, table, (byte)(sizeof(table) / sizeof(table[0])));
+    if(!asb->hookAttachModule(dout)) {
+        fprintf(stderr, "fade: no room for outputs\n");
+        release(asb);
+        release(dout);
+        return 1;
+    }
+
+    printf("phase,pin,from,to,fade_ms,ms,expected_ms,mismatches\n");
+    for(auto &phase : phases) {
+        unsigned long steps = (phase.to > phase.from) ? (phase.to - phase.from) : (phase.from - phase.to);
+        unsigned long expected = steps * phase.fade, reached = 0, mismatches = 0, t;
+        byte level;
+
+        asbPacket pkg;
+        pkg.meta.type = ASB_PKGTYPE_MULTICAST;
+        pkg.meta.target = phase.target;
+        pkg.len = 2;
+        pkg.data[0] = ASB_CMD_PER;
+        pkg.data[1] = phase.to;
+        dout->process(pkg);
+
+        //One percent every fade ms, each on its own PWM value
+        for(t=0; t<=expected + 100; t++) {
+            if(t > 0) {
+                delay(1);
+                dout->loop();
+            }
+            level = (phase.fade == 0 || t / phase.fade >= steps) ? phase.to : ((phase.to > phase.from) ? (phase.from + t / phase.fade) : (phase.from - t / phase.fade));
+            if(hostPwm(phase.pin) != ((phase.mode == ASB_IO_DOUT_LED) ? pgm_read_byte(&asbIoDOutGamma[level]) : level * 255 / 100)) mismatches++;
+            if(level == phase.to && reached == 0 && t > 0) reached = t;
+        }
+        if(phase.fade == 0) reached = 0;
+        if(mismatches > 0 || reached != expected) errors++;
+
+        printf("%s,%u,%u,%u,%u,%lu,%lu,%lu\n", phase.name, phase.pin, phase.from, phase.to, phase.fade, reached, expected, mismatches);
+    }
+    release(asb);
+    release(dout);
+
+    if(errors > 0) fprintf(stderr, "fade: %d inconsistencies\n", errors);
+    return errors > 0;
+}
+
+static int benchLookup(const Options &opt) {
+    unsigned long lookups = (opt.count > 0) ? opt.count : 1000000;
+    static const byte sizes[] = {4, 32, 128};
+    int errors = 0;
+
+    printf("items,lookups,find_ns,linear_ns,process_ns\n");
+    for(byte items : sizes) {
+        uint32_t random = opt.seed | 1;
+        std::vector<asbIoDOut> table(items);
+        std::vector<asbIoIndex> index(items);
+        std::vector<unsigned int> targets(1024);
+        unsigned long i, hits = 0, hitsLinear = 0;
+        byte p;
+
+        //Every second target of the range is used, in random order
+        for(p=0; p<items; p++) {
+            table[p] = {};
+            table[p].pin = 1 + p;
+            table[p].target = 0x1000 + 2 * p;
+            table[p].mode = ASB_IO_DOUT_DIO;
+        }
+        for(p=items-1; p>0; p--) {
+            byte q = random32(random) % (p + 1);
+            asbIoDOut temp = table[p];
+            table[p] = table[q];
+            table[q] = temp;
+        }
+        for(p=0; p<items; p++) {
+            index[p].target = table[p].target;
+            index[p].item = p;
+        }
+        asbIoIndexSort(index.data(), items);
+        for(auto &target : targets) target = 0x1000 + random32(random) % (4 * items);
+
+        uint64_t start = nanos();
+        for(i=0; i<lookups; i++) {
+            unsigned int target = targets[i & 1023];
+            p = asbIoIndexFind(index.data(), items, target);
+            if(p < items && index[p].target == target) hits++;
+        }
+        uint64_t find = nanos() - start;
+
+        //Every entry is compared, like modules did before the index
+        start = nanos();
+        for(i=0; i<lookups; i++) {
+            unsigned int target = targets[i & 1023];
+            for(p=0; p<items; p++) {
+                if(table[p].target == target) {
+                    hitsLinear++;
+                    break;
+                }
+            }
+        }
+        uint64_t linear = nanos() - start;
+        if(hits != hitsLinear) errors++;
+
+        //Complete packet handling of an output module
+        ASB *asb = controller(1, 0, 1);
+        ASB_IO_DOUT *dout = module<ASB_IO_DOUT>(2, table.data(), items);
+        if(!asb->hookAttachModule(dout)) {
+            fprintf(stderr, "lookup: no room for %u outputs, build with -DASB_ARENA=4096\n", items);
+            release(asb);
+            release(dout);
+            return 1;
+        }
+        asbPacket pkg;
+        pkg.meta.type = ASB_PKGTYPE_MULTICAST;
+        pkg.len = 2;
+        pkg.data[0] = ASB_CMD_1B;
+        start = nanos();
+        for(i=0; i<lookups; i++) {
+            pkg.meta.target = targets[i & 1023];
+            pkg.data[1] = i & 1;
+            dout->process(pkg);
+        }
+        uint64_t process = nanos() - start;
+
+        printf("%u,%lu,%.1f,%.1f,%.1f\n", items, lookups, (double)find / lookups, (double)linear / lookups, (double)process / lookups);
+        release(asb);
+        release(dout);
+    }
+
+    if(errors > 0) fprintf(stderr, "lookup: %d inconsistencies\n", errors);
+    return errors > 0;
+}
+
+static int benchGroup(const Options &opt) {
+    unsigned long packets = (opt.count > 0) ? opt.count : 100000;
+    int errors = 0;
+
+    //Group 0x1001 spans two ports, pin 11 inverted, pin 12 belongs to another group
+    static const asbIoDOut table[] = {
+        {8, 0x1001, false, false, ASB_IO_DOUT_DIO},
+        {9, 0x1001, false, false, ASB_IO_DOUT_DIO},
+        {10, 0x1001, false, false, ASB_IO_DOUT_DIO},
+        {11, 0x1001, true, false, ASB_IO_DOUT_DIO},
+        {16, 0x1001, false, false, ASB_IO_DOUT_DIO},
+        {17, 0x1001, false, false, ASB_IO_DOUT_DIO},
+        {12, 0x1002, false, false, ASB_IO_DOUT_DIO},
+    };
+    static const struct {
+        byte level;
+        byte port2;
+        byte port3;
+    } expect[] = {{1, 0x07, 0x03}, {0, 0x08, 0x00}};
+
+    memset(hostPorts, 0, sizeof(hostPorts));
+    ASB *asb = controller(1, 0, 1);
+    ASB_IO_DOUT *dout = module<ASB_IO_DOUT>(2, table, (byte)(sizeof(table) / sizeof(table[0])));
+    if(!asb->hookAttachModule(dout)) {
+        fprintf(stderr, "group: no room for outputs\n");
+        release(asb);
+        release(dout);
+        return 1;
+    }
+
+    asbPacket pkg;
+    pkg.meta.type = ASB_PKGTYPE_MULTICAST;
+    pkg.meta.target = 0x1001;
+    pkg.len = 2;
+    pkg.data[0] = ASB_CMD_1B;
+
+    //One register write per port, no single pins
+    unsigned long pinWrites = 0;
+    for(auto &port : hostPorts) port.pinWrites = 0;
+    hostAtomic = 0;
+    for(auto &step : expect) {
+        pkg.data[1] = step.level;
+        dout->process(pkg);
+        if(hostPorts[2].output != step.port2 || hostPorts[3].output != step.port3) errors++;
+    }
+    for(auto &port : hostPorts) pinWrites += port.pinWrites;
+    if(hostAtomic != 2 * (sizeof(expect) / sizeof(expect[0])) || pinWrites != 0) errors++;
+
+    unsigned long portWrites = hostAtomic;
+    uint64_t start = nanos();
+    for(unsigned long i=0; i<packets; i++) {
+        pkg.data[1] = i & 1;
+        dout->process(pkg);
+    }
+    uint64_t elapsed = nanos() - start;
+
+    printf("outputs,ports,switches,port_writes,pin_writes,process_ns\n6,2,%u,%lu,%lu,%.1f\n", (unsigned int)(sizeof(expect) / sizeof(expect[0])), portWrites, pinWrites, (double)elapsed / packets);
+    release(asb);
+    release(dout);
+
+    if(errors > 0) fprintf(stderr, "group: %d inconsistencies\n", errors);
+    return errors > 0;
+}
+
+/**
+ * Module handling one group target
+ * Without subscribe it keeps the defaults of ASB_IO and receives every packet
+ */
+class BenchModule : public ASB_IO {
+    public:
+        unsigned int target;
+        bool subscribe;
+        unsigned long calls = 0;
+        unsigned long hits = 0;
+
+        BenchModule(unsigned int target, bool subscribe) : target(target), subscribe(subscribe) {}
+
+        bool cfgRead(unsigned int address) { return false; }
+        bool cfgReset(void) { return true; }
+        bool cfgReserve(byte objects) { return true; }
+        bool loop(void) { return true; }
+
+        byte cfgCommands(void) {
+            return subscribe ? ASB_IO_CMD(ASB_CMD_1B) : ASB_IO::cfgCommands();
+        }
+
+        bool cfgTarget(byte n, unsigned int &target) {
+            if(!subscribe) return ASB_IO::cfgTarget(n, target);
+            if(n > 0) return false;
+            target = this->target;
+            return true;
+        }
+
+        bool process(asbPacket &pkg) {
+            calls++;
+            if(pkg.meta.target == target) hits++;
+            return true;
+        }
+};
+
+static int benchDispatch(const Options &opt) {
+    unsigned long packets = (opt.count > 0) ? opt.count : 1000000;
+    const byte modules = 16;
+    int errors = 0;
+
+    printf("modules,dispatch,packets,calls_per_packet,process_ns\n");
+    for(bool subscribe : {false, true}) {
+        uint32_t random = opt.seed | 1;
+        std::vector<BenchModule *> mods;
+        std::vector<unsigned int> targets(1024);
+        unsigned long i, calls = 0, hits = 0, expected = 0;
+        byte m;
+
+        ASB *asb = controller(1, 0, 1);
+        for(m=0; m<modules; m++) {
+            mods.push_back(module<BenchModule>(0x1000 + m, subscribe));
+            asb->hookAttachModule(mods.back());
+        }
+
+        //Half of the packets are meant for groups handled elsewhere
+        for(auto &target : targets) target = 0x1000 + random32(random) % (2 * modules);
+
+        asbPacket pkg;
+        pkg.meta.type = ASB_PKGTYPE_MULTICAST;
+        pkg.len = 2;
+        pkg.data[0] = ASB_CMD_1B;
+        uint64_t start = nanos();
+        for(i=0; i<packets; i++) {
+            pkg.meta.target = targets[i & 1023];
+            pkg.data[1] = i & 1;
+            asb->asbProcess(pkg);
+        }
+        uint64_t elapsed = nanos() - start;
+
+        //No module may miss a packet of its group
+        for(i=0; i<packets; i++) {
+            if(targets[i & 1023] < 0x1000U + modules) expected++;
+        }
+        for(auto mod : mods) {
+            calls += mod->calls;
+            hits += mod->hits;
+        }
+        if(hits != expected || (subscribe && calls != expected)) errors++;
+
+        printf("%u,%s,%lu,%.2f,%.1f\n", modules, subscribe ? "indexed" : "all", packets, (double)calls / packets, (double)elapsed / packets);
+        release(asb);
+        for(auto mod : mods) release(mod);
+    }
+
+    if(errors > 0) fprintf(stderr, "dispatch: %d inconsistencies\n", errors);
+    return errors > 0;
+}
+
+static int benchAin(const Options &opt) {
+    int errors = 0;
+
+    //Averages of 4 readings every 40ms, deadband 5, interval 1s, heartbeat 60s
+    static const asbIoAIn table[] = {
+        {A0, 0x2001, ASB_CMD_S_TEMP, ASB_IO_AIN_MAX, 0, 4, 5, 10, 60},
+    };
+    //Phases are multiples of the averaging time so no average mixes two readings
+    static const struct {
+        const char *name;
+        int value;
+        unsigned long ms;
+        unsigned long sent;
+    } phases[] = {
+        {"first", 500, 400, 1},
+        {"deadband", 503, 10000, 0},
+        {"delta", 600, 200, 1},
+        {"interval", 700, 760, 0},
+        {"late", 700, 400, 1},
+        {"heartbeat", 700, 61000, 1},
+    };
+
+    BenchBus bus;
+    hostTime(0);
+    EEPROM.erase();
+    ASB *asb = controller(0, EEPROM.length() - 1, 1);
+    ASB_IO_AIN *ain = module<ASB_IO_AIN>(3, table, (byte)(sizeof(table) / sizeof(table[0])));
+    asb->busAttach(&bus);
+    if(!asb->hookAttachModule(ain)) {
+        fprintf(stderr, "ain: no room for inputs\n");
+        release(asb);
+        release(ain);
+        return 1;
+    }
+
+    //A second input stored in EEPROM has to fit into one transaction
+    if(!ain->attach(0x2002, A1, ASB_CMD_S_VOLT, 500, 0)) errors++;
+
+    printf("phase,value,ms,sent,expected\n");
+    for(auto &phase : phases) {
+        unsigned long i;
+
+        hostAnalog(A0, phase.value);
+        bus.sent[ASB_CMD_S_TEMP] = 0;
+        for(i=0; i<phase.ms; i+=ASB_IO_AIN_SAMPLE) {
+            delay(ASB_IO_AIN_SAMPLE);
+            ain->loop();
+        }
+        if(bus.sent[ASB_CMD_S_TEMP] != phase.sent) errors++;
+
+        printf("%s,%d,%lu,%lu,%lu\n", phase.name, phase.value, phase.ms, bus.sent[ASB_CMD_S_TEMP], phase.sent);
+    }
+    release(asb);
+    release(ain);
+
+    if(errors > 0) fprintf(stderr, "ain: %d inconsistencies\n", errors);
+    return errors > 0;
+}
+
+/**
+ * Timer callback counting its calls
+ */
+static void benchTimer(void *arg, byte data) {
+    (*(unsigned long *)arg)++;
+}
+
+/**
+ * Timer callback storing the time of its call
+ */
+static void benchTimerAt(void *arg, byte data) {
+    *(unsigned long *)arg = millis();
+}
+
+static int benchTimers(const Options &opt) {
+    unsigned long seconds = (opt.count > 0) ? opt.count : 60;
+    static const unsigned int sizes[] = {100, 250, 500};
+    int errors = 0;
+
+    printf("timers,seconds,calls,loop_ns,late_ms\n");
+    for(unsigned int timers : sizes) {
+        uint32_t random = opt.seed | 1;
+        std::vector<unsigned long> calls(timers), periods(timers);
+        unsigned long i, total = 0, fired = 0;
+        unsigned int t;
+
+        hostTime(0);
+        ASB *asb = controller(1, 0, 1);
+        for(t=0; t<timers; t++) {
+            periods[t] = ASB_TIMER_TICK * (1 + random32(random) % 100);
+            if(asb->timerAttach(periods[t], periods[t], benchTimer, &calls[t], 0) < 0) {
+                fprintf(stderr, "timers: no room for %u timers, build with -DASB_TIMERNUM=512\n", timers);
+                release(asb);
+                return 1;
+            }
+        }
+        asb->timerDetach(timers - 1); //Make room for the long timer
+        calls[timers - 1] = 0;
+
+        //Longer than 65536 wheel turns
+        unsigned long longDelay = 5UL * 3600 * 1000;
+        asb->timerAttach(longDelay, 0, benchTimerAt, &fired, 0);
+
+        //Periods are stored in 16 bit, longer ones must not be shortened silently
+        if(asb->timerAttach(0, (0xFFFFUL + 1) * ASB_TIMER_TICK, benchTimer, &calls[timers - 1], 0) >= 0) errors++;
+
+        //Periodic timers only, loop() once per millisecond
+        uint64_t start = nanos();
+        for(i=0; i<seconds*1000; i++) {
+            delay(1);
+            asb->loop();
+        }
+        uint64_t elapsed = nanos() - start;
+
+        //Every period has been called for the full run
+        for(t=0; t<timers-1; t++) {
+            unsigned long expected = seconds * 1000 / periods[t];
+            if(calls[t] + 1 < expected || calls[t] > expected) errors++;
+            total += calls[t];
+        }
+
+        //Fast forward to the long timer
+        while(fired == 0 && millis() < 2 * longDelay) {
+            delay(1000);
+            asb->loop();
+        }
+        if(fired < longDelay || fired > longDelay + 1000 + ASB_TIMER_TICK) errors++;
+
+        printf("%u,%lu,%lu,%.1f,%ld\n", timers, seconds, total, (double)elapsed / (seconds * 1000), (long)(fired - longDelay));
+        release(asb);
+    }
+
+    if(errors > 0) fprintf(stderr, "timers: %d inconsistencies\n", errors);
+    return errors > 0;
+}
+
+/**
+ * Capture kept in memory
+ */
+class BenchStream : public Stream {
+    public:
+        std::vector<byte> data;
+        size_t pos = 0;
+
+        size_t write(uint8_t c) {
+            data.push_back(c);
+            return 1;
+        }
+
+        int available(void) {
+            return data.size() - pos;
+        }
+
+        int read(void) {
+            return (pos < data.size()) ? data[pos++] : -1;
+        }
+
+        int peek(void) {
+            return (pos < data.size()) ? data[pos] : -1;
+        }
+};
+
+static bool packetEqual(const asbPacket &a, const asbPacket &b) {
+    if(a.meta.type != b.meta.type || a.meta.target != b.meta.target || a.meta.source != b.meta.source) return false;
+    if(a.meta.type == ASB_PKGTYPE_UNICAST && a.meta.port != b.meta.port) return false;
+    return a.len == b.len && memcmp(a.data, b.data, a.len) == 0;
+}
+
+static int benchReplay(const Options &opt) {
+    unsigned long packets = (opt.count > 0) ? opt.count : 1000;
+    static const unsigned int speeds[] = {0, 100};
+    uint32_t random = opt.seed | 1;
+    std::vector<asbPacket> recorded(packets);
+    std::vector<unsigned long> stamps(packets);
+    BenchStream stream;
+    BenchBus bus;
+    unsigned long i;
+    int errors = 0;
+
+    //Sensor values don't trigger answers, so only these packets are recorded
+    hostTime(1000000);
+    ASB *asb = controller(1, 0, 1);
+    asb->busAttach(&bus);
+    ASB_CAPTURE capture(stream);
+    capture.begin();
+    asb->captureAttach(&capture);
+    unsigned long start = micros();
+    for(i=0; i<packets; i++) {
+        asbPacket &pkg = recorded[i];
+        hostTime(micros() + random32(random) % 20000);
+
+        pkg.meta.type = random32(random) % 3;
+        pkg.meta.source = 1;
+        pkg.meta.port = -1;
+        if(pkg.meta.type == ASB_PKGTYPE_UNICAST) {
+            pkg.meta.target = 2 + random32(random) % 0x7FE;
+            pkg.meta.port = random32(random) % 0x20;
+        }else if(pkg.meta.type == ASB_PKGTYPE_MULTICAST) {
+            pkg.meta.target = 1 + random32(random) % 0xFFFF;
+        }else{
+            pkg.meta.target = 0;
+        }
+        pkg.len = 1 + random32(random) % 8;
+        pkg.data[0] = ASB_CMD_S_TEMP;
+        for(byte j=1; j<pkg.len; j++) pkg.data[j] = random32(random);
+
+        asb->asbSend(pkg.meta.type, pkg.meta.target, pkg.meta.source, pkg.meta.port, pkg.len, pkg.data, -1);
+        stamps[i] = (micros() - start) / 1000;
+    }
+    asb->captureAttach(NULL);
+    release(asb);
+    if(capture.packets != packets) errors++;
+
+    //Unicast sets bit 29 of the aSysBus identifier, in SocketCAN that's an error frame
+    for(i=0; i<capture.packets; i++) {
+        byte flags = stream.data[ASB_CAPTURE_HEADER + i * (ASB_CAPTURE_RECORD + ASB_CAPTURE_FRAME) + ASB_CAPTURE_RECORD];
+        if((flags & 0xE0) != 0x80) errors++;
+    }
+
+    printf("speed,packets,replayed,mismatched,early,late_max_ms,replay_ms\n");
+    for(unsigned int speed : speeds) {
+        unsigned long replayed = 0, mismatched = 0, early = 0, late = 0;
+        asbPacket pkg;
+
+        stream.pos = 0;
+        hostTime(5000000);
+        asb = controller(1, 0, 2);
+        ASB_REPLAY replay(stream, speed);
+        if(asb->busAttach(&replay) < 0) errors++;
+
+        unsigned long begin = millis();
+        while(replayed < packets && millis() - begin <= stamps[packets - 1] + 1000) {
+            while(asb->asbReceive(pkg, false)) {
+                unsigned long elapsed = millis() - begin;
+                unsigned long due = (speed == 0) ? 0 : stamps[replayed] - stamps[0];
+
+                if(replayed >= packets || !packetEqual(pkg, recorded[replayed])) mismatched++;
+                if(elapsed < due) {
+                    early++;
+                }else if(elapsed - due > late) {
+                    late = elapsed - due;
+                }
+                replayed++;
+            }
+            delay(1);
+        }
+        unsigned long elapsed = millis() - begin - 1;
+        if(replayed != packets || mismatched > 0 || early > 0 || late > 1 || replay.skipped > 0) errors++;
+
+        printf("%u,%lu,%lu,%lu,%lu,%lu,%lu\n", speed, packets, replayed, mismatched, early, late, elapsed);
+        release(asb);
+    }
+
+    if(errors > 0) fprintf(stderr, "replay: %d inconsistencies\n", errors);
+    return errors > 0;
+}
+
+/**
+ * Queue numbered packets from a thread
+ * @param asb controller
+ * @param producer thread number, part of the packets
+ * @param packets number of packets
+ * @param refused counter of refused packets
+ * @param stop set when the consumer gave up
+ */
+static void queueProducer(ASB *asb, byte producer, unsigned long packets, std::atomic<unsigned long> *refused, std::atomic<bool> *stop) {
+    for(unsigned long n=0; n<packets; n++) {
+        byte data[6] = {ASB_CMD_S_TEMP, producer, (byte)(n >> 24), (byte)(n >> 16), (byte)(n >> 8), (byte)n};
+        while(!asb->asbQueue(ASB_PKGTYPE_MULTICAST, 0x3000 + producer, sizeof(data), data)) {
+            if(*stop) return;
+            (*refused)++;
+            std::this_thread::yield();
+        }
+    }
+}
+
+static int benchQueue(const Options &opt) {
+    unsigned long packets = (opt.count > 0) ? opt.count : 20000;
+    static const byte threads[] = {1, 2, 4, 8};
+    byte data[1] = {ASB_CMD_S_TEMP};
+    unsigned long i;
+    int errors = 0;
+
+    //One ASB::loop() takes out a full queue
+    BenchBus bus;
+    hostTime(0);
+    ASB *asb = controller(1, 0, 1);
+    asb->busAttach(&bus);
+    bus.sent[ASB_CMD_S_TEMP] = 0;
+    for(i=0; i<ASB_QUEUE_SIZE; i++) {
+        if(!asb->asbQueue(ASB_PKGTYPE_MULTICAST, 0x3000, sizeof(data), data)) errors++;
+    }
+    if(asb->asbQueue(ASB_PKGTYPE_MULTICAST, 0x3000, sizeof(data), data)) errors++;
+    asb->loop();
+    if(bus.sent[ASB_CMD_S_TEMP] != ASB_QUEUE_SIZE) errors++;
+    if(!asb->asbQueue(ASB_PKGTYPE_MULTICAST, 0x3000, sizeof(data), data)) errors++;
+    release(asb);
+
+    printf("producers,packets,refused,loops,ns_per_packet\n");
+    for(byte producers : threads) {
+        std::vector<std::thread> running;
+        std::atomic<unsigned long> refused(0);
+        std::atomic<bool> stop(false);
+        std::vector<unsigned long> next(producers, 0);
+        unsigned long loops = 0, total = (unsigned long)producers * packets;
+
+        BenchBus bus;
+        bus.record = true;
+        bus.frames.reserve(total);
+        asb = controller(1, 0, 1);
+        asb->busAttach(&bus);
+        bus.frames.clear();
+
+        uint64_t start = nanos();
+        for(byte p=0; p<producers; p++) running.emplace_back(queueProducer, asb, p, packets, &refused, &stop);
+        while(bus.frames.size() < total && nanos() - start < 60000000000ULL) {
+            asb->loop();
+            loops++;
+            std::this_thread::yield(); //Producers may share our core
+        }
+        stop = true;
+        for(auto &thread : running) thread.join();
+        uint64_t elapsed = nanos() - start;
+
+        //Nothing left behind, lost or out of order
+        asb->loop();
+        if(bus.frames.size() != total) errors++;
+        for(auto &frame : bus.frames) {
+            byte p = frame.data[1];
+            unsigned long n = ((unsigned long)frame.data[2] << 24) | ((unsigned long)frame.data[3] << 16) | ((unsigned int)frame.data[4] << 8) | frame.data[5];
+            if(frame.len != 6 || p >= producers || frame.target != 0x3000U + p || n != next[p]) {
+                errors++;
+                continue;
+            }
+            next[p]++;
+        }
+        for(byte p=0; p<producers; p++) {
+            if(next[p] != packets) errors++;
+        }
+
+        printf("%u,%lu,%lu,%lu,%.1f\n", producers, packets, refused.load(), loops, (double)elapsed / total);
+        release(asb);
+    }
+
+    if(errors > 0) fprintf(stderr, "queue: %d inconsistencies\n", errors);
+    return errors > 0;
+}
+
+/**
+ * Interface counting the traffic it is told about
+ */
+class BenchUtil : public ASB_COMM {
+    public:
+        unsigned long rate = 125000;
+
+        byte begin(void) {
+            return 0;
+        }
+
+        bool asbSend(byte type, unsigned int target, unsigned int source, char port, byte len, const byte *data) {
+            return true;
+        }
+
+        bool asbReceive(asbPacket &pkg) {
+            return false;
+        }
+
+        unsigned long bitrate(void) {
+            return rate;
+        }
+
+        void add(unsigned int bits) {
+            utilAdd(bits);
+        }
+};
+
+static int benchUtil(const Options &opt) {
+    int errors = 0;
+    byte len;
+
+    //Phases are multiples of the 250ms steps of the default window
+    static const struct {
+        const char *name;
+        unsigned int frames;
+        unsigned long ms;
+        byte util;
+    } phases[] = {
+        {"boot", 4, 100, 51},
+        {"half", 4, 2000, 51},
+        {"full", 8, 2000, 100},
+        {"sliding", 0, 500, 43},
+        {"idle", 0, 1000, 0},
+        {"resume", 4, 100, 6},
+    };
+
+    for(len=0; len<=8; len++) {
+        if(ASB_CAN::frameBits(len) != 80 + 10 * len) errors++;
+    }
+
+    BenchUtil bus;
+    hostTime(0);
+    printf("phase,frames,ms,util,expected\n");
+    for(auto &phase : phases) {
+        for(unsigned long t=0; t<phase.ms; t+=10) {
+            delay(10);
+            for(unsigned int i=0; i<phase.frames; i++) bus.add(ASB_CAN::frameBits(8));
+        }
+        byte util = bus.utilization();
+        if(util != phase.util) errors++;
+        printf("%s,%u,%lu,%u,%u\n", phase.name, phase.frames, phase.ms, util, phase.util);
+    }
+
+    //No bitrate, no utilization
+    bus.rate = 0;
+    if(bus.utilization() != 0xFF) errors++;
+    ASB_CAN can(10, CAN_125KBPS, MCP_16MHz, 2);
+    if(can.bitrate() != 125000) errors++;
+    ASB_CAN unknown(10, 0xEE, MCP_16MHz, 2);
+    if(unknown.bitrate() != 0 || unknown.utilization() != 0xFF) errors++;
+
+    if(errors > 0) fprintf(stderr, "util: %d inconsistencies\n", errors);
+    return errors > 0;
+}
+
+/**
+ * Available tests
+ */
+static const struct {
+    const char *name;
+    int (*run)(const Options &opt);
+} tests[] = {
+    {"cfg", benchCfg},
+    {"wear", benchWear},
+    {"crash", benchCrash},
+    {"scan", benchScan},
+    {"din", benchDin},
+    {"gesture", benchGesture},
+    {"fade", benchFade},
+    {"lookup", benchLookup},
+    {"timers", benchTimers},
+    {"group", benchGroup},
+    {"dispatch", benchDispatch},
+    {"ain", benchAin},
+    {"replay", benchReplay},
+    {"queue", benchQueue},
+    {"util", benchUtil},
+};
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s test [-n count] [-S seed]\nTests:", name);
+    for(auto &test : tests) fprintf(stderr, " %s", test.name);
+    fputc('\n', stderr);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    Options opt;
+    int c;
+
+    if(argc < 2) usage(argv[0]);
+    const char *name = argv[1];
+    optind = 2;
+
+    while((c = getopt(argc, argv, "n:S:")) != -1) {
+        switch(c) {
+            case 'n': opt.count = strtoul(optarg, NULL, 0); break;
+            case 'S': opt.seed = strtoul(optarg, NULL, 0); break;
+            default: usage(argv[0]);
+        }
+    }
+
+    for(auto &test : tests) {
+        if(strcmp(test.name, name) == 0) return test.run(opt);
+    }
+    usage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,436 @@
+/**
+  aSysBus capture decoder
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Decodes captured ASB_UART traffic offline
+ *
+ * The capture is memory mapped and searched 16 bytes at a time for the
+ * control characters used by the framing, text between frames (e.g. time
+ * stamps or debug output) is skipped. Values are decoded using the payload
+ * table of asb_sensor.h.
+ *
+ * Build on a POSIX host:
+ *   g++ -O2 -DASB_HOST -I.. -o asbdecode asbdecode.cpp
+ *
+ * Usage:
+ *   asbdecode capture.log > packets.csv
+ *   asbdecode -b -o packets.asbc capture.log
+ *   asbdecode -g 1000000 > capture.log
+ *
+ * CSV columns are offset, type, target, source, port, len, data (hex bytes),
+ * value and unit. The binary format starts with "ASBC", a version byte, 3
+ * padding bytes and the number of packets (uint64), followed by one array
+ * per column in little endian: offset (uint64), type, port, len (uint8),
+ * target, source (uint16) and data (8 bytes per packet).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <vector>
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+
+#include "asb_proto.h"
+#include "asb_sensor.h"
+
+#define ASB_UART_SOH 0x01
+#define ASB_UART_STX 0x02
+#define ASB_UART_EOT 0x04
+#define ASB_UART_US  0x1F
+
+/**
+ * Finds all bytes <= 0x1F, every framing character is one of them
+ */
+class Scanner {
+    private:
+        const uint8_t *_buf;
+        size_t _size;
+        size_t _base;
+        uint32_t _mask;
+
+        uint32_t block(size_t at) {
+            uint32_t mask = 0;
+            #ifdef __SSE2__
+                if(at + 16 <= _size) {
+                    __m128i x = _mm_loadu_si128((const __m128i *)(_buf + at));
+                    __m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(0x1F)), x);
+                    return _mm_movemask_epi8(ctl);
+                }
+            #endif
+            for(size_t i=0; i<16 && at+i < _size; i++) {
+                if(_buf[at+i] <= 0x1F) mask |= 1U << i;
+            }
+            return mask;
+        }
+
+    public:
+        Scanner(const uint8_t *buf, size_t size) : _buf(buf), _size(size), _base(0) {
+            _mask = block(0);
+        }
+
+        /**
+         * Position of the next control character, size if none is left
+         */
+        size_t next(void) {
+            while(_mask == 0) {
+                _base += 16;
+                if(_base >= _size) return _size;
+                _mask = block(_base);
+            }
+            size_t pos = _base + __builtin_ctz(_mask);
+            _mask &= _mask - 1;
+            return pos;
+        }
+};
+
+/**
+ * Decoded packet with its position in the capture
+ */
+struct Frame {
+    uint64_t offset;
+    asbPacket pkg;
+};
+
+static int8_t hexValue[256];
+
+/**
+ * Convert a hex field
+ * @return false if empty, too long or not hex
+ */
+static inline bool hexField(const uint8_t *s, const uint8_t *e, byte digits, uint32_t &value) {
+    if(s >= e || e - s > digits) return false;
+    value = 0;
+    for(; s<e; s++) {
+        int8_t v = hexValue[*s];
+        if(v < 0) return false;
+        value = (value << 4) | v;
+    }
+    return true;
+}
+
+/**
+ * Parse one frame starting at a SOH
+ * @param sc scanner positioned behind the SOH
+ * @param soh position of the SOH
+ * @param end receives the position of the control character ending the frame
+ * @return true if a valid packet was decoded
+ */
+static bool parseFrame(const uint8_t *buf, Scanner &sc, size_t size, size_t soh, Frame &frame, size_t &end) {
+    static const byte maxDigits[5] = {2, 4, 4, 2, 1};
+    static const uint8_t delimiter[5] = {ASB_UART_US, ASB_UART_US, ASB_UART_US, ASB_UART_US, ASB_UART_STX};
+    uint32_t field[5];
+    size_t start = soh + 1, pos;
+    byte i;
+
+    for(i=0; i<5; i++) {
+        pos = end = sc.next();
+        if(pos >= size || buf[pos] != delimiter[i]) return false;
+        if(!hexField(buf + start, buf + pos, maxDigits[i], field[i])) return false;
+        start = pos + 1;
+    }
+    if(field[4] > 8) return false;
+
+    frame.offset = soh;
+    frame.pkg.meta.type = field[0];
+    frame.pkg.meta.target = field[1];
+    frame.pkg.meta.source = field[2];
+    frame.pkg.meta.port = field[3];
+    frame.pkg.len = field[4];
+
+    for(i=0; ; i++) {
+        pos = end = sc.next();
+        if(pos >= size) return false;
+        if(buf[pos] == ASB_UART_EOT) return start == pos && i == field[4];
+        if(buf[pos] != ASB_UART_US || i >= field[4]) return false;
+        if(!hexField(buf + start, buf + pos, 2, field[0])) return false;
+        frame.pkg.data[i] = field[0];
+        start = pos + 1;
+    }
+}
+
+/**
+ * Buffered output with number formatting
+ */
+class Writer {
+    private:
+        FILE *_out;
+        char _buf[1 << 16];
+        size_t _used;
+
+    public:
+        Writer(FILE *out) : _out(out), _used(0) {}
+        ~Writer() { flush(); }
+
+        void flush(void) {
+            if(_used > 0) fwrite(_buf, 1, _used, _out);
+            _used = 0;
+        }
+
+        void reserve(size_t bytes) {
+            if(_used + bytes > sizeof(_buf)) flush();
+        }
+
+        void put(char c) {
+            _buf[_used++] = c;
+        }
+
+        void str(const char *s) {
+            while(*s) _buf[_used++] = *s++;
+        }
+
+        void num(uint64_t v) {
+            char tmp[20];
+            byte n = 0;
+            do {
+                tmp[n++] = '0' + v % 10;
+                v /= 10;
+            }while(v > 0);
+            while(n > 0) _buf[_used++] = tmp[--n];
+        }
+
+        void hex(byte v) {
+            static const char digits[] = "0123456789ABCDEF";
+            _buf[_used++] = digits[v >> 4];
+            _buf[_used++] = digits[v & 0x0F];
+        }
+
+        void value(long v, byte decimals) {
+            uint64_t div = 1;
+            for(byte i=0; i<decimals; i++) div *= 10;
+            if(v < 0) {
+                put('-');
+                v = -v;
+            }
+            num((unsigned long)v / div);
+            if(decimals == 0) return;
+            put('.');
+            uint64_t frac = (unsigned long)v % div;
+            for(div /= 10; div > 0; div /= 10) put('0' + (frac / div) % 10);
+        }
+};
+
+static void writeCsv(Writer &out, const Frame &frame, const asbSensorType *types) {
+    const asbPacket &pkg = frame.pkg;
+    long value;
+
+    out.reserve(128);
+    out.num(frame.offset); out.put(',');
+    out.num(pkg.meta.type); out.put(',');
+    out.num(pkg.meta.target); out.put(',');
+    out.num(pkg.meta.source); out.put(',');
+    out.num((byte)pkg.meta.port); out.put(',');
+    out.num(pkg.len); out.put(',');
+    for(byte i=0; i<(byte)pkg.len; i++) {
+        if(i > 0) out.put(' ');
+        out.hex(pkg.data[i]);
+    }
+    out.put(',');
+    const asbSensorType &info = types[pkg.len > 0 ? pkg.data[0] : 0];
+    if(info.width > 0 && pkg.len == 1 + info.width) {
+        value = asbSensorGet(pkg.data, info.width, info.sign);
+        out.value(value, info.decimals);
+        out.put(',');
+        out.str(info.unit);
+    }else{
+        out.put(',');
+    }
+    out.put('\n');
+}
+
+/**
+ * Columns of the binary format
+ */
+struct Columns {
+    std::vector<uint64_t> offset;
+    std::vector<uint8_t> type, port, len, data;
+    std::vector<uint16_t> target, source;
+
+    void reserve(size_t items) {
+        offset.reserve(items);
+        type.reserve(items);
+        port.reserve(items);
+        len.reserve(items);
+        target.reserve(items);
+        source.reserve(items);
+        data.reserve(items * 8);
+    }
+
+    void add(const Frame &frame) {
+        offset.push_back(frame.offset);
+        type.push_back(frame.pkg.meta.type);
+        port.push_back(frame.pkg.meta.port);
+        len.push_back(frame.pkg.len);
+        target.push_back(frame.pkg.meta.target);
+        source.push_back(frame.pkg.meta.source);
+        data.insert(data.end(), frame.pkg.data, frame.pkg.data + 8);
+    }
+
+    bool write(FILE *out) {
+        const uint8_t header[8] = {'A', 'S', 'B', 'C', 1, 0, 0, 0};
+        uint64_t items = offset.size();
+        bool ok = fwrite(header, 1, 8, out) == 8 && fwrite(&items, 8, 1, out) == 1;
+        if(items == 0) return ok;
+        ok = ok && fwrite(offset.data(), 8, items, out) == items;
+        ok = ok && fwrite(type.data(), 1, items, out) == items;
+        ok = ok && fwrite(port.data(), 1, items, out) == items;
+        ok = ok && fwrite(len.data(), 1, items, out) == items;
+        ok = ok && fwrite(target.data(), 2, items, out) == items;
+        ok = ok && fwrite(source.data(), 2, items, out) == items;
+        ok = ok && fwrite(data.data(), 8, items, out) == items;
+        return ok;
+    }
+};
+
+/**
+ * Write a random capture in the format of ASB_UART::asbSend()
+ */
+static void generate(unsigned long packets, const asbSensorType *types) {
+    static const byte cmds[] = {ASB_CMD_1B, ASB_CMD_PER, ASB_CMD_REQ, ASB_CMD_S_TEMP, ASB_CMD_S_HUM, ASB_CMD_S_LUX, ASB_CMD_S_VOLT};
+    Writer out(stdout);
+    uint32_t seed = 1;
+
+    for(unsigned long n=0; n<packets; n++) {
+        seed = seed * 1103515245 + 12345;
+        byte cmd = cmds[(seed >> 16) % sizeof(cmds)];
+        byte len = 1 + types[cmd].width;
+
+        out.reserve(64);
+        if((seed & 0xFF) == 0) out.str("Debug output\r\n"); //Noise between frames
+        out.put(ASB_UART_SOH);
+        out.str("1");
+        out.put(ASB_UART_US);
+        out.str(n & 1 ? "1001" : "2A");
+        out.put(ASB_UART_US);
+        out.str("123");
+        out.put(ASB_UART_US);
+        out.str("FF");
+        out.put(ASB_UART_US);
+        out.num(len);
+        out.put(ASB_UART_STX);
+        for(byte i=0; i<len; i++) {
+            byte v = i ? (seed >> (8 * (i & 3))) : cmd;
+            //Like Stream::print(x, HEX) there is no leading zero
+            if(v >= 0x10) out.hex(v); else out.put("0123456789ABCDEF"[v]);
+            out.put(ASB_UART_US);
+        }
+        out.put(ASB_UART_EOT);
+        out.str("\r\n");
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *output = NULL;
+    bool binary = false;
+    int opt;
+
+    memset(hexValue, -1, sizeof(hexValue));
+    for(byte i=0; i<10; i++) hexValue['0' + i] = i;
+    for(byte i=0; i<6; i++) hexValue['A' + i] = hexValue['a' + i] = 10 + i;
+
+    //Payload table indexed by command, width 0 = no value
+    static asbSensorType types[256];
+    for(byte i=0; i<asbSensorItems; i++) types[asbSensorTypes[i].cmd] = asbSensorTypes[i];
+
+    while((opt = getopt(argc, argv, "bo:g:")) != -1) {
+        switch(opt) {
+            case 'b': binary = true; break;
+            case 'o': output = optarg; break;
+            case 'g': generate(strtoul(optarg, NULL, 10), types); return 0;
+            default:
+                fprintf(stderr, "Usage: %s [-b] [-o output] capture\n       %s -g packets\n", argv[0], argv[0]);
+                return 2;
+        }
+    }
+    if(optind != argc - 1) {
+        fprintf(stderr, "Usage: %s [-b] [-o output] capture\n       %s -g packets\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    int fd = open(argv[optind], O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0) {
+        perror(argv[optind]);
+        return 1;
+    }
+    size_t size = st.st_size;
+    const uint8_t *buf = NULL;
+    if(size > 0) {
+        #ifdef MAP_POPULATE
+            buf = (const uint8_t *) mmap(NULL, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        #else
+            buf = (const uint8_t *) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        #endif
+        if(buf == MAP_FAILED) {
+            perror("mmap");
+            return 1;
+        }
+        madvise((void *) buf, size, MADV_SEQUENTIAL);
+    }
+
+    FILE *out = output ? fopen(output, "wb") : stdout;
+    if(out == NULL) {
+        perror(output);
+        return 1;
+    }
+
+    Scanner sc(buf, size);
+    Writer csv(out);
+    Columns columns;
+    Frame frame;
+    unsigned long packets = 0, errors = 0;
+    if(binary) columns.reserve(size / 16); //Frames are at least 16 bytes
+    size_t pos = sc.next(), end;
+
+    while(pos < size) {
+        if(buf[pos] != ASB_UART_SOH) {
+            pos = sc.next();
+            continue;
+        }
+        memset(frame.pkg.data, 0, sizeof(frame.pkg.data));
+        if(parseFrame(buf, sc, size, pos, frame, end)) {
+            packets++;
+            if(binary) {
+                columns.add(frame);
+            }else{
+                writeCsv(csv, frame, types);
+            }
+            pos = sc.next();
+        }else{
+            errors++;
+            pos = end; //Might be the SOH of the next frame
+        }
+    }
+
+    csv.flush();
+    if(binary && !columns.write(out)) {
+        perror("write");
+        return 1;
+    }
+    if(out != stdout) fclose(out);
+    fprintf(stderr, "%lu packets, %lu broken frames, %lu bytes\n", packets, errors, (unsigned long) size);
+    return 0;
+}
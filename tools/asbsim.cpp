@@ -0,0 +1,970 @@
+/**
+  aSysBus CAN segment simulator
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Simulates many nodes on one or more CAN segments
+ *
+ * Every node is a complete ASB controller attached to a simulated CAN
+ * interface. All nodes power up together, so the boot announcements are
+ * part of the result. Afterwards each node sends ASB_CMD_S_TEMP values and
+ * ASB_CMD_1B switch events at random (exponential) intervals.
+ *
+ * The bus transmits one frame at a time. Pending frames are arbitrated by
+ * their identifier from ASB_CAN::asbCanAddrAssemble() as it appears on the
+ * wire (29 bit), the frame length is counted from the actual frame bits
+ * including stuffing, CRC and interframe space. Like a MCP2515 every node
+ * has a few transmit and receive buffers, frames which don't fit are
+ * counted as dropped or overrun.
+ *
+ * Time advances in steps of the loop period. Nodes with received packets
+ * run ASB::loop() every step, all other nodes once per millisecond as they
+ * only have timers to run. Latency is the time from ASB::asbSend() until
+ * the frame was transmitted completely.
+ *
+ * All nodes share the Arduino globals of the host platform, so one
+ * scenario runs on a single core. Node counts given as a list are
+ * simulated in parallel processes, one per core unless -j is given.
+ *
+ * Build on a POSIX host:
+ *   g++ -O2 -Ihost -I.. -o asbsim asbsim.cpp host/Arduino.cpp ../asb*.cpp
+ *   g++ -O2 -std=c++20 -DASB_MEMBER_REFRESH=60000 -DASB_CACHENUM=8 -Ihost -I.. -o asbsim asbsim.cpp host/Arduino.cpp ../asb*.cpp
+ *
+ * Usage:
+ *   asbsim -n 50,100,200,400 -j 4
+ *   asbsim -n 100 -s 12 -e 4 -t 120 -v > nodes.csv
+ *   asbsim -n 200 -p 4 -w 1,16 -t 30
+ *   asbsim -n 40,100,200 -g 4 -e 6
+ *   asbsim -n 50,200 -c 1,4,16 -t 10
+ *   asbsim -n 100 -q 8 -s 0 -e 0 -t 5
+ *
+ * Output is CSV with the columns nodes, node, frames, dropped, overruns,
+ * util, util_peak (percent, peak of 100ms windows) and the latency p50,
+ * p99 and max in us. Node 0 is the whole segment, -v adds one line per
+ * node showing its share of the bus.
+ *
+ * -p lets node 1 sweep all other nodes with ASB_PROBE one second after
+ * power up, sending the given number of PINGs to every node with -w PINGs
+ * in flight. This adds the columns window, sweep_ms, found, missing and
+ * the round trip time p50, p99 and max in us, per node with -v.
+ *
+ * -g splits the nodes into segments. The first one is the backbone, every
+ * other segment is connected to it by an additional routing node. Each
+ * node listens to a group of its own, switch events go to a node of the
+ * same segment with the probability given by -L. Built with
+ * -DASB_MEMBER_REFRESH=60000 every scenario runs without and with
+ * ASB_CMD_MEMBER announcements, so the columns segments and members show
+ * how much traffic routers prune. Node 0 sums all
+ * segments, util is their average and util_peak the busiest one.
+ *
+ * -c lets node 1 PING the other nodes one after another from the given
+ * number of coroutines using ASB_CORO, starting one second after power
+ * up. This adds the columns coroutines, requests, failed, req_s and the
+ * round trip time p50, p99 and max in us. Coroutines need C++20, build
+ * with -std=c++20 to use -c.
+ *
+ * -q lets every node ask for the state of SIM_REQUESTS out of the given
+ * number of groups at power up, like inputs and outputs do. Node 1 knows
+ * all groups and answers from its cache, so at most ASB_CACHENUM groups
+ * can be used and -q needs a build with -DASB_CACHENUM. Every scenario
+ * runs with the requests sent at once and queued by ASB::asbRequest().
+ * This adds the columns groups, queued, the number of requests and
+ * answers on the bus and settle_ms, the end of the last of them.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <new>
+#include <deque>
+#include <queue>
+#include <vector>
+
+#include "asb.h"
+
+#define SIM_WINDOW      100000000ULL //Utilization window in ns
+#define SIM_TIMERS      1000000ULL   //Interval of loop() for idle nodes in ns
+#define SIM_BUCKETS     (64 * 8)     //Latency histogram, 8 buckets per power of two
+#define SIM_PROBE       1000000000ULL //Start of the probe sweep in ns, after the boot announcements
+#define SIM_REQUESTS    4            //Groups requested by every node at power up with -q
+#define SIM_GROUPS      0x3000       //First group requested with -q
+
+/**
+ * Scenario parameters
+ */
+struct Scenario {
+    unsigned int nodes;
+    unsigned int kbit = 125;
+    unsigned int seconds = 60;
+    double sensors = 6;     //Values per node and minute
+    double events = 1;      //Switch events per node and minute
+    unsigned int loop = 100; //Loop period in us
+    byte txBuffers = 3;
+    byte rxBuffers = 2;
+    unsigned long seed = 1;
+    bool verbose = false;
+    byte probe = 0;          //PINGs per node, 0 = no sweep
+    byte window = ASB_PROBE_WINDOW;
+    unsigned int segments = 1;
+    double locality = 0.8;   //Share of switch events inside the own segment
+    bool members = true;     //Nodes announce group memberships
+    unsigned int coroutines = 0; //Requests in flight from node 1, 0 = none
+    unsigned int groups = 0; //Groups requested at power up, 0 = none
+    bool queued = true;      //Requests use ASB::asbRequest() instead of sending at once
+};
+
+/**
+ * Distribution of times, 8 classes per power of two
+ */
+class Histogram {
+    public:
+        unsigned long count = 0;
+        uint64_t max = 0;
+        uint32_t buckets[SIM_BUCKETS] = {};
+
+        /**
+         * Add a value
+         * @param ns time in ns
+         */
+        void add(uint64_t ns) {
+            count++;
+            if(ns > max) max = ns;
+            buckets[bucket(ns / 1000)]++;
+        }
+
+        /**
+         * Percentile
+         * @param p fraction, e.g. 0.99
+         * @return uint64_t upper bound of the class in us, never above max
+         */
+        uint64_t percentile(double p) const {
+            unsigned long seen = 0, want = ceil(count * p);
+            if(count == 0) return 0;
+            for(unsigned int i=0; i<SIM_BUCKETS; i++) {
+                seen += buckets[i];
+                if(seen >= want && seen > 0) return (limit(i) < max / 1000) ? limit(i) : max / 1000;
+            }
+            return max / 1000;
+        }
+
+        /**
+         * Add all values of another distribution
+         * @param other distribution
+         */
+        void merge(const Histogram &other) {
+            count += other.count;
+            if(other.max > max) max = other.max;
+            for(unsigned int i=0; i<SIM_BUCKETS; i++) buckets[i] += other.buckets[i];
+        }
+
+    private:
+        static unsigned int bucket(uint64_t us) {
+            if(us < 8) return us;
+            unsigned int exp = 63 - __builtin_clzll(us);
+            return (exp - 2) * 8 + ((us >> (exp - 3)) & 7);
+        }
+
+        static uint64_t limit(unsigned int bucket) {
+            if(bucket < 8) return bucket;
+            unsigned int exp = bucket / 8 + 2;
+            return ((uint64_t)(8 + bucket % 8 + 1) << (exp - 3)) - 1;
+        }
+};
+
+/**
+ * Counters and latency distribution of a node or the whole segment
+ */
+class Stats {
+    public:
+        unsigned long dropped = 0;
+        unsigned long overruns = 0;
+        uint64_t busy = 0;
+        uint64_t peak = 0;
+        Histogram latency;
+
+        /**
+         * Round trip times measured by the probe or requests
+         */
+        Histogram rtt;
+
+        /**
+         * Requests without answer
+         */
+        unsigned long failed = 0;
+
+        /**
+         * ASB_CMD_REQ frames and their answers for the power up groups
+         */
+        unsigned long requests = 0;
+        unsigned long answers = 0;
+
+        /**
+         * End of the last request or answer in ns
+         */
+        uint64_t settled = 0;
+
+        /**
+         * Count a transmitted frame
+         * @param end end of the frame in ns
+         * @param duration length of the frame in ns
+         * @param queued time since the frame was queued in ns
+         */
+        void frame(uint64_t end, uint64_t duration, uint64_t queued) {
+            uint64_t window = end / SIM_WINDOW;
+            uint64_t part = end - window * SIM_WINDOW;
+            if(part > duration) part = duration;
+            if(window != _window) {
+                //Frame started in the previous window
+                if(window == _window + 1) count(duration - part);
+                _window = window;
+                _windowBusy = 0;
+            }else{
+                part = duration;
+            }
+            count(part);
+
+            busy += duration;
+            latency.add(queued);
+        }
+
+        /**
+         * Add the frames of another segment, peak is the busiest one
+         * @param other counters of the segment
+         */
+        void merge(const Stats &other) {
+            dropped += other.dropped;
+            overruns += other.overruns;
+            busy += other.busy;
+            if(other.peak > peak) peak = other.peak;
+            latency.merge(other.latency);
+            requests += other.requests;
+            answers += other.answers;
+            if(other.settled > settled) settled = other.settled;
+        }
+
+    private:
+        uint64_t _window = 0;
+        uint64_t _windowBusy = 0;
+
+        void count(uint64_t busy) {
+            _windowBusy += busy;
+            if(_windowBusy > peak) peak = _windowBusy;
+        }
+};
+
+/**
+ * Number of bits on the wire for an extended data frame
+ * @param id 29 bit identifier
+ * @param len number of data bytes
+ * @param data data bytes
+ * @return unsigned int bits including stuffing and interframe space
+ */
+static unsigned int frameBits(uint32_t id, byte len, const byte *data) {
+    byte bits[1 + 32 + 6 + 64 + 15];
+    unsigned int n = 0, i;
+    int b;
+
+    bits[n++] = 0; //SOF
+    for(b=28; b>=18; b--) bits[n++] = (id >> b) & 1;
+    bits[n++] = 1; //SRR
+    bits[n++] = 1; //IDE
+    for(b=17; b>=0; b--) bits[n++] = (id >> b) & 1;
+    bits[n++] = 0; //RTR
+    bits[n++] = 0; //r1
+    bits[n++] = 0; //r0
+    for(b=3; b>=0; b--) bits[n++] = (len >> b) & 1;
+    for(i=0; i<len; i++) {
+        for(b=7; b>=0; b--) bits[n++] = (data[i] >> b) & 1;
+    }
+
+    uint16_t crc = 0;
+    for(i=0; i<n; i++) {
+        bool next = bits[i] ^ ((crc >> 14) & 1);
+        crc = (crc << 1) & 0x7FFF;
+        if(next) crc ^= 0x4599;
+    }
+    for(b=14; b>=0; b--) bits[n++] = (crc >> b) & 1;
+
+    //A stuff bit follows 5 equal bits and starts the next run itself
+    unsigned int stuffed = 0, run = 1;
+    byte last = bits[0];
+    for(i=1; i<n; i++) {
+        if(bits[i] == last) {
+            run++;
+        }else{
+            last = bits[i];
+            run = 1;
+        }
+        if(run == 5) {
+            stuffed++;
+            last = !last;
+            run = 1;
+        }
+    }
+
+    return n + stuffed + 1 + 2 + 7 + 3; //CRC delimiter, ACK, EOF, IFS
+}
+
+class SimBus;
+
+/**
+ * Frame waiting in a transmit buffer
+ */
+struct SimFrame {
+    uint32_t id;
+    uint64_t queued;
+    asbPacket pkg;
+};
+
+/**
+ * CAN interface of a simulated node
+ */
+class SimCan : public ASB_COMM {
+    public:
+        SimBus *bus;
+        unsigned int node;
+        std::deque<SimFrame> tx;
+        std::deque<asbPacket> rx;
+        Stats stats;
+
+        byte begin(void) {
+            return 0;
+        }
+
+        bool asbSend(byte type, unsigned int target, unsigned int source, char port, byte len, const byte *data);
+
+        bool asbReceive(asbPacket &pkg) {
+            if(rx.empty()) return false;
+            pkg = rx.front();
+            rx.pop_front();
+            return true;
+        }
+};
+
+/**
+ * Simulated node, routers are also attached to the backbone
+ */
+struct SimNode {
+    ASB *asb;
+    SimCan can;
+    SimCan uplink;
+    uint32_t random;
+
+    bool idle(void) const {
+        return can.rx.empty() && uplink.rx.empty();
+    }
+};
+
+/**
+ * All segments and nodes of a scenario
+ */
+class SimNet {
+    public:
+        const Scenario &scenario;
+        std::vector<SimNode> nodes;
+        std::deque<SimBus> segments;
+        std::vector<unsigned int> pending; //Nodes with received packets
+        uint64_t now = 0;
+        Stats stats;
+
+        SimNet(const Scenario &s) : scenario(s), nodes(s.nodes + s.segments - 1) {}
+
+        /**
+         * First node of a segment, nodes are split evenly
+         * @param segment segment number
+         * @return unsigned int node index
+         */
+        unsigned int first(unsigned int segment) const {
+            return (segment * scenario.nodes + scenario.segments - 1) / scenario.segments;
+        }
+};
+
+/**
+ * Shared CAN segment
+ */
+class SimBus {
+    public:
+        SimNet &net;
+        std::vector<SimCan *> cans;
+        Stats stats;
+
+        SimBus(SimNet &n) : net(n) {
+            _bitTime = 1000000ULL / n.scenario.kbit;
+        }
+
+        /**
+         * Connect an interface
+         * @param can interface of a node
+         */
+        void attach(SimCan *can) {
+            can->bus = this;
+            cans.push_back(can);
+        }
+
+        /**
+         * Transmit frames until the given time
+         * @param until end of the step in ns
+         */
+        void run(uint64_t until) {
+            for(;;) {
+                if(_active != NULL) {
+                    if(_end > until) return;
+                    deliver();
+                }
+
+                SimCan *winner = NULL;
+                size_t slot = 0;
+                uint32_t best = 0xFFFFFFFF;
+                for(SimCan *can : cans) {
+                    for(size_t j=0; j<can->tx.size(); j++) {
+                        if(can->tx[j].id < best) {
+                            best = can->tx[j].id;
+                            winner = can;
+                            slot = j;
+                        }
+                    }
+                }
+                if(winner == NULL) return;
+
+                _frame = winner->tx[slot];
+                winner->tx.erase(winner->tx.begin() + slot);
+                _active = winner;
+                _start = (_idle > net.now) ? _idle : net.now;
+                _end = _start + frameBits(_frame.id, _frame.pkg.len, _frame.pkg.data) * _bitTime;
+            }
+        }
+
+    private:
+        uint64_t _bitTime;
+        uint64_t _idle = 0;
+        uint64_t _start = 0;
+        uint64_t _end = 0;
+        SimCan *_active = NULL;
+        SimFrame _frame;
+
+        void deliver(void) {
+            uint64_t duration = _end - _start;
+            uint64_t latency = _end - _frame.queued;
+
+            stats.frame(_end, duration, latency);
+            _active->stats.frame(_end, duration, latency);
+
+            const asbPacket &pkg = _frame.pkg;
+            if(pkg.meta.type == ASB_PKGTYPE_MULTICAST && pkg.meta.target >= SIM_GROUPS && pkg.meta.target < SIM_GROUPS + net.scenario.groups && pkg.len > 0) {
+                if(pkg.data[0] == ASB_CMD_REQ) {
+                    stats.requests++;
+                }else{
+                    stats.answers++;
+                }
+                stats.settled = _end;
+            }
+
+            for(SimCan *can : cans) {
+                if(can == _active) continue;
+                if(can->rx.size() >= net.scenario.rxBuffers) {
+                    can->stats.overruns++;
+                    continue;
+                }
+                if(net.nodes[can->node - 1].idle()) net.pending.push_back(can->node - 1);
+                can->rx.push_back(_frame.pkg);
+            }
+
+            _idle = _end;
+            _active = NULL;
+        }
+};
+
+bool SimCan::asbSend(byte type, unsigned int target, unsigned int source, char port, byte len, const byte *data) {
+    unsigned long id = ASB_CAN::asbCanAddrAssemble(type, target, source, port);
+    if(id == 0 || len > 8) return false;
+
+    //Older firmware doesn't announce memberships
+    if(!bus->net.scenario.members && len > 0 && data[0] == ASB_CMD_MEMBER) return true;
+
+    if(tx.size() >= bus->net.scenario.txBuffers) {
+        stats.dropped++;
+        return false;
+    }
+
+    SimFrame frame;
+    frame.id = id & 0x1FFFFFFF; //The controller only transmits 29 bits
+    frame.queued = bus->net.now;
+    frame.pkg.meta.type = type;
+    frame.pkg.meta.target = target;
+    frame.pkg.meta.source = source;
+    frame.pkg.meta.port = port;
+    frame.pkg.len = len;
+    memcpy(frame.pkg.data, data, len);
+    tx.push_back(frame);
+    return true;
+}
+
+/**
+ * Random numbers of a node, xorshift32
+ */
+static double uniform(uint32_t &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (state + 1.0) / 4294967297.0;
+}
+
+/**
+ * Time until the next event in ns
+ * @param state random state
+ * @param perMinute average events per minute
+ */
+static uint64_t interval(uint32_t &state, double perMinute) {
+    return -log(uniform(state)) * 60e9 / perMinute;
+}
+
+/**
+ * Pending traffic, earliest first
+ */
+struct SimEvent {
+    uint64_t time;
+    unsigned int node;
+    bool sensor;
+
+    bool operator<(const SimEvent &other) const {
+        return time > other.time;
+    }
+};
+
+static void printStats(FILE *out, const Scenario &s, unsigned int node, const Stats &stats, long sweep, unsigned int found, unsigned int missing) {
+    //The whole network is busy for the time of all segments
+    unsigned int segments = (node == 0) ? s.segments : 1;
+
+    fprintf(out, "%u,%u,%lu,%lu,%lu,%.2f,%.2f,%llu,%llu,%llu", s.nodes, node,
+        stats.latency.count, stats.dropped, stats.overruns,
+        100.0 * stats.busy / (s.seconds * 1e9 * segments), 100.0 * stats.peak / SIM_WINDOW,
+        (unsigned long long)stats.latency.percentile(0.5), (unsigned long long)stats.latency.percentile(0.99),
+        (unsigned long long)(stats.latency.max / 1000));
+    if(s.segments > 1) {
+        fprintf(out, ",%u,%d", s.segments, s.members);
+    }
+    if(s.probe > 0) {
+        fprintf(out, ",%u,%ld,%u,%u,%llu,%llu,%llu", s.window, sweep, found, missing,
+            (unsigned long long)stats.rtt.percentile(0.5), (unsigned long long)stats.rtt.percentile(0.99),
+            (unsigned long long)(stats.rtt.max / 1000));
+    }
+    if(s.groups > 0) {
+        fprintf(out, ",%u,%d,%lu,%lu,%llu", s.groups, s.queued, stats.requests, stats.answers, (unsigned long long)(stats.settled / 1000000));
+    }
+    if(s.coroutines > 0) {
+        fprintf(out, ",%u,%lu,%lu,%.1f,%llu,%llu,%llu", s.coroutines, stats.rtt.count, stats.failed,
+            stats.rtt.count * 1e9 / (s.seconds * 1e9 - SIM_PROBE),
+            (unsigned long long)stats.rtt.percentile(0.5), (unsigned long long)stats.rtt.percentile(0.99),
+            (unsigned long long)(stats.rtt.max / 1000));
+    }
+    fputc('\n', out);
+}
+
+/**
+ * Scenario receiving probe results, each process runs one at a time
+ */
+static SimNet *probeNet;
+
+static void probeResult(unsigned int node, unsigned long rtt) {
+    if(rtt == ASB_PROBE_MISSING || node < 1 || node > probeNet->nodes.size()) return;
+    probeNet->stats.rtt.add(rtt * 1000ULL);
+    probeNet->nodes[node - 1].can.stats.rtt.add(rtt * 1000ULL);
+}
+
+#ifdef __cpp_impl_coroutine
+/**
+ * Requests end once set
+ */
+static bool requestsStop;
+
+/**
+ * PING other nodes one after another like a gateway polling them
+ * @param coro request module of node 1
+ * @param net network
+ * @param k number of this coroutine
+ */
+static asbTask requests(ASB_CORO &coro, SimNet &net, unsigned int k) {
+    unsigned int others = net.nodes.size() - 1;
+    unsigned int i = k % others;
+    byte ping[1] = {ASB_CMD_PING};
+
+    while(!requestsStop) {
+        unsigned int node = 2 + i;
+        i = (i + net.scenario.coroutines) % others;
+
+        //Ports spread the requests, the module matches answers by node and port anyway
+        asbReply reply = co_await coro.request(node, 1 + k % 31, sizeof(ping), ping, ASB_PROBE_TIMEOUT);
+        if(requestsStop) break;
+
+        if(reply.valid) {
+            net.stats.rtt.add(reply.rtt * 1000ULL);
+            net.nodes[node - 1].can.stats.rtt.add(reply.rtt * 1000ULL);
+        }else{
+            net.stats.failed++;
+            net.nodes[node - 1].can.stats.failed++;
+        }
+    }
+}
+#endif
+
+/**
+ * Switch events of other nodes, only used for their membership
+ */
+static void listen(asbPacket &pkg) {
+}
+
+static void simulate(const Scenario &s, FILE *out) {
+    SimNet net(s);
+    std::priority_queue<SimEvent> traffic;
+    unsigned int i, k;
+
+    for(k=0; k<s.segments; k++) net.segments.emplace_back(net);
+
+    hostTime(0);
+    for(i=0; i<net.nodes.size(); i++) {
+        SimNode &node = net.nodes[i];
+        node.can.node = i + 1;
+        node.uplink.node = i + 1;
+        node.random = (s.seed * 2654435761UL) ^ ((i + 1) * 40503UL) ^ 0x9E3779B9;
+        if(node.random == 0) node.random = 1;
+
+        //Members without initializer rely on zeroed memory like globals on the target
+        void *mem = calloc(1, sizeof(ASB));
+        node.asb = new(mem) ASB(i + 1);
+
+        if(i < s.nodes) {
+            //Every node switches something, e.g. a light
+            node.asb->hookAttach(ASB_PKGTYPE_MULTICAST, 0x2000 + i, -1, ASB_CMD_1B, listen);
+            for(k=s.segments-1; net.first(k) > i; k--);
+            net.segments[k].attach(&node.can);
+            node.asb->busAttach(&node.can);
+
+            if(s.groups > 0 && i == 0) {
+                //Node 1 knows all groups and answers requests
+                node.asb->cachePolicy(ASB_CACHE_ALWAYS);
+                for(k=0; k<s.groups; k++) {
+                    asbPacket pkg;
+                    pkg.meta.type = ASB_PKGTYPE_MULTICAST;
+                    pkg.meta.target = SIM_GROUPS + k;
+                    pkg.len = 2;
+                    pkg.data[0] = ASB_CMD_1B;
+                    pkg.data[1] = k & 1;
+                    node.asb->asbProcess(pkg);
+                }
+            }else if(s.groups > 0) {
+                //Inputs and outputs ask for the state of their groups
+                for(k=0; k<SIM_REQUESTS; k++) {
+                    unsigned int target = SIM_GROUPS + (unsigned int)(uniform(node.random) * s.groups);
+                    if(s.queued) {
+                        node.asb->asbRequest(target);
+                    }else{
+                        byte data[1] = {ASB_CMD_REQ};
+                        node.asb->asbSend(ASB_PKGTYPE_MULTICAST, target, sizeof(data), data);
+                    }
+                }
+            }
+
+            if(s.sensors > 0) traffic.push({interval(node.random, s.sensors), i, true});
+            if(s.events > 0) traffic.push({interval(node.random, s.events), i, false});
+        }else{
+            //Router between the backbone and another segment
+            net.segments[0].attach(&node.uplink);
+            node.asb->busAttach(&node.uplink);
+            net.segments[i - s.nodes + 1].attach(&node.can);
+            node.asb->busAttach(&node.can);
+        }
+    }
+
+    //Node 1 sweeps all nodes like a gateway would
+    ASB_PROBE *probe = NULL;
+    long sweep = -1;
+    if(s.probe > 0) {
+        probe = new(calloc(1, sizeof(ASB_PROBE))) ASB_PROBE(15);
+        probe->window = s.window;
+        probe->resultHook(probeResult);
+        probeNet = &net;
+        net.nodes[0].asb->hookAttachModule(probe);
+    }
+
+    //Node 1 keeps the given number of requests in flight
+    ASB_IO *gateway = probe;
+#ifdef __cpp_impl_coroutine
+    ASB_CORO *coro = NULL;
+    if(s.coroutines > 0) {
+        coro = new(calloc(1, sizeof(ASB_CORO))) ASB_CORO(14);
+        net.nodes[0].asb->hookAttachModule(coro);
+        requestsStop = false;
+        gateway = coro;
+    }
+#endif
+
+    uint64_t step = s.loop * 1000ULL;
+    uint64_t end = s.seconds * 1000000000ULL;
+    uint64_t timers = 0;
+    std::vector<unsigned int> ready;
+
+    for(net.now = 0; net.now < end; net.now += step) {
+        hostTime(net.now / 1000);
+
+        if(probe != NULL && net.now >= SIM_PROBE) {
+            if(sweep < 0 && !probe->busy()) {
+                probe->start(0x001, net.nodes.size(), s.probe);
+                sweep = 0;
+            }else if(sweep == 0 && !probe->busy()) {
+                sweep = (net.now - SIM_PROBE) / 1000000;
+            }
+        }
+#ifdef __cpp_impl_coroutine
+        if(coro != NULL && net.now >= SIM_PROBE && net.now < SIM_PROBE + step) {
+            for(k=0; k<s.coroutines; k++) requests(*coro, net, k);
+        }
+#endif
+
+        //Traffic generated by the sketches
+        while(!traffic.empty() && traffic.top().time <= net.now) {
+            SimEvent event = traffic.top();
+            traffic.pop();
+            SimNode &node = net.nodes[event.node];
+            if(event.sensor) {
+                byte data[1 + asbSensor<ASB_CMD_S_TEMP>::width];
+                asbSensorEncode<ASB_CMD_S_TEMP>(data, 150 + (long)(uniform(node.random) * 100));
+                node.asb->asbSend(ASB_PKGTYPE_MULTICAST, 0x1000 + event.node + 1, sizeof(data), data);
+                event.time += interval(node.random, s.sensors);
+            }else{
+                //Switch a node of our own segment or, less often, anywhere
+                unsigned int first = 0, count = s.nodes;
+                if(uniform(node.random) < s.locality) {
+                    for(k=s.segments-1; net.first(k) > event.node; k--);
+                    first = net.first(k);
+                    count = net.first(k + 1) - first;
+                }
+                unsigned int other = first + (unsigned int)(uniform(node.random) * count);
+                byte data[2] = {ASB_CMD_1B, (byte)(uniform(node.random) < 0.5)};
+                node.asb->asbSend(ASB_PKGTYPE_MULTICAST, 0x2000 + other, sizeof(data), data);
+                event.time += interval(node.random, s.events);
+            }
+            traffic.push(event);
+        }
+
+        if(net.now >= timers) {
+            timers += SIM_TIMERS;
+            net.pending.clear();
+            for(i=0; i<net.nodes.size(); i++) net.nodes[i].asb->loop();
+            for(i=0; i<net.nodes.size(); i++) {
+                if(!net.nodes[i].idle()) net.pending.push_back(i);
+            }
+        }else{
+            ready.swap(net.pending);
+            net.pending.clear();
+            if(gateway != NULL && net.nodes[0].idle()) ready.push_back(0); //Gateway runs every loop
+            for(i=0; i<ready.size(); i++) {
+                SimNode &node = net.nodes[ready[i]];
+                node.asb->loop();
+                if(!node.idle()) net.pending.push_back(ready[i]);
+            }
+        }
+
+        for(SimBus &bus : net.segments) bus.run(net.now + step);
+    }
+
+    for(SimBus &bus : net.segments) net.stats.merge(bus.stats);
+    for(i=0; i<net.nodes.size(); i++) {
+        net.stats.dropped += net.nodes[i].can.stats.dropped + net.nodes[i].uplink.stats.dropped;
+        net.stats.overruns += net.nodes[i].can.stats.overruns + net.nodes[i].uplink.stats.overruns;
+    }
+    if(probe != NULL && sweep <= 0) fprintf(stderr, "Sweep of %u nodes did not finish, increase -t\n", s.nodes);
+    printStats(out, s, 0, net.stats, sweep, (probe != NULL) ? probe->found : 0, (probe != NULL) ? probe->missing : 0);
+
+    if(s.verbose) {
+        for(i=0; i<net.nodes.size(); i++) {
+            const Stats &stats = net.nodes[i].can.stats;
+            printStats(out, s, i + 1, stats, sweep, stats.rtt.count > 0, i > 0 && stats.rtt.count == 0);
+        }
+    }
+
+#ifdef __cpp_impl_coroutine
+    if(coro != NULL) {
+        //Failing the requests in flight ends all coroutines
+        requestsStop = true;
+        net.nodes[0].asb->hookDetachModule(14);
+        coro->~ASB_CORO();
+        free(coro);
+    }
+#endif
+    for(i=0; i<net.nodes.size(); i++) {
+        net.nodes[i].asb->~ASB();
+        free(net.nodes[i].asb);
+    }
+    if(probe != NULL) {
+        probe->~ASB_PROBE();
+        free(probe);
+    }
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-n nodes[,nodes...]] [-k kbit/s] [-t seconds] [-s values/min] [-e events/min]\n"
+                    "       [-l loop us] [-x tx buffers] [-r rx buffers] [-S seed] [-j jobs] [-v]\n"
+                    "       [-p pings/node [-w in flight[,in flight...]]] [-c coroutines[,coroutines...]]\n"
+                    "       [-g segments [-L locality]] [-q groups]\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    Scenario base;
+    std::vector<unsigned int> counts, windows, coroutines;
+    std::vector<Scenario> scenarios;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int jobs = (cpus > 0) ? cpus : 1;
+    int opt;
+    char *list, *item;
+
+    while((opt = getopt(argc, argv, "n:k:t:s:e:l:x:r:S:j:vp:w:c:g:L:q:")) != -1) {
+        switch(opt) {
+            case 'n':
+                list = optarg;
+                while((item = strtok(list, ",")) != NULL) {
+                    counts.push_back(strtoul(item, NULL, 0));
+                    list = NULL;
+                }
+                break;
+            case 'k': base.kbit = strtoul(optarg, NULL, 0); break;
+            case 't': base.seconds = strtoul(optarg, NULL, 0); break;
+            case 's': base.sensors = atof(optarg); break;
+            case 'e': base.events = atof(optarg); break;
+            case 'l': base.loop = strtoul(optarg, NULL, 0); break;
+            case 'x': base.txBuffers = strtoul(optarg, NULL, 0); break;
+            case 'r': base.rxBuffers = strtoul(optarg, NULL, 0); break;
+            case 'S': base.seed = strtoul(optarg, NULL, 0); break;
+            case 'j': jobs = strtoul(optarg, NULL, 0); break;
+            case 'v': base.verbose = true; break;
+            case 'g': base.segments = strtoul(optarg, NULL, 0); break;
+            case 'L': base.locality = atof(optarg); break;
+            case 'q': base.groups = strtoul(optarg, NULL, 0); break;
+            case 'p': base.probe = strtoul(optarg, NULL, 0); break;
+            case 'w':
+                list = optarg;
+                while((item = strtok(list, ",")) != NULL) {
+                    windows.push_back(strtoul(item, NULL, 0));
+                    list = NULL;
+                }
+                break;
+            case 'c':
+                list = optarg;
+                while((item = strtok(list, ",")) != NULL) {
+                    coroutines.push_back(strtoul(item, NULL, 0));
+                    if(coroutines.back() == 0) usage(argv[0]);
+                    list = NULL;
+                }
+                break;
+            default: usage(argv[0]);
+        }
+    }
+    if(counts.empty()) counts.push_back(100);
+    if(base.kbit == 0 || base.kbit > 1000 || base.loop == 0 || base.txBuffers == 0 || base.rxBuffers == 0 || jobs == 0) usage(argv[0]);
+    if(base.segments < 1 || base.locality < 0 || base.locality > 1) usage(argv[0]);
+    if(base.groups > ASB_CACHENUM) usage(argv[0]); //Node 1 has to know all of them
+    if(windows.empty()) windows.push_back(ASB_PROBE_WINDOW);
+#ifndef __cpp_impl_coroutine
+    if(!coroutines.empty()) {
+        fprintf(stderr, "-c needs a build with -std=c++20\n");
+        usage(argv[0]);
+    }
+#endif
+    if(!coroutines.empty() && base.probe > 0) usage(argv[0]); //Both run on node 1
+    if(coroutines.empty()) coroutines.push_back(0);
+    for(unsigned int c : counts) {
+        if(c < base.segments || c + base.segments - 1 > 0x7FF) usage(argv[0]);
+        for(unsigned int w : windows) {
+            if(w < 1 || w > ASB_PROBE_SLOTS) usage(argv[0]);
+            for(unsigned int r : coroutines) {
+                if(r > 0 && c < 2) usage(argv[0]);
+                //Routed segments run with and without membership announcements if built in
+                int announce = (ASB_MEMBER_REFRESH > 0) ? 1 : 0;
+                for(int m=(base.segments > 1) ? 0 : announce; m<=announce; m++) {
+                    //Power up requests are sent at once and queued
+                    for(int q=(base.groups > 0) ? 0 : 1; q<=1; q++) {
+                        Scenario s = base;
+                        s.nodes = c;
+                        s.window = w;
+                        s.members = m;
+                        s.coroutines = r;
+                        s.queued = q;
+                        scenarios.push_back(s);
+                    }
+                }
+            }
+            if(base.probe == 0) break; //Window only matters for sweeps
+        }
+    }
+
+    printf("nodes,node,frames,dropped,overruns,util,util_peak,p50_us,p99_us,max_us%s%s%s%s\n",
+        (base.segments > 1) ? ",segments,members" : "",
+        (base.probe > 0) ? ",window,sweep_ms,found,missing,rtt_p50_us,rtt_p99_us,rtt_max_us" : "",
+        (base.groups > 0) ? ",groups,queued,requests,answers,settle_ms" : "",
+        (coroutines[0] > 0) ? ",coroutines,requests,failed,req_s,rtt_p50_us,rtt_p99_us,rtt_max_us" : "");
+    fflush(stdout);
+
+    //Scenarios run in child processes writing to their own file, output keeps the order of -n, -w and -c
+    std::vector<FILE *> results(scenarios.size());
+    unsigned int started = 0, running = 0;
+    while(started < scenarios.size() || running > 0) {
+        if(started < scenarios.size() && running < jobs) {
+            const Scenario &s = scenarios[started];
+            results[started] = tmpfile();
+            if(results[started] == NULL) {
+                perror("tmpfile");
+                return 1;
+            }
+            if(jobs == 1) {
+                simulate(s, results[started]);
+            }else{
+                pid_t pid = fork();
+                if(pid < 0) {
+                    perror("fork");
+                    return 1;
+                }
+                if(pid == 0) {
+                    simulate(s, results[started]);
+                    fclose(results[started]);
+                    _exit(0);
+                }
+                running++;
+            }
+            started++;
+            continue;
+        }
+
+        int status;
+        if(wait(&status) <= 0) break;
+        running--;
+        if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) fprintf(stderr, "Scenario failed\n");
+    }
+
+    char buf[4096];
+    size_t n;
+    for(FILE *f : results) {
+        rewind(f);
+        while((n = fread(buf, 1, sizeof(buf), f)) > 0) fwrite(buf, 1, n, stdout);
+        fclose(f);
+    }
+    return 0;
+}
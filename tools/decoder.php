@@ -147,6 +147,12 @@
         return 'PING request';
       case 0x71:
         return 'PONG (PING response)';
+      case 0x72:
+        if(count($data) == 1) return 'Bus utilization request';
+        return 'Bus utilization is '.implode(', ', array_map(function($x) { return ($x <= 100) ? $x.'%' : '-'; }, array_slice($data, 1)));
+      case 0x73:
+        if(count($data) == 1) return 'Member of every group';
+        return 'Member of groups in '.array_sum(array_map(function($x) { return substr_count(decbin($x), '1'); }, array_slice($data, 1))).' hash bits';
       case 0x80:
         return 'Request to read configuration register 0x'.sprintf('%02X', asbPkgDecodeArrToUnsignedInt($data[1], $data[2]));
       case 0x81:
@@ -170,11 +176,11 @@
       //case 0xB0:
       //case 0xB1:
       case 0xC0:
-        return 'Voltage is '.(asbPkgDecodeArrToUnsignedInt($data[1], $data[2])/10).'V';
+        return 'Voltage is '.(asbPkgDecodeArrToSignedInt($data[1], $data[2])/100).'V';
       case 0xC1:
-        return 'Ampere is '.(asbPkgDecodeArrToUnsignedInt($data[1], $data[2])/10).'A';
+        return 'Ampere is '.(asbPkgDecodeArrToSignedInt($data[1], $data[2])/100).'A';
       case 0xC2:
-        return 'Power is '.(asbPkgDecodeArrToUnsignedInt($data[1], $data[2])/10).'VA';
+        return 'Power is '.(asbPkgDecodeArrToSignedLong($data[1], $data[2], $data[3], $data[4])/10).'VA';
       case 0xD0:
         return 'percental sensor is '.$data[1].'%';
       case 0xD1:
@@ -199,7 +205,7 @@
   }
 
   function asbPkgDecodeArrToUnsignedInt($a1, $a2) {
-    return (($a1<<8) & $a2);
+    return (($a1<<8) | $a2);
   }
   function asbPkgDecodeArrToSignedInt($a1, $a2) {
     $int = asbPkgDecodeArrToUnsignedInt($a1, $a2);
@@ -208,7 +214,7 @@
     return $int;
   }
   function asbPkgDecodeArrToUnsignedLong($a1, $a2, $a3, $a4) {
-    return (($a1<<24) & ($a2<<16) & ($a3<<8) & $a4);
+    return (($a1<<24) | ($a2<<16) | ($a3<<8) | $a4);
   }
   function asbPkgDecodeArrToSignedLong($a1, $a2, $a3, $a4) {
     $int = asbPkgDecodeArrToUnsignedLong($a1, $a2, $a3, $a4);
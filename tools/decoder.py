@@ -69,22 +69,22 @@ def asbPkgDecode(line):
     return pkg
 
 def asbPkgDecodeArrToUnsignedInt(a1, a2):
-    return int((a1<<8) & a2)
+    return int((a1<<8) | a2)
 
 def asbPkgDecodeArrToSignedInt(a1, a2):
     aint = asbPkgDecodeArrToUnsignedInt(a1, a2)
-    if aint > pow(2,15):
-        aint = 1-(aint-pow(2,15))
+    if aint >= pow(2,15):
+        aint = aint-pow(2,16)
 
     return aint
 
 def asbPkgDecodeArrToUnsignedLong(a1, a2, a3, a4):
-    return ((a1<<24) & (a2<<16) & (a3<<8) & a4)
+    return ((a1<<24) | (a2<<16) | (a3<<8) | a4)
 
 def asbPkgDecodeArrToSignedLong(a1, a2, a3, a4):
     aint = asbPkgDecodeArrToUnsignedLong(a1, a2, a3, a4)
-    if aint > pow(2,31):
-        aint = 1-(aint-pow(2,31))
+    if aint >= pow(2,31):
+        aint = aint-pow(2,32)
 
     return aint
 
@@ -99,6 +99,10 @@ def asbPkgDecodeCmd(data):
     if data[0] == 0x52: return 'percental Message, state is ' + str(data[1]) + '%'
     if data[0] == 0x70: return 'PING request'
     if data[0] == 0x71: return 'PONG (PING response)'
+    if data[0] == 0x72 and len(data) == 1: return 'Bus utilization request'
+    if data[0] == 0x72: return 'Bus utilization is ' + ', '.join([str(x) + '%' if x <= 100 else '-' for x in data[1:]])
+    if data[0] == 0x73 and len(data) == 1: return 'Member of every group'
+    if data[0] == 0x73: return 'Member of groups in ' + str(sum([bin(x).count('1') for x in data[1:]])) + ' hash bits'
     if data[0] == 0x80: return 'Request to read configuration register ' + "{0:#0{1}x}".format(asbPkgDecodeArrToUnsignedInt(data[1], data[2]),6)
     if data[0] == 0x81: return 'Request to write configuration register ' + "{0:#0{1}x}".format(asbPkgDecodeArrToUnsignedInt(data[1], data[2]),6) + ' with value ' + "{0:#0{1}x}".format(data[3],4)
     if data[0] == 0x82: return 'Request to activate configuration register ' + "{0:#0{1}x}".format(asbPkgDecodeArrToUnsignedInt(data[1], data[2]),6)
@@ -111,9 +115,9 @@ def asbPkgDecodeCmd(data):
     if data[0] == 0xA7: return 'IR is ' + str(asbPkgDecodeArrToUnsignedLong(data[1], data[2], data[3], data[4]))
     #if data[0] == 0xB0:
     #if data[0] == 0xB1:
-    if data[0] == 0xC0: return 'Voltage is ' + str(asbPkgDecodeArrToUnsignedInt(data[1], data[2])/10) + 'V'
-    if data[0] == 0xC1: return 'Ampere is ' + str(asbPkgDecodeArrToUnsignedInt(data[1], data[2])/10) + 'A'
-    if data[0] == 0xC2: return 'Power is ' + str(asbPkgDecodeArrToUnsignedInt(data[1], data[2])/10) + 'VA'
+    if data[0] == 0xC0: return 'Voltage is ' + str(asbPkgDecodeArrToSignedInt(data[1], data[2])/100) + 'V'
+    if data[0] == 0xC1: return 'Ampere is ' + str(asbPkgDecodeArrToSignedInt(data[1], data[2])/100) + 'A'
+    if data[0] == 0xC2: return 'Power is ' + str(asbPkgDecodeArrToSignedLong(data[1], data[2], data[3], data[4])/10) + 'VA'
     if data[0] == 0xD0: return 'percental sensor is ' + str(data[1]) + '%'
     if data[0] == 0xD1: return 'permille sensor is ' + str(asbPkgDecodeArrToUnsignedInt(data[1], data[2])) + '‰'
     if data[0] == 0xD2: return 'parts per million sensor is ' + str(asbPkgDecodeArrToUnsignedInt(data[1], data[2]))
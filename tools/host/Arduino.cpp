@@ -0,0 +1,105 @@
+/**
+  aSysBus host platform
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Arduino.h"
+#include "EEPROM.h"
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+
+static uint64_t _hostTime = 0;
+
+void hostTime(uint64_t us) {
+    _hostTime = us;
+}
+
+unsigned long millis(void) {
+    return _hostTime / 1000;
+}
+
+unsigned long micros(void) {
+    return _hostTime;
+}
+
+void delay(unsigned long ms) {
+    _hostTime += (uint64_t)ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us) {
+    _hostTime += us;
+}
+
+HostPort hostPorts[HOST_PORTS + 1];
+uint8_t hostSREG = 0x80;
+unsigned long hostAtomic = 0;
+
+void hostCli(void) {
+    hostSREG &= ~0x80;
+    hostAtomic++;
+}
+
+void hostPin(uint8_t pin, uint8_t level) {
+    uint8_t port = digitalPinToPort(pin);
+    if(port == NOT_A_PORT) return;
+    if(level) {
+        hostPorts[port].input |= digitalPinToBitMask(pin);
+    }else{
+        hostPorts[port].input &= ~digitalPinToBitMask(pin);
+    }
+}
+
+static int _hostAnalog[256];
+static int _hostPwm[256];
+
+void hostAnalog(uint8_t pin, int value) {
+    _hostAnalog[pin] = value;
+}
+
+int hostPwm(uint8_t pin) {
+    return _hostPwm[pin];
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+int digitalRead(uint8_t pin) {
+    uint8_t port = digitalPinToPort(pin);
+    if(port == NOT_A_PORT) return LOW;
+    return (hostPorts[port].input & digitalPinToBitMask(pin)) ? HIGH : LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    uint8_t port = digitalPinToPort(pin);
+    if(port == NOT_A_PORT) return;
+    if(val) {
+        hostPorts[port].output |= digitalPinToBitMask(pin);
+    }else{
+        hostPorts[port].output &= ~digitalPinToBitMask(pin);
+    }
+    hostPorts[port].pinWrites++;
+}
+
+int analogRead(uint8_t pin) {
+    return _hostAnalog[pin];
+}
+
+void analogWrite(uint8_t pin, int val) {
+    _hostPwm[pin] = val;
+}
+
+void attachInterrupt(uint8_t interrupt, void (*function)(void), int mode) {}
@@ -0,0 +1,216 @@
+/**
+  aSysBus host platform
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Minimal Arduino API to run the library on a POSIX host
+ *
+ * Used by tools like tools/asbsim.cpp. Time is controlled by the tool using
+ * hostTime(), serial output is discarded unless hostSerial is set.
+ *
+ * Pins 0 to HOST_PORTS*8-1 belong to simulated 8 bit ports, pin 8 is bit 0
+ * of port 2. Input levels are set with hostPin() and read as LOW by
+ * default, outputs are kept in the output register of their port. Higher
+ * pins read as LOW and ignore writes. analogRead() returns the value set
+ * with hostAnalog(), 0 by default, analogWrite() is kept for hostPwm().
+ */
+
+#ifndef ASB_HOST_ARDUINO__H
+#define ASB_HOST_ARDUINO__H
+    #include <stdint.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #include <stdio.h>
+
+    typedef uint8_t byte;
+    typedef bool boolean;
+
+    #define HIGH 0x1
+    #define LOW  0x0
+
+    #define INPUT 0x0
+    #define OUTPUT 0x1
+    #define INPUT_PULLUP 0x2
+
+    #define CHANGE 1
+    #define FALLING 2
+    #define RISING 3
+
+    #define DEC 10
+    #define HEX 16
+
+    #define A0 14
+    #define A1 15
+
+    #define PROGMEM
+    #define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+    #define pgm_read_word(addr) (*(const uint16_t *)(addr))
+    #define memcpy_P memcpy
+    #define F(str) (str)
+
+    #define noInterrupts()
+    #define interrupts()
+    #define digitalPinToInterrupt(pin) (pin)
+
+    /**
+     * Simulated ports, see asb_port.h
+     */
+    #ifndef HOST_PORTS
+        #define HOST_PORTS 8
+    #endif
+    #define ASB_PORT_REGISTER
+    #define NOT_A_PORT 0
+    #define digitalPinToPort(pin) (((pin) < HOST_PORTS * 8) ? ((pin) / 8 + 1) : NOT_A_PORT)
+    #define digitalPinToBitMask(pin) ((uint8_t)(1 << ((pin) % 8)))
+    #define portInputRegister(port) (&hostPorts[port].input)
+    #define portOutputRegister(port) (&hostPorts[port].output)
+    #define SREG hostSREG
+    #define cli() hostCli()
+
+    /**
+     * Port registers, index NOT_A_PORT is unused
+     */
+    struct HostPort {
+        uint8_t input;
+        uint8_t output;
+
+        /**
+         * Single pin writes using digitalWrite()
+         */
+        unsigned long pinWrites;
+    };
+
+    extern HostPort hostPorts[HOST_PORTS + 1];
+    extern uint8_t hostSREG;
+
+    /**
+     * Number of cli() calls, asbPortWrite() uses one per register update
+     */
+    extern unsigned long hostAtomic;
+
+    /**
+     * Disable interrupts, counted in hostAtomic
+     */
+    void hostCli(void);
+
+    /**
+     * Set the input level of a simulated pin
+     * @param pin pin number
+     * @param level HIGH or LOW
+     */
+    void hostPin(uint8_t pin, uint8_t level);
+
+    /**
+     * Set the reading of an analog pin
+     * @param pin pin number, e.g. A0
+     * @param value ADC reading
+     */
+    void hostAnalog(uint8_t pin, int value);
+
+    /**
+     * Get the last value written with analogWrite()
+     * @param pin pin number
+     * @return int PWM value, 0 by default
+     */
+    int hostPwm(uint8_t pin);
+
+    /**
+     * Set the current time
+     * @param us microseconds since start
+     */
+    void hostTime(uint64_t us);
+
+    unsigned long millis(void);
+    unsigned long micros(void);
+    void delay(unsigned long ms);
+    void delayMicroseconds(unsigned int us);
+
+    void pinMode(uint8_t pin, uint8_t mode);
+    int digitalRead(uint8_t pin);
+    void digitalWrite(uint8_t pin, uint8_t val);
+    int analogRead(uint8_t pin);
+    void analogWrite(uint8_t pin, int val);
+    void attachInterrupt(uint8_t interrupt, void (*function)(void), int mode);
+
+    /**
+     * Print to a stdio file, output is discarded if file is NULL
+     */
+    class Print {
+        public:
+            FILE *file = NULL;
+
+            virtual ~Print() {}
+            virtual size_t write(uint8_t c) {
+                return (file == NULL || fputc(c, file) != EOF) ? 1 : 0;
+            }
+            virtual size_t write(const uint8_t *buf, size_t size) {
+                size_t n = 0;
+                while(size-- > 0) n += write(*buf++);
+                return n;
+            }
+            size_t print(const char *str) {
+                return write((const uint8_t *)str, strlen(str));
+            }
+            size_t print(char c) {
+                return write((uint8_t)c);
+            }
+            size_t print(unsigned long n, int base = DEC) {
+                char buf[24];
+                snprintf(buf, sizeof(buf), (base == HEX) ? "%lX" : "%lu", n);
+                return print(buf);
+            }
+            size_t print(long n, int base = DEC) {
+                if(base == HEX) return print((unsigned long)n, base);
+                char buf[24];
+                snprintf(buf, sizeof(buf), "%ld", n);
+                return print(buf);
+            }
+            size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+            size_t print(int n, int base = DEC) { return print((long)n, base); }
+            size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+            size_t println(void) { return print("\r\n"); }
+            template <typename T> size_t println(T value) { return print(value) + println(); }
+            template <typename T> size_t println(T value, int base) { return print(value, base) + println(); }
+            void flush(void) { if(file != NULL) fflush(file); }
+    };
+
+    /**
+     * Readable stream, empty unless a derived class provides data
+     */
+    class Stream : public Print {
+        public:
+            virtual int available(void) { return 0; }
+            virtual int read(void) { return -1; }
+            virtual int peek(void) { return -1; }
+            size_t readBytes(uint8_t *buf, size_t length) {
+                size_t n = 0;
+                int c;
+                while(n < length && (c = read()) >= 0) buf[n++] = c;
+                return n;
+            }
+            size_t readBytes(char *buf, size_t length) { return readBytes((uint8_t *)buf, length); }
+    };
+
+    class HardwareSerial : public Stream {
+        public:
+            void begin(unsigned long baud) {}
+    };
+
+    extern HardwareSerial Serial;
+
+#endif /* ASB_HOST_ARDUINO__H */
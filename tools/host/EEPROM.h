@@ -0,0 +1,102 @@
+/**
+  aSysBus host platform - EEPROM
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASB_HOST_EEPROM__H
+#define ASB_HOST_EEPROM__H
+    #include "Arduino.h"
+
+    #ifndef ASB_HOST_EEPROM
+        #define ASB_HOST_EEPROM 1024
+    #endif
+
+    /**
+     * EEPROM in RAM, erased to 0xFF
+     *
+     * Counts the writes of every cell. Setting power simulates a power loss
+     * after that many writes: The cell written next stays erased and all
+     * further writes are lost until powerOn() is called.
+     */
+    class EEPROMClass {
+        public:
+            byte mem[ASB_HOST_EEPROM];
+
+            /**
+             * Number of writes per cell
+             */
+            unsigned long writes[ASB_HOST_EEPROM];
+
+            /**
+             * Writes left until power is lost, -1 = never
+             */
+            long power = -1;
+
+            /**
+             * Power was lost, writes are ignored
+             */
+            bool lost = false;
+
+            EEPROMClass() { erase(); }
+            byte read(int address) { return mem[address]; }
+            void write(int address, byte value) { store(address, value); }
+            void update(int address, byte value) { if(mem[address] != value) store(address, value); }
+            uint16_t length(void) { return sizeof(mem); }
+            template <typename T> T &get(int address, T &t) {
+                memcpy(&t, &mem[address], sizeof(T));
+                return t;
+            }
+            template <typename T> const T &put(int address, const T &t) {
+                const byte *ptr = (const byte *)&t;
+                for(size_t i=0; i<sizeof(T); i++) update(address+i, ptr[i]);
+                return t;
+            }
+
+            /**
+             * Erase all cells and reset the counters
+             */
+            void erase(void) {
+                memset(mem, 0xFF, sizeof(mem));
+                memset(writes, 0, sizeof(writes));
+                powerOn();
+            }
+
+            /**
+             * Restore power
+             */
+            void powerOn(void) {
+                power = -1;
+                lost = false;
+            }
+
+        private:
+            void store(int address, byte value) {
+                if(lost) return;
+                writes[address]++;
+                if(power == 0) {
+                    mem[address] = 0xFF; //Erased, but not written
+                    lost = true;
+                    return;
+                }
+                if(power > 0) power--;
+                mem[address] = value;
+            }
+    };
+
+    extern EEPROMClass EEPROM;
+
+#endif /* ASB_HOST_EEPROM__H */
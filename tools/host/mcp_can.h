@@ -0,0 +1,65 @@
+/**
+  aSysBus host platform - MCP2515 placeholder
+
+  @copyright 2015-2017 Florian Knodt, www.adlerweb.info
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Lets ASB_CAN compile on a host, e.g. for the address helpers. There is
+ * no controller, so begin() fails and nothing is ever received.
+ */
+
+#ifndef ASB_HOST_MCP_CAN__H
+#define ASB_HOST_MCP_CAN__H
+    #include "Arduino.h"
+
+    #define CAN_OK         0
+    #define CAN_FAILINIT   1
+    #define CAN_NOMSG      4
+    #define CAN_MSGAVAIL   3
+
+    #define CAN_5KBPS      1
+    #define CAN_10KBPS     2
+    #define CAN_20KBPS     3
+    #define CAN_25KBPS     4
+    #define CAN_31K25BPS   5
+    #define CAN_33KBPS     6
+    #define CAN_40KBPS     7
+    #define CAN_50KBPS     8
+    #define CAN_80KBPS     9
+    #define CAN_83K3BPS    10
+    #define CAN_95KBPS     11
+    #define CAN_100KBPS    12
+    #define CAN_125KBPS    13
+    #define CAN_200KBPS    14
+    #define CAN_250KBPS    15
+    #define CAN_500KBPS    16
+    #define CAN_666KBPS    17
+    #define CAN_1000KBPS   18
+
+    #define MCP_16MHz      1
+    #define MCP_8MHz       2
+
+    class MCP_CAN {
+        public:
+            MCP_CAN(byte cs) {}
+            byte begin(byte speed, byte clock) { return CAN_FAILINIT; }
+            byte sendMsgBuf(unsigned long id, byte ext, byte len, const byte *buf) { return CAN_FAILINIT; }
+            byte checkReceive(void) { return CAN_NOMSG; }
+            byte readMsgBufID(unsigned long *id, byte *len, byte *buf) { return CAN_NOMSG; }
+    };
+
+#endif /* ASB_HOST_MCP_CAN__H */